@@ -0,0 +1,526 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace bench
+{
+	namespace
+	{
+		struct options
+		{
+			std::string filter = ".";
+			double min_time = 0.5; // Seconds each benchmark keeps doubling its iterations until it runs for
+			unsigned repetitions = 1;
+			bool json = false;
+			bool list = false;
+			std::string out_path; // Also writes JSON here when set
+		};
+
+		struct result
+		{
+			std::string name;
+			std::string run_name;
+			std::string aggregate_name; // Empty for a single run
+			unsigned repetition_index = 0;
+			unsigned repetitions = 1;
+			uint64_t iterations = 0;
+			double real_time = 0.0; // Per iteration, in the benchmark's time unit
+			double cpu_time = 0.0;
+			double items_per_second = 0.0;
+			double bytes_per_second = 0.0;
+			time_unit unit = time_unit::nanosecond;
+			std::string label;
+			std::string error;
+		};
+
+		// Registered from static initialisers, so it must exist before the first of them runs
+		std::vector<std::unique_ptr<benchmark>>& registry()
+		{
+			static std::vector<std::unique_ptr<benchmark>> benchmarks;
+			return benchmarks;
+		}
+
+		void print_usage()
+		{
+			std::cerr << "Usage: bench [--benchmark_filter=REGEX] [--benchmark_min_time=SECONDS] [--benchmark_repetitions=N]\n"
+				<< "             [--benchmark_format=console|json] [--benchmark_out=FILE] [--benchmark_list_tests]\n";
+		}
+
+		options parse_options(const int argc, char* argv[])
+		{
+			options opts;
+
+			for (auto i = 1; i < argc; ++i)
+			{
+				const std::string arg = argv[i];
+				const auto equals = arg.find('=');
+				const auto name = arg.substr(0, equals);
+				const auto value = (equals != std::string::npos) ? arg.substr(equals + 1) : std::string();
+
+				if (name == "--benchmark_filter")
+					opts.filter = value;
+				else if (name == "--benchmark_min_time")
+					opts.min_time = std::stod(value);
+				else if (name == "--benchmark_repetitions")
+					opts.repetitions = std::max(1u, static_cast<unsigned>(std::stoul(value)));
+				else if (name == "--benchmark_format" && (value == "console" || value == "json"))
+					opts.json = (value == "json");
+				else if (name == "--benchmark_out")
+					opts.out_path = value;
+				else if (arg == "--benchmark_list_tests")
+					opts.list = true;
+				else
+					throw std::invalid_argument("Unknown option \"" + arg + "\"");
+			}
+
+			return opts;
+		}
+
+		double seconds_per_unit(const time_unit unit) noexcept
+		{
+			switch (unit)
+			{
+			case time_unit::microsecond: return 1e-6;
+			case time_unit::millisecond: return 1e-3;
+			default: return 1e-9;
+			}
+		}
+
+		const char* unit_name(const time_unit unit) noexcept
+		{
+			switch (unit)
+			{
+			case time_unit::microsecond: return "us";
+			case time_unit::millisecond: return "ms";
+			default: return "ns";
+			}
+		}
+
+		std::string json_string(const std::string& text)
+		{
+			std::string escaped = "\"";
+
+			for (const auto c : text)
+			{
+				if (c == '"' || c == '\\')
+					escaped += '\\';
+
+				escaped += c;
+			}
+
+			return escaped + "\"";
+		}
+
+		// Rates are printed like Google Benchmark does, as 123.4M/s
+		std::string human_rate(double rate)
+		{
+			constexpr const char* suffixes[] = { "", "k", "M", "G", "T" };
+			auto suffix = 0;
+
+			while (rate >= 1000.0 && suffix < 4)
+			{
+				rate /= 1000.0;
+				++suffix;
+			}
+
+			std::ostringstream out;
+			out << std::fixed << std::setprecision(rate < 10.0 ? 3 : rate < 100.0 ? 2 : 1) << rate << suffixes[suffix];
+			return out.str();
+		}
+
+		void write_console_header()
+		{
+			std::cout << std::left << std::setw(40) << "Benchmark" << std::right << std::setw(15) << "Time" << std::setw(15)
+				<< "CPU" << std::setw(13) << "Iterations" << " UserCounters...\n"
+				<< std::string(100, '-') << "\n";
+		}
+
+		void write_console(const result& res)
+		{
+			std::cout << std::left << std::setw(40) << res.name << std::right;
+
+			if (!res.error.empty())
+			{
+				std::cout << " ERROR OCCURRED: '" << res.error << "'\n";
+				return;
+			}
+
+			const auto unit = unit_name(res.unit);
+			std::cout << std::fixed << std::setprecision(2) << std::setw(12) << res.real_time << " " << unit
+				<< std::setw(12) << res.cpu_time << " " << unit;
+
+			if (res.aggregate_name.empty())
+				std::cout << std::setw(13) << res.iterations;
+			else
+				std::cout << std::setw(13) << "";
+
+			if (res.items_per_second > 0.0)
+				std::cout << " items_per_second=" << human_rate(res.items_per_second) << "/s";
+
+			if (res.bytes_per_second > 0.0)
+				std::cout << " bytes_per_second=" << human_rate(res.bytes_per_second) << "/s";
+
+			if (!res.label.empty())
+				std::cout << " " << res.label;
+
+			std::cout << "\n";
+		}
+
+		void write_json(std::ostream& out, const std::vector<result>& results, const char* executable)
+		{
+			const auto now = std::time(nullptr);
+			char date[32];
+			std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+			out << "{\n  \"context\": {\n"
+				<< "    \"date\": " << json_string(date) << ",\n"
+				<< "    \"executable\": " << json_string(executable) << ",\n"
+				<< "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+#ifdef NDEBUG
+				<< "    \"library_build_type\": \"release\"\n"
+#else
+				<< "    \"library_build_type\": \"debug\"\n"
+#endif
+				<< "  },\n  \"benchmarks\": [";
+
+			for (std::size_t i = 0; i < results.size(); ++i)
+			{
+				const auto& res = results[i];
+
+				out << (i > 0 ? "," : "") << "\n    {\n"
+					<< "      \"name\": " << json_string(res.name) << ",\n"
+					<< "      \"run_name\": " << json_string(res.run_name) << ",\n"
+					<< "      \"run_type\": " << (res.aggregate_name.empty() ? "\"iteration\"" : "\"aggregate\"") << ",\n"
+					<< "      \"repetitions\": " << res.repetitions << ",\n";
+
+				if (res.aggregate_name.empty())
+					out << "      \"repetition_index\": " << res.repetition_index << ",\n";
+				else
+					out << "      \"aggregate_name\": " << json_string(res.aggregate_name) << ",\n";
+
+				out << "      \"threads\": 1,\n";
+
+				if (!res.error.empty())
+				{
+					out << "      \"error_occurred\": true,\n"
+						<< "      \"error_message\": " << json_string(res.error) << "\n    }";
+					continue;
+				}
+
+				out << std::setprecision(10)
+					<< "      \"iterations\": " << res.iterations << ",\n"
+					<< "      \"real_time\": " << res.real_time << ",\n"
+					<< "      \"cpu_time\": " << res.cpu_time << ",\n"
+					<< "      \"time_unit\": \"" << unit_name(res.unit) << "\"";
+
+				if (res.items_per_second > 0.0)
+					out << ",\n      \"items_per_second\": " << res.items_per_second;
+
+				if (res.bytes_per_second > 0.0)
+					out << ",\n      \"bytes_per_second\": " << res.bytes_per_second;
+
+				if (!res.label.empty())
+					out << ",\n      \"label\": " << json_string(res.label);
+
+				out << "\n    }";
+			}
+
+			out << "\n  ]\n}\n";
+		}
+
+		// Mean, median and standard deviation of every repetition, which is what compare.py looks for
+		std::vector<result> aggregate(const std::vector<result>& runs)
+		{
+			const auto statistic = [&](const std::string& name, const auto& reduce)
+			{
+				auto res = runs.front();
+				res.name = res.run_name + "_" + name;
+				res.aggregate_name = name;
+				res.real_time = reduce([](const result& r) { return r.real_time; });
+				res.cpu_time = reduce([](const result& r) { return r.cpu_time; });
+				res.items_per_second = reduce([](const result& r) { return r.items_per_second; });
+				res.bytes_per_second = reduce([](const result& r) { return r.bytes_per_second; });
+				return res;
+			};
+
+			const auto mean = [&](const auto& field)
+			{
+				auto sum = 0.0;
+
+				for (const auto& run : runs)
+					sum += field(run);
+
+				return sum / runs.size();
+			};
+
+			const auto median = [&](const auto& field)
+			{
+				std::vector<double> values;
+
+				for (const auto& run : runs)
+					values.push_back(field(run));
+
+				std::sort(values.begin(), values.end());
+				const auto middle = values.size() / 2;
+				return (values.size() % 2 != 0) ? values[middle] : (values[middle - 1] + values[middle]) / 2.0;
+			};
+
+			const auto stddev = [&](const auto& field)
+			{
+				const auto average = mean(field);
+				auto sum = 0.0;
+
+				for (const auto& run : runs)
+					sum += (field(run) - average) * (field(run) - average);
+
+				return std::sqrt(sum / (runs.size() - 1));
+			};
+
+			return { statistic("mean", mean), statistic("median", median), statistic("stddev", stddev) };
+		}
+	}
+
+	state::state(const uint64_t max_iterations) noexcept
+		: m_max_iterations(max_iterations)
+	{
+	}
+
+	state::iterator state::begin() noexcept
+	{
+		m_start_cpu_time = std::clock();
+		m_start_time = clock::now();
+		return { this, m_max_iterations };
+	}
+
+	state::iterator state::end() noexcept
+	{
+		return { this, 0 };
+	}
+
+	uint64_t state::iterations() const noexcept
+	{
+		return m_max_iterations;
+	}
+
+	void state::set_items_processed(const uint64_t items) noexcept
+	{
+		m_items = items;
+	}
+
+	void state::set_bytes_processed(const uint64_t bytes) noexcept
+	{
+		m_bytes = bytes;
+	}
+
+	void state::set_label(const std::string& label)
+	{
+		m_label = label;
+	}
+
+	void state::skip_with_error(const std::string& message)
+	{
+		m_error = message;
+	}
+
+	void state::stop_timer() noexcept
+	{
+		const auto end_time = clock::now();
+		const auto end_cpu_time = std::clock();
+
+		m_real_seconds = std::chrono::duration<double>(end_time - m_start_time).count();
+		m_cpu_seconds = static_cast<double>(end_cpu_time - m_start_cpu_time) / CLOCKS_PER_SEC;
+	}
+
+	benchmark::benchmark(std::string name, std::function<void(state&)> function)
+		: m_name(std::move(name)), m_function(std::move(function))
+	{
+	}
+
+	benchmark& benchmark::unit(const time_unit unit) noexcept
+	{
+		m_unit = unit;
+		return *this;
+	}
+
+	const std::string& benchmark::name() const noexcept
+	{
+		return m_name;
+	}
+
+	benchmark& register_benchmark(const std::string& name, std::function<void(state&)> function)
+	{
+		registry().push_back(std::make_unique<benchmark>(name, std::move(function)));
+		return *registry().back();
+	}
+
+	struct runner
+	{
+		// Doubles the iterations, or more once the time per iteration is known, until a run takes at least min_time
+		static result run(const benchmark& bm, const double min_time)
+		{
+			constexpr uint64_t max_iterations = 1000000000;
+
+			uint64_t iterations = 1;
+
+			while (true)
+			{
+				state st(iterations);
+				bm.m_function(st);
+
+				if (!st.m_error.empty() || st.m_real_seconds >= min_time || iterations >= max_iterations)
+					return make_result(bm, st);
+
+				auto multiplier = min_time * 1.4 / std::max(st.m_real_seconds, 1e-9);
+
+				if (st.m_real_seconds / min_time <= 0.1)
+					multiplier = std::min(multiplier, 10.0);
+
+				const auto next = static_cast<uint64_t>(std::llround(iterations * multiplier));
+				iterations = std::min(std::max(next, iterations + 1), max_iterations);
+			}
+		}
+
+		static result make_result(const benchmark& bm, const state& st)
+		{
+			result res;
+			res.name = bm.m_name;
+			res.run_name = bm.m_name;
+			res.unit = bm.m_unit;
+			res.label = st.m_label;
+			res.error = st.m_error;
+			res.iterations = st.m_max_iterations;
+
+			if (res.error.empty())
+			{
+				const auto scale = 1.0 / (seconds_per_unit(bm.m_unit) * st.m_max_iterations);
+				res.real_time = st.m_real_seconds * scale;
+				res.cpu_time = st.m_cpu_seconds * scale;
+
+				if (st.m_real_seconds > 0.0)
+				{
+					res.items_per_second = st.m_items / st.m_real_seconds;
+					res.bytes_per_second = st.m_bytes / st.m_real_seconds;
+				}
+			}
+
+			return res;
+		}
+	};
+
+	int run_benchmarks(const int argc, char* argv[])
+	{
+		options opts;
+		std::regex filter;
+
+		try
+		{
+			opts = parse_options(argc, argv);
+			filter = std::regex(opts.filter);
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << e.what() << "\n";
+			print_usage();
+			return EXIT_FAILURE;
+		}
+
+		std::vector<const benchmark*> selected;
+
+		for (const auto& bm : registry())
+		{
+			if (std::regex_search(bm->name(), filter))
+				selected.push_back(bm.get());
+		}
+
+		if (opts.list)
+		{
+			for (const auto* bm : selected)
+				std::cout << bm->name() << "\n";
+
+			return EXIT_SUCCESS;
+		}
+
+		if (!opts.json)
+			write_console_header();
+
+		std::vector<result> results;
+		auto failed = false;
+
+		for (const auto* bm : selected)
+		{
+			std::vector<result> runs;
+
+			for (unsigned i = 0; i < opts.repetitions; ++i)
+			{
+				auto res = runner::run(*bm, opts.min_time);
+				res.repetition_index = i;
+				res.repetitions = opts.repetitions;
+				failed |= !res.error.empty();
+
+				if (!opts.json)
+					write_console(res);
+
+				runs.push_back(res);
+
+				if (!res.error.empty())
+					break;
+			}
+
+			results.insert(results.end(), runs.begin(), runs.end());
+
+			if (runs.size() > 1)
+			{
+				for (const auto& res : aggregate(runs))
+				{
+					if (!opts.json)
+						write_console(res);
+
+					results.push_back(res);
+				}
+			}
+		}
+
+		if (opts.json)
+			write_json(std::cout, results, argv[0]);
+
+		if (!opts.out_path.empty())
+		{
+			std::ofstream out(opts.out_path);
+
+			if (!out.is_open())
+			{
+				std::cerr << "Failed to open \"" << opts.out_path << "\"\n";
+				return EXIT_FAILURE;
+			}
+
+			write_json(out, results, argv[0]);
+		}
+
+		return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+
+	// Anything stored here could be read by another thread, so whatever it points to has to be kept
+	const void* volatile escaped_pointer = nullptr;
+
+	void escape(const void* pointer) noexcept
+	{
+		escaped_pointer = pointer;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	return bench::run_benchmarks(argc, argv);
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <string>
+
+// A small benchmark harness with the same shape as Google Benchmark, whose JSON output its compare.py can read
+namespace bench
+{
+	enum class time_unit
+	{
+		nanosecond,
+		microsecond,
+		millisecond
+	};
+
+	class state
+	{
+	public:
+		explicit state(uint64_t max_iterations) noexcept;
+
+		// The unused loop variable in `for (auto _ : state)`
+		struct [[maybe_unused]] value
+		{
+		};
+
+		// Times the body of `for (auto _ : state)`, which runs max_iterations times
+		struct iterator
+		{
+			state* parent;
+			uint64_t remaining;
+
+			bool operator!=(const iterator&) noexcept
+			{
+				if (remaining != 0)
+					return true;
+
+				parent->stop_timer();
+				return false;
+			}
+
+			iterator& operator++() noexcept
+			{
+				--remaining;
+				return *this;
+			}
+
+			value operator*() const noexcept
+			{
+				return {};
+			}
+		};
+
+		iterator begin() noexcept;
+		iterator end() noexcept;
+
+		[[nodiscard]] uint64_t iterations() const noexcept;
+
+		// Reported as rates over the real time taken by every iteration
+		void set_items_processed(uint64_t items) noexcept;
+		void set_bytes_processed(uint64_t bytes) noexcept;
+
+		void set_label(const std::string& label);
+
+		// Reports the benchmark as failed rather than timing it
+		void skip_with_error(const std::string& message);
+
+	private:
+		friend struct runner;
+
+		using clock = std::chrono::steady_clock;
+
+		uint64_t m_max_iterations;
+		uint64_t m_items = 0;
+		uint64_t m_bytes = 0;
+		std::string m_label;
+		std::string m_error;
+		clock::time_point m_start_time;
+		std::clock_t m_start_cpu_time = 0;
+		double m_real_seconds = 0.0;
+		double m_cpu_seconds = 0.0;
+
+		void stop_timer() noexcept;
+	};
+
+	class benchmark
+	{
+	public:
+		benchmark(std::string name, std::function<void(state&)> function);
+
+		benchmark& unit(time_unit unit) noexcept;
+
+		[[nodiscard]] const std::string& name() const noexcept;
+
+	private:
+		friend struct runner;
+
+		std::string m_name;
+		std::function<void(state&)> m_function;
+		time_unit m_unit = time_unit::nanosecond;
+	};
+
+	benchmark& register_benchmark(const std::string& name, std::function<void(state&)> function);
+
+	// Runs the registered benchmarks picked out by the --benchmark_* options, returning the process exit code
+	int run_benchmarks(int argc, char* argv[]);
+
+	void escape(const void* pointer) noexcept;
+
+	// Stops the compiler from optimising away a value, or assuming anything about it afterwards
+	template<typename T>
+	void do_not_optimize(T& value) noexcept
+	{
+#if defined(__GNUC__)
+		asm volatile("" : : "g"(&value) : "memory");
+#else
+		escape(&value);
+#endif
+	}
+}
@@ -0,0 +1,213 @@
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "cached_interpreter.h"
+#include "chip8.h"
+#include "chip8_batch.h"
+#include "jit_engine.h"
+#include "rom_file.h"
+
+namespace
+{
+	// The ROMs in bench/roms, each of which runs forever without input
+	constexpr const char* rom_names[] = { "alu", "sprite", "maze", "particles", "counter" };
+
+	constexpr uint64_t rom_cycles = 1000000;
+	constexpr uint32_t cycles_per_frame = 10; // Timers tick once every frame, as they do in chip8-headless
+	constexpr uint32_t seed = 1;
+
+	chip8 load_rom(const std::string& rom_name)
+	{
+		const auto rom = read_rom_file(CHIP8_BENCH_ROM_DIR "/" + rom_name + ".ch8");
+
+		chip8 emu;
+		emu.seed_random(seed);
+		emu.load_program(rom.data(), rom.size());
+		return emu;
+	}
+
+	template<typename engine>
+	uint64_t run_frames(chip8& emu, engine& eng)
+	{
+		for (uint64_t cycles = 0; cycles < rom_cycles;)
+		{
+			if (!eng.next_instruction())
+				return cycles;
+
+			if (++cycles % cycles_per_frame == 0)
+				emu.tick_timers();
+		}
+
+		return rom_cycles;
+	}
+
+	uint64_t run_frames(chip8& emu, jit_engine& jit)
+	{
+		uint64_t cycles = 0;
+
+		while (cycles < rom_cycles)
+		{
+			cycles += jit.run(cycles_per_frame);
+
+			if (jit.halted())
+				break;
+
+			emu.tick_timers();
+		}
+
+		return cycles;
+	}
+
+	struct interpreter
+	{
+		static uint64_t run(chip8& emu)
+		{
+			return run_frames(emu, emu);
+		}
+	};
+
+	struct cached
+	{
+		static uint64_t run(chip8& emu)
+		{
+			cached_interpreter cache(emu);
+			return run_frames(emu, cache);
+		}
+	};
+
+	struct jit
+	{
+		static uint64_t run(chip8& emu)
+		{
+			jit_engine jit(emu);
+			return run_frames(emu, jit);
+		}
+	};
+
+	// Every engine has to finish exactly where the interpreter does for its time to mean anything
+	void check_result(bench::state& state, const chip8& emu, const uint64_t cycles, const chip8& expected)
+	{
+		if (cycles != rom_cycles)
+			state.skip_with_error("Quit after " + std::to_string(cycles) + " instructions");
+		else if (emu.save_state() != expected.save_state())
+			state.skip_with_error("Finished in a different state from the interpreter");
+	}
+
+	template<typename engine>
+	void bench_engine(bench::state& state, const std::string& rom_name)
+	{
+		chip8 start;
+		chip8 expected;
+
+		try
+		{
+			start = load_rom(rom_name);
+		}
+		catch (const std::exception& e)
+		{
+			state.skip_with_error(e.what());
+			return;
+		}
+
+		expected = start;
+		interpreter::run(expected);
+
+		chip8 emu;
+		uint64_t cycles = 0;
+
+		for (auto _ : state)
+		{
+			emu = start;
+			cycles = engine::run(emu);
+			bench::do_not_optimize(emu);
+		}
+
+		check_result(state, emu, cycles, expected);
+		state.set_items_processed(state.iterations() * rom_cycles);
+	}
+
+	// Every lane runs its own copy of the ROM, with its own random numbers
+	template<std::size_t lanes>
+	void bench_batch(bench::state& state, const std::string& rom_name)
+	{
+		chip8 start;
+
+		try
+		{
+			start = load_rom(rom_name);
+		}
+		catch (const std::exception& e)
+		{
+			state.skip_with_error(e.what());
+			return;
+		}
+
+		auto batch = std::make_unique<chip8_batch<lanes>>();
+		uint64_t cycles = 0;
+
+		for (auto _ : state)
+		{
+			for (std::size_t lane = 0; lane < lanes; ++lane)
+			{
+				auto emu = start;
+				emu.seed_random(seed + static_cast<uint32_t>(lane));
+				batch->set_lane(lane, emu);
+			}
+
+			cycles = 0;
+
+			for (uint64_t frame = 0; frame < rom_cycles / cycles_per_frame; ++frame)
+			{
+				cycles += batch->run(cycles_per_frame);
+				batch->tick_timers();
+			}
+
+			bench::do_not_optimize(*batch);
+		}
+
+		auto expected = start;
+		expected.seed_random(seed + lanes - 1);
+		interpreter::run(expected);
+
+		check_result(state, batch->get_lane(lanes - 1), cycles / lanes, expected);
+		state.set_items_processed(state.iterations() * rom_cycles * lanes);
+	}
+
+	const bool registered = []
+	{
+		for (const auto* rom_name : rom_names)
+		{
+			const auto prefix = std::string("rom/") + rom_name + "/";
+			const auto jit_name = jit_engine::supported() ? "jit" : "jit (interpreted)";
+
+			bench::register_benchmark(prefix + "interpreter", [=](bench::state& state) {
+				bench_engine<interpreter>(state, rom_name);
+			}).unit(bench::time_unit::millisecond);
+
+			bench::register_benchmark(prefix + "cached", [=](bench::state& state) {
+				bench_engine<cached>(state, rom_name);
+			}).unit(bench::time_unit::millisecond);
+
+			bench::register_benchmark(prefix + jit_name, [=](bench::state& state) {
+				bench_engine<jit>(state, rom_name);
+			}).unit(bench::time_unit::millisecond);
+
+			bench::register_benchmark(prefix + "batch8", [=](bench::state& state) {
+				bench_batch<8>(state, rom_name);
+			}).unit(bench::time_unit::millisecond);
+
+			bench::register_benchmark(prefix + "batch16", [=](bench::state& state) {
+				bench_batch<16>(state, rom_name);
+			}).unit(bench::time_unit::millisecond);
+
+			bench::register_benchmark(prefix + "batch32", [=](bench::state& state) {
+				bench_batch<32>(state, rom_name);
+			}).unit(bench::time_unit::millisecond);
+		}
+
+		return true;
+	}();
+}
@@ -0,0 +1,219 @@
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "chip8.h"
+#include "rgba_frame.h"
+#include "rom_file.h"
+
+namespace
+{
+	// A representative of each opcode family, named as in the decoder
+	struct instruction_case
+	{
+		const char* name;
+		uint16_t instruction;
+	};
+
+	constexpr std::array<instruction_case, 26> instruction_cases = { {
+		{ "00E0", 0x00E0 },
+		{ "00EE", 0x00EE },
+		{ "1NNN", 0x1200 },
+		{ "2NNN", 0x2200 },
+		{ "3XNN", 0x3012 },
+		{ "5XY0", 0x5010 },
+		{ "6XNN", 0x6A42 },
+		{ "7XNN", 0x7A01 },
+		{ "8XY0", 0x8010 },
+		{ "8XY2", 0x8012 },
+		{ "8XY4", 0x8014 },
+		{ "8XY5", 0x8015 },
+		{ "8XY6", 0x8016 },
+		{ "9XY0", 0x9010 },
+		{ "ANNN", 0xA300 },
+		{ "BNNN", 0xB300 },
+		{ "CXNN", 0xC0FF },
+		{ "DXYN", 0xD015 },
+		{ "EX9E", 0xE09E },
+		{ "FX07", 0xF007 },
+		{ "FX15", 0xF015 },
+		{ "FX1E", 0xF01E },
+		{ "FX29", 0xF029 },
+		{ "FX33", 0xF033 },
+		{ "FX55", 0xFF55 },
+		{ "FX65", 0xFF65 }
+	} };
+
+	chip8 make_machine()
+	{
+		chip8 emu;
+
+		for (auto i = 0; i < 16; ++i)
+			emu.registers.data[i] = static_cast<uint8_t>(i * 37 + 11);
+
+		return emu;
+	}
+
+	void bench_instruction(bench::state& state, const uint16_t instruction)
+	{
+		auto emu = make_machine();
+
+		for (auto _ : state)
+		{
+			// Every iteration starts from the same place, with one return address to come back to
+			emu.program_counter = chip8::program_memory_start;
+			emu.registers.address = 0x300;
+			emu.stack_pointer = 1;
+			emu.call_stack[0] = chip8::program_memory_start;
+
+			// Hidden from the compiler, so it has to decode the instruction every time
+			auto hidden = instruction;
+			bench::do_not_optimize(hidden);
+
+			emu.evaluate_instruction(hidden);
+			bench::do_not_optimize(emu);
+		}
+
+		state.set_items_processed(state.iterations());
+	}
+
+	// Sprites drawn at the top left of a byte, straddling two bytes, and wrapping around both edges of the display
+	struct sprite_position
+	{
+		const char* name;
+		uint8_t x;
+		uint8_t y;
+	};
+
+	constexpr std::array<sprite_position, 3> sprite_positions = { {
+		{ "aligned", 8, 8 },
+		{ "unaligned", 13, 8 },
+		{ "wrapped", 60, 28 }
+	} };
+
+	void bench_draw_sprite(bench::state& state, const sprite_position position, const uint8_t height)
+	{
+		auto emu = make_machine();
+		emu.registers.address = 0x300;
+
+		for (auto i = 0; i < height; ++i)
+			emu.memory[0x300 + i] = static_cast<uint8_t>(0xA5 ^ (i * 0x11));
+
+		for (auto _ : state)
+		{
+			// Drawing the same sprite again erases it, so the display alternates between two states
+			emu.draw_sprite(position.x, position.y, height);
+			bench::do_not_optimize(emu);
+		}
+
+		state.set_items_processed(state.iterations() * height);
+	}
+
+	void bench_clear_screen(bench::state& state)
+	{
+		auto emu = make_machine();
+
+		for (auto _ : state)
+		{
+			emu.clear_screen();
+			bench::do_not_optimize(emu);
+		}
+
+		state.set_bytes_processed(state.iterations() * chip8::display_memory_size);
+	}
+
+	void bench_rgba_rows(bench::state& state, const unsigned int row_count)
+	{
+		auto emu = make_machine();
+		rgba_frame frame;
+		frame.set_colours({ 255, 255, 255, 255 }, { 0, 0, 0, 255 });
+
+		for (auto i = 0; i < chip8::display_memory_size; ++i)
+			emu.memory[chip8::display_memory_start + i] = emu.random_byte();
+
+		for (auto _ : state)
+		{
+			const auto* pixels = frame.convert_rows(emu, 0, row_count);
+			bench::do_not_optimize(pixels);
+			bench::do_not_optimize(frame);
+		}
+
+		state.set_items_processed(state.iterations() * row_count * chip8::display_width);
+		state.set_bytes_processed(state.iterations() * row_count * rgba_frame::row_pitch);
+	}
+
+	void bench_load_rom_memory(bench::state& state)
+	{
+		auto emu = make_machine();
+		std::vector<uint8_t> rom(chip8::program_memory_end - chip8::program_memory_start);
+
+		for (auto& byte : rom)
+			byte = emu.random_byte();
+
+		for (auto _ : state)
+		{
+			emu.load_program(rom.data(), rom.size());
+			bench::do_not_optimize(emu);
+		}
+
+		state.set_bytes_processed(state.iterations() * rom.size());
+	}
+
+	void bench_load_rom_file(bench::state& state)
+	{
+		const std::string rom_file_path = CHIP8_BENCH_ROM_DIR "/particles.ch8";
+		auto emu = make_machine();
+		uint64_t bytes = 0;
+
+		try
+		{
+			for (auto _ : state)
+			{
+				const auto rom = read_rom_file(rom_file_path);
+				emu.load_program(rom.data(), rom.size());
+				bench::do_not_optimize(emu);
+				bytes += rom.size();
+			}
+		}
+		catch (const std::exception& e)
+		{
+			state.skip_with_error(e.what());
+		}
+
+		state.set_bytes_processed(bytes);
+	}
+
+	const bool registered = []
+	{
+		for (const auto& test : instruction_cases)
+		{
+			bench::register_benchmark(std::string("evaluate_instruction/") + test.name, [test](bench::state& state) {
+				bench_instruction(state, test.instruction);
+			});
+		}
+
+		for (const uint8_t height : { 1, 5, 15 })
+		{
+			for (const auto& position : sprite_positions)
+			{
+				bench::register_benchmark("draw_sprite/" + std::to_string(height) + "/" + position.name, [=](bench::state& state) {
+					bench_draw_sprite(state, position, height);
+				});
+			}
+		}
+
+		bench::register_benchmark("clear_screen", bench_clear_screen);
+
+		bench::register_benchmark("rgba_frame/1", [](bench::state& state) { bench_rgba_rows(state, 1); });
+		bench::register_benchmark("rgba_frame/" + std::to_string(chip8::display_height), [](bench::state& state) {
+			bench_rgba_rows(state, chip8::display_height);
+		});
+
+		bench::register_benchmark("load_rom/memory", bench_load_rom_memory);
+		bench::register_benchmark("load_rom/file", bench_load_rom_file).unit(bench::time_unit::microsecond);
+
+		return true;
+	}();
+}
@@ -0,0 +1,33 @@
+# Functions for compiling CHIP-8 ROMs into native code ahead of time with chip8-aot
+
+set(CHIP8_AOT_SOURCE_DIR "${CMAKE_CURRENT_LIST_DIR}/../src")
+
+# Translates ROM into C++ and adds it to TARGET, where it defines `extern const aot_program NAME_program`.
+# Any extra arguments are passed on to chip8-aot.
+function(chip8_aot_translate target rom name)
+    get_filename_component(rom_path "${rom}" ABSOLUTE)
+    set(output "${CMAKE_CURRENT_BINARY_DIR}/${target}_${name}_aot.cpp")
+
+    add_custom_command(OUTPUT "${output}"
+        COMMAND chip8-aot --name ${name} ${ARGN} "${rom_path}" "${output}"
+        DEPENDS chip8-aot "${rom_path}"
+        COMMENT "Translating ${rom} into C++"
+        VERBATIM)
+
+    target_sources(${target} PRIVATE "${output}")
+    target_include_directories(${target} PRIVATE "${CHIP8_AOT_SOURCE_DIR}")
+endfunction()
+
+# Compiles ROM into the native executable TARGET, which runs it and prints its final state like chip8-headless.
+# Any extra arguments are passed on to chip8-aot.
+function(chip8_aot_rom target rom)
+    get_filename_component(name "${rom}" NAME_WE)
+    string(MAKE_C_IDENTIFIER "${name}" name)
+
+    add_executable(${target}
+        "${CHIP8_AOT_SOURCE_DIR}/aot_main.cpp"
+        "${CHIP8_AOT_SOURCE_DIR}/state_json.cpp")
+    chip8_aot_translate(${target} "${rom}" ${name} --entry ${ARGN})
+    target_compile_features(${target} PRIVATE cxx_std_17)
+    set_target_properties(${target} PROPERTIES CXX_EXTENSIONS OFF)
+endfunction()
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "chip8.h"
+#include "decoder.h"
+
+// Why a ROM translated by chip8-aot returned from its run function
+enum class aot_status
+{
+	running, // The cycle budget ran out, and another call carries on from the program counter
+	halted, // The program quit
+	modified // The program wrote over its own translated code, which can no longer be trusted
+};
+
+// Everything chip8-aot generates for a single ROM
+struct aot_program
+{
+	using run_function = uint64_t (*)(chip8& emu, uint64_t max_cycles, aot_status& status);
+
+	const uint8_t* rom;
+	std::size_t rom_size;
+	run_function run;
+};
+
+// Defined by the translated ROM linked into an executable made with chip8_aot_rom()
+extern const aot_program chip8_aot_entry;
+
+// One bit per byte of memory, set for every byte of an instruction that was translated
+using aot_code_map = std::array<uint64_t, chip8::memory_size / 64>;
+
+[[nodiscard]] constexpr bool aot_overlaps_code(const aot_code_map& code_map, const uint32_t address, const uint32_t size) noexcept
+{
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		const auto wrapped = chip8::wrap_address(address + i);
+
+		if ((code_map[wrapped / 64] >> (wrapped % 64)) & 1)
+			return true;
+	}
+
+	return false;
+}
+
+// How many bytes from I the instruction at the program counter writes, for checking instructions that were not
+// translated before the interpreter runs them
+[[nodiscard]] constexpr uint32_t aot_store_size(const chip8& emu) noexcept
+{
+	const auto high = emu.memory[chip8::wrap_address(emu.program_counter)];
+	const auto low = emu.memory[chip8::wrap_address(emu.program_counter + 1)];
+	const auto decoded = decode(static_cast<uint16_t>((high << 8) | low));
+
+	switch (decoded.op)
+	{
+	case operation::store_bcd:
+		return 3;
+	case operation::store_registers:
+		return decoded.x + 1;
+	default:
+		return 0;
+	}
+}
+
+// Runs a translated ROM with the same interface as jit_engine, handing over to the interpreter for good once the
+// program modifies its own code
+class aot_engine
+{
+public:
+	constexpr aot_engine(chip8& emu, const aot_program& program) noexcept
+		: m_chip8(emu), m_program(program)
+	{
+	}
+
+	// Runs at most max_cycles instructions, stopping early if the program quits, and returns how many ran
+	uint64_t run(const uint64_t max_cycles)
+	{
+		if (m_halted)
+			return 0;
+
+		uint64_t cycles = 0;
+
+		if (!m_interpreting)
+		{
+			auto status = aot_status::running;
+			cycles = m_program.run(m_chip8, max_cycles, status);
+
+			m_halted = status == aot_status::halted;
+			m_interpreting = status == aot_status::modified;
+		}
+
+		while (m_interpreting && cycles < max_cycles)
+		{
+			if (!m_chip8.next_instruction())
+			{
+				m_halted = true;
+				break;
+			}
+
+			++cycles;
+		}
+
+		return cycles;
+	}
+
+	[[nodiscard]] bool halted() const noexcept
+	{
+		return m_halted;
+	}
+
+private:
+	chip8& m_chip8;
+	const aot_program& m_program;
+	bool m_halted = false;
+	bool m_interpreting = false;
+};
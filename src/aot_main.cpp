@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "aot_engine.h"
+#include "chip8.h"
+#include "state_json.h"
+
+// Runs the ROM translated into this executable by chip8_aot_rom(), printing its final state as chip8-headless does
+namespace
+{
+	struct options
+	{
+		uint64_t max_cycles = 10000000;
+		uint32_t cycles_per_frame = 10; // Timers tick once every frame, as they do at 60 Hz in the emulator
+		uint32_t seed = chip8::build_seed; // Printed with the results so any run can be repeated
+	};
+
+	void print_usage()
+	{
+		std::cerr << "Usage: [--cycles N] [--cycles-per-frame N] [--seed N]\n";
+	}
+
+	options parse_options(const int argc, char* argv[])
+	{
+		options opts;
+
+		for (auto i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+
+			if (arg == "--cycles" && i + 1 < argc)
+				opts.max_cycles = std::stoull(argv[++i]);
+			else if (arg == "--cycles-per-frame" && i + 1 < argc)
+				opts.cycles_per_frame = static_cast<uint32_t>(std::stoul(argv[++i]));
+			else if (arg == "--seed" && i + 1 < argc)
+				opts.seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+			else
+				throw std::invalid_argument("Unknown option \"" + arg + "\"");
+		}
+
+		if (opts.cycles_per_frame == 0)
+			throw std::invalid_argument("--cycles-per-frame must be greater than 0");
+
+		return opts;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	options opts;
+
+	try
+	{
+		opts = parse_options(argc, argv);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << "\n";
+		print_usage();
+		return EXIT_FAILURE;
+	}
+
+	using clock = std::chrono::steady_clock;
+
+	chip8 emu;
+	emu.seed_random(opts.seed);
+	emu.load_program(chip8_aot_entry.rom, chip8_aot_entry.rom_size);
+
+	aot_engine engine(emu, chip8_aot_entry);
+	uint64_t cycles = 0;
+
+	const auto run_start = clock::now();
+
+	// Each call stops exactly where the interpreter would tick the timers
+	while (cycles < opts.max_cycles)
+	{
+		const auto frame_cycles = opts.cycles_per_frame - (cycles % opts.cycles_per_frame);
+		cycles += engine.run(std::min<uint64_t>(frame_cycles, opts.max_cycles - cycles));
+
+		if (engine.halted())
+			break;
+
+		if (cycles % opts.cycles_per_frame == 0)
+			emu.tick_timers();
+	}
+
+	const auto run_end = clock::now();
+
+	std::cout << "{\"seed\": " << opts.seed
+		<< ", \"cycles\": " << cycles
+		<< ", \"halted\": " << (engine.halted() ? "true" : "false")
+		<< ", \"run_time_ms\": " << std::chrono::duration<double, std::milli>(run_end - run_start).count()
+		<< ", ";
+
+	write_json_state(std::cout, emu);
+	std::cout << "}\n";
+
+	return EXIT_SUCCESS;
+}
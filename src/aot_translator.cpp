@@ -0,0 +1,482 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "aot_engine.h"
+#include "chip8.h"
+#include "decoder.h"
+#include "rom_analysis.h"
+#include "rom_file.h"
+
+// chip8-aot translates a ROM into a C++ function with one label per reachable address. Jumps, skips and calls become
+// plain gotos, and only returns and BNNN jumps go through a switch on the program counter. Anything the translation
+// did not reach at build time is interpreted a single instruction at a time, which --interpret-indirect leaves every
+// BNNN target to rather than translating the 256 addresses each could reach.
+namespace
+{
+	// Display memory changes every frame, so instructions there are always interpreted
+	constexpr uint16_t translated_memory_end = chip8::display_memory_start - 1;
+
+	struct options
+	{
+		std::string name = "rom";
+		bool entry = false;
+		bool interpret_indirect = false;
+		std::string rom_file_path;
+		std::string output_file_path;
+	};
+
+	void print_usage()
+	{
+		std::cerr << "Usage: chip8-aot [--name NAME] [--entry] [--interpret-indirect] ROM OUTPUT\n";
+	}
+
+	options parse_options(const int argc, char* argv[])
+	{
+		options opts;
+		std::vector<std::string> paths;
+
+		for (auto i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+
+			if (arg == "--name" && i + 1 < argc)
+				opts.name = argv[++i];
+			else if (arg == "--entry")
+				opts.entry = true;
+			else if (arg == "--interpret-indirect")
+				opts.interpret_indirect = true;
+			else if (arg.rfind("--", 0) == 0)
+				throw std::invalid_argument("Unknown option \"" + arg + "\"");
+			else
+				paths.push_back(arg);
+		}
+
+		if (paths.size() != 2)
+			throw std::invalid_argument("Expected a ROM and an output file");
+
+		opts.rom_file_path = paths[0];
+		opts.output_file_path = paths[1];
+
+		return opts;
+	}
+
+	uint16_t fetch(const chip8& emu, const uint16_t address)
+	{
+		return static_cast<uint16_t>((emu.memory[address] << 8) | emu.memory[address + 1]);
+	}
+
+	std::string hex(const uint32_t value, const int width)
+	{
+		std::ostringstream out;
+		out << std::uppercase << std::hex << std::setw(width) << std::setfill('0') << value;
+		return out.str();
+	}
+
+	std::string label(const uint16_t address)
+	{
+		return "L_" + hex(address, 3);
+	}
+
+	std::string reg(const uint8_t index)
+	{
+		return "v[0x" + hex(index, 1) + "]";
+	}
+
+	// Marks the start of every instruction analyze_rom() finds. Returns and BNNN jumps are only known at runtime, so the
+	// address after every call and, unless they are left to the interpreter, every target of every BNNN are included.
+	std::vector<bool> find_reachable(const std::vector<uint8_t>& rom, const bool interpret_indirect)
+	{
+		const auto analysis = analyze_rom(rom.data(), rom.size(), !interpret_indirect);
+		std::vector<bool> reachable(translated_memory_end, false);
+
+		for (std::size_t offset = 0; offset < rom.size() && chip8::program_memory_start + offset < translated_memory_end; ++offset)
+			reachable[chip8::program_memory_start + offset] = analysis.instruction_starts[offset];
+
+		return reachable;
+	}
+
+	class translator
+	{
+	public:
+		translator(const chip8& emu, std::vector<bool> reachable, std::ostream& out)
+			: m_chip8(emu), m_out(out), m_reachable(std::move(reachable))
+		{
+		}
+
+		void write_function(const std::string& name)
+		{
+			m_out << "uint64_t " << name << "_run(chip8& emu, const uint64_t max_cycles, aot_status& status)\n"
+				<< "{\n"
+				<< "\tauto& v = emu.registers.data;\n"
+				<< "\tauto& address = emu.registers.address;\n"
+				<< "\tuint64_t cycles = 0;\n"
+				<< "\n"
+				<< "\tstatus = aot_status::running;\n"
+				<< "\tgoto dispatch;\n";
+
+			for (uint16_t address = 0; address < translated_memory_end; ++address)
+			{
+				if (m_reachable[address])
+					write_instruction(address);
+			}
+
+			write_dispatch();
+			m_out << "}\n";
+		}
+
+		void write_code_map()
+		{
+			aot_code_map code_map{};
+
+			for (uint16_t address = 0; address < translated_memory_end; ++address)
+			{
+				if (m_reachable[address])
+				{
+					code_map[address / 64] |= uint64_t{ 1 } << (address % 64);
+					code_map[(address + 1) / 64] |= uint64_t{ 1 } << ((address + 1) % 64);
+				}
+			}
+
+			m_out << "constexpr aot_code_map code_map = {";
+
+			for (std::size_t i = 0; i < code_map.size(); ++i)
+				m_out << (i % 4 == 0 ? "\n\t" : " ") << "0x" << hex(static_cast<uint32_t>(code_map[i] >> 32), 8) << hex(static_cast<uint32_t>(code_map[i]), 8) << ",";
+
+			m_out << "\n};\n";
+		}
+
+	private:
+		const chip8& m_chip8;
+		std::ostream& m_out;
+		std::vector<bool> m_reachable;
+
+		// Continues at address, through a label when it was translated and the dispatcher when it was not
+		std::string go_to(const uint32_t address) const
+		{
+			if (address < translated_memory_end && m_reachable[address])
+				return "goto " + label(static_cast<uint16_t>(address)) + ";";
+
+			return "{ emu.program_counter = 0x" + hex(address, 3) + "; goto dispatch; }";
+		}
+
+		void line(const std::string& text, const int depth = 1)
+		{
+			m_out << std::string(depth, '\t') << text << "\n";
+		}
+
+		void quit(const uint16_t address, const int depth)
+		{
+			// Like the interpreter, the instruction that quits is not counted
+			line("emu.program_counter = 0x" + hex(address, 3) + ";", depth);
+			line("status = aot_status::halted;", depth);
+			line("return cycles - 1;", depth);
+		}
+
+		void interpret(const uint16_t address, const uint16_t instruction, const int depth = 1)
+		{
+			line("emu.program_counter = 0x" + hex(address, 3) + ";", depth);
+			line("emu.evaluate_instruction(0x" + hex(instruction, 4) + ");", depth);
+		}
+
+		void skip_if(const uint16_t address, const std::string& condition)
+		{
+			line("if (" + condition + ")");
+			line("\t" + go_to(address + 4));
+
+			if (address + 2u != following(address))
+				line(go_to(address + 2));
+		}
+
+		void write_instruction(const uint16_t address)
+		{
+			const auto instruction = fetch(m_chip8, address);
+			const auto decoded = decode(instruction);
+			const auto vx = reg(decoded.x);
+			const auto vy = reg(decoded.y);
+			const auto vf = reg(0xF);
+			const auto nn = "0x" + hex(decoded.nn, 2);
+			const uint32_t next = address + 2;
+			auto falls_through = true;
+
+			m_out << "\n" << label(address) << ": // " << hex(instruction, 4) << "\n";
+			line("if (cycles++ == max_cycles)");
+			line("{");
+			line("\temu.program_counter = 0x" + hex(address, 3) + ";");
+			line("\treturn max_cycles;");
+			line("}");
+
+			if (instruction == 0)
+			{
+				quit(address, 1);
+				return;
+			}
+
+			switch (decoded.op)
+			{
+			case operation::return_from_subroutine:
+				line("if (emu.stack_pointer == 0)");
+				line("{");
+				quit(address, 2);
+				line("}");
+				line("emu.program_counter = emu.call_stack[--emu.stack_pointer];");
+				line("goto dispatch;");
+				falls_through = false;
+				break;
+			case operation::jump:
+				line(go_to(decoded.nnn));
+				falls_through = false;
+				break;
+			case operation::call:
+				line("if (emu.stack_pointer == chip8::max_stacks)");
+				line("{");
+				quit(address, 2);
+				line("}");
+				line("emu.call_stack[emu.stack_pointer++] = 0x" + hex(next, 3) + ";");
+				line(go_to(decoded.nnn));
+				falls_through = false;
+				break;
+			case operation::jump_with_offset:
+				line("emu.program_counter = 0x" + hex(decoded.nnn, 3) + " + v[0x0];");
+				line("goto dispatch;");
+				falls_through = false;
+				break;
+			case operation::skip_if_equal:
+				skip_if(address, vx + " == " + nn);
+				falls_through = false;
+				break;
+			case operation::skip_if_not_equal:
+				skip_if(address, vx + " != " + nn);
+				falls_through = false;
+				break;
+			case operation::skip_if_registers_equal:
+				skip_if(address, vx + " == " + vy);
+				falls_through = false;
+				break;
+			case operation::skip_if_registers_not_equal:
+				skip_if(address, vx + " != " + vy);
+				falls_through = false;
+				break;
+			case operation::skip_if_key_pressed:
+				skip_if(address, "emu.is_key_pressed(" + vx + ")");
+				falls_through = false;
+				break;
+			case operation::skip_if_key_not_pressed:
+				skip_if(address, "!emu.is_key_pressed(" + vx + ")");
+				falls_through = false;
+				break;
+			case operation::set_register:
+				line(vx + " = " + nn + ";");
+				break;
+			case operation::add_to_register:
+				line(vx + " += " + nn + ";");
+				break;
+			case operation::copy_register:
+				line(vx + " = " + vy + ";");
+				break;
+			case operation::or_registers:
+				line(vx + " |= " + vy + ";");
+				break;
+			case operation::and_registers:
+				line(vx + " &= " + vy + ";");
+				break;
+			case operation::xor_registers:
+				line(vx + " ^= " + vy + ";");
+				break;
+			case operation::add_registers:
+				line(vf + " = (" + vy + " > (0xFF - " + vx + ")) ? 1 : 0;");
+				line(vx + " += " + vy + ";");
+				break;
+			case operation::subtract_registers:
+				line(vf + " = (" + vy + " > " + vx + ") ? 0 : 1;");
+				line(vx + " -= " + vy + ";");
+				break;
+			case operation::shift_right:
+				line(vf + " = " + vx + " & 1;");
+				line(vx + " >>= 1;");
+				break;
+			case operation::subtract_reversed:
+				line(vf + " = (" + vx + " > " + vy + ") ? 0 : 1;");
+				line(vx + " = " + vy + " - " + vx + ";");
+				break;
+			case operation::shift_left:
+				line(vf + " = " + vx + " >> 7;");
+				line(vx + " <<= 1;");
+				break;
+			case operation::set_address:
+				line("address = 0x" + hex(decoded.nnn, 3) + ";");
+				break;
+			case operation::get_delay_timer:
+				line(vx + " = emu.delay_timer;");
+				break;
+			case operation::set_delay_timer:
+				line("emu.delay_timer = " + vx + ";");
+				break;
+			case operation::set_sound_timer:
+				line("emu.sound_timer = " + vx + ";");
+				break;
+			case operation::add_to_address:
+				line(vf + " = (" + vx + " + address > 0xFFF) ? 1 : 0;");
+				line("address += " + vx + ";");
+				break;
+			case operation::set_address_to_character:
+				line("address = " + vx + " * 5;");
+				break;
+			case operation::wait_for_key:
+				// The program counter only moves on once a key has been released
+				interpret(address, instruction);
+				line("if (emu.program_counter == 0x" + hex(address, 3) + ")");
+				line("\tgoto " + label(address) + ";");
+				break;
+			case operation::store_bcd:
+			case operation::store_registers:
+				{
+					const auto size = decoded.op == operation::store_bcd ? 3 : decoded.x + 1;
+
+					line("{");
+					line("\tconst auto target = address;");
+					interpret(address, instruction, 2);
+					line("\tif (aot_overlaps_code(code_map, target, " + std::to_string(size) + "))");
+					line("\t{");
+					line("\t\tstatus = aot_status::modified;");
+					line("\t\treturn cycles;");
+					line("\t}");
+					line("}");
+				}
+				break;
+			case operation::unknown:
+				// The interpreter never moves past an unknown instruction
+				line("goto " + label(address) + ";");
+				falls_through = false;
+				break;
+			default:
+				// Clearing the screen, drawing, random numbers and loading registers are left to the core
+				interpret(address, instruction);
+				break;
+			}
+
+			if (falls_through && !(next < translated_memory_end && m_reachable[next] && next == following(address)))
+				line(go_to(next));
+		}
+
+		// The next address after this one that gets a label, which the generated code falls through to
+		uint32_t following(const uint16_t address) const
+		{
+			for (uint32_t next = address + 1; next < translated_memory_end; ++next)
+			{
+				if (m_reachable[next])
+					return next;
+			}
+
+			return translated_memory_end;
+		}
+
+		void write_dispatch()
+		{
+			m_out << "\ndispatch:\n";
+			line("switch (emu.program_counter)");
+			line("{");
+
+			for (uint16_t address = 0; address < translated_memory_end; ++address)
+			{
+				if (m_reachable[address])
+					line("case 0x" + hex(address, 3) + ": goto " + label(address) + ";");
+			}
+
+			line("default:");
+			line("\t{");
+			line("\t\t// Never reached at build time, so interpret it instead, checking whether it writes over translated code");
+			line("\t\tif (cycles == max_cycles)");
+			line("\t\t\treturn cycles;");
+			line("");
+			line("\t\tconst auto target = address;");
+			line("\t\tconst auto stored = aot_store_size(emu);");
+			line("");
+			line("\t\tif (!emu.next_instruction())");
+			line("\t\t{");
+			line("\t\t\tstatus = aot_status::halted;");
+			line("\t\t\treturn cycles;");
+			line("\t\t}");
+			line("");
+			line("\t\t++cycles;");
+			line("");
+			line("\t\tif (stored > 0 && aot_overlaps_code(code_map, target, stored))");
+			line("\t\t{");
+			line("\t\t\tstatus = aot_status::modified;");
+			line("\t\t\treturn cycles;");
+			line("\t\t}");
+			line("");
+			line("\t\tgoto dispatch;");
+			line("\t}");
+			line("}");
+		}
+	};
+
+	void write_translation(std::ostream& out, const std::vector<uint8_t>& rom, const options& opts)
+	{
+		chip8 emu;
+		emu.load_program(rom.data(), rom.size());
+
+		translator translate(emu, find_reachable(rom, opts.interpret_indirect), out);
+
+		out << "// Translated from " << opts.rom_file_path << " by chip8-aot, do not edit\n"
+			<< "#include <array>\n"
+			<< "#include <cstdint>\n"
+			<< "\n"
+			<< "#include \"aot_engine.h\"\n"
+			<< "#include \"chip8.h\"\n"
+			<< "\n"
+			<< "namespace\n"
+			<< "{\n";
+
+		out << "constexpr std::array<uint8_t, " << rom.size() << "> rom = {";
+
+		for (std::size_t i = 0; i < rom.size(); ++i)
+			out << (i % 16 == 0 ? "\n\t" : " ") << "0x" << hex(rom[i], 2) << ",";
+
+		out << "\n};\n\n";
+
+		translate.write_code_map();
+		out << "\n";
+		translate.write_function(opts.name);
+
+		out << "}\n"
+			<< "\n"
+			<< "extern const aot_program " << opts.name << "_program = { rom.data(), rom.size(), &" << opts.name << "_run };\n";
+
+		if (opts.entry)
+			out << "extern const aot_program chip8_aot_entry = { rom.data(), rom.size(), &" << opts.name << "_run };\n";
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		const auto opts = parse_options(argc, argv);
+		const auto rom = read_rom_file(opts.rom_file_path);
+
+		std::ofstream out(opts.output_file_path);
+
+		if (!out.is_open())
+			throw std::runtime_error("Failed to open \"" + opts.output_file_path + "\" for writing");
+
+		write_translation(out, rom, opts);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << "\n";
+		print_usage();
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
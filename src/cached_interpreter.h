@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "chip8.h"
+#include "decoder.h"
+
+// Runs a chip8 from a table of instructions decoded ahead of time, instead of fetching and decoding every step.
+// Writes made by FX33 and FX55 re-decode the entries they overlap, but any other change to program memory
+// made from outside (such as loading a new program) must be followed by a call to invalidate().
+class cached_interpreter
+{
+public:
+	// Display memory changes every frame, so instructions there are always fetched and decoded directly
+	static constexpr uint16_t cached_memory_end = chip8::display_memory_start - 1;
+
+	constexpr explicit cached_interpreter(chip8& emu) noexcept
+		: m_chip8(emu)
+	{
+		invalidate();
+	}
+
+	constexpr void invalidate() noexcept
+	{
+		for (uint16_t address = 0; address < cached_memory_end; ++address)
+			m_cache[address] = fetch(address);
+	}
+
+	constexpr void invalidate(const uint16_t address, const uint16_t size) noexcept
+	{
+		// The instruction starting one byte before the write also overlaps it
+		for (uint32_t i = 0; i <= size; ++i)
+		{
+			const auto entry = chip8::wrap_address(address + i - 1);
+
+			if (entry < cached_memory_end)
+				m_cache[entry] = fetch(entry);
+		}
+	}
+
+	constexpr void run() noexcept
+	{
+		while (next_instruction()) {}
+	}
+
+	constexpr bool next_instruction() noexcept
+	{
+		const auto address = chip8::wrap_address(m_chip8.program_counter);
+
+		if (address >= cached_memory_end)
+			return m_chip8.next_instruction();
+
+		const auto& decoded = m_cache[address];
+
+		switch (decoded.op)
+		{
+		case operation::store_bcd:
+			return execute_store(decoded, 3);
+		case operation::store_registers:
+			return execute_store(decoded, decoded.x + 1);
+		default:
+			return decoded.instruction > 0 ? m_chip8.execute(decoded) : false;
+		}
+	}
+
+private:
+	chip8& m_chip8;
+	std::array<decoded_instruction, cached_memory_end> m_cache{};
+
+	[[nodiscard]] constexpr decoded_instruction fetch(const uint16_t address) const noexcept
+	{
+		return decode((m_chip8.memory[address] << 8) | m_chip8.memory[chip8::wrap_address(address + 1)]);
+	}
+
+	constexpr bool execute_store(const decoded_instruction& decoded, const uint16_t size) noexcept
+	{
+		const auto address = m_chip8.registers.address;
+		const auto continue_running = m_chip8.execute(decoded);
+
+		invalidate(address, size);
+
+		return continue_running;
+	}
+};
@@ -5,9 +5,33 @@
 #include <cstddef>
 #include <cstdint>
 
-#include <SFML/Window.hpp>
+#include "decoder.h"
+#include "machine_profile.h"
 
-class chip8
+// 32-bit FNV-1a hash of a string, used to derive a seed from the build time
+[[nodiscard]] constexpr uint32_t hash_seed(const char* text) noexcept
+{
+	uint32_t hash = 0x811C9DC5;
+
+	for (; *text != '\0'; ++text)
+	{
+		hash ^= static_cast<uint8_t>(*text);
+		hash *= 0x01000193;
+	}
+
+	return hash;
+}
+
+// The profiler basic_chip8::next_instruction() runs with, which compiles away to nothing
+struct null_profiler
+{
+	template<typename machine>
+	constexpr void record(const machine&, uint16_t, const decoded_instruction&) noexcept {}
+};
+
+// The interpreter for one of the machines in machine_profile.h, running with that machine's quirks unless given others
+template<typename profile, typename quirks = typename profile::quirks>
+class basic_chip8
 {
 public:
 	static constexpr std::array<uint8_t, 80> font = {
@@ -29,24 +53,77 @@ public:
 		0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 	};
 
+	// SUPER-CHIP's 8x10 digits for FX30, stored straight after the small font
+	static constexpr std::array<uint8_t, 160> large_font = {
+		0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+		0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+		0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+		0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+		0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+		0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+		0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+		0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+		0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+		0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+		0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+		0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+	};
+
+	static constexpr bool super_chip_opcodes = profile::opcodes != opcode_set::chip8;
+	static constexpr bool xo_chip_opcodes = profile::opcodes == opcode_set::xo_chip;
+
 	// Emulator specifications
-	static constexpr uint16_t memory_size = 4096;
-	static constexpr uint8_t display_width = 64;
-	static constexpr uint8_t display_height = 32;
-	static constexpr uint8_t max_stacks = 12;
+	static constexpr uint32_t memory_size = profile::memory_size;
+	static constexpr uint8_t display_width = profile::display_width;
+	static constexpr uint8_t display_height = profile::display_height;
+	static constexpr uint8_t display_planes = profile::display_planes;
+	static constexpr uint8_t max_stacks = profile::max_stacks;
+	static constexpr uint8_t timer_frequency = 60; // Hz
+	static constexpr uint8_t no_key = 0xFF; // Any of the 16 keys is 0 to F
 
 	// Sizes used for later calculations
 	static constexpr uint16_t display_memory_size = (display_width * display_height) / 8; // Each pixel is only a single bit
+	static constexpr uint16_t display_row_size = display_width / 8;
 	static constexpr uint16_t stack_size = max_stacks * 4; // 4 byte stack pointers
 	static constexpr uint16_t reserved_memory_size = 96; // Reserved for the call stack and address register
-	
-	static constexpr uint16_t display_memory_start = memory_size - display_memory_size;
-	static constexpr uint16_t call_stack_start = display_memory_start - reserved_memory_size;
+
+	// A display kept in memory takes the top of it, with the reserved area below, while any other display is stored
+	// after the last address programs can reach, one plane after another
+	static constexpr uint32_t display_memory_start = profile::display_in_memory ? memory_size - display_memory_size : memory_size;
+	static constexpr uint32_t call_stack_start = profile::display_in_memory ? display_memory_start - reserved_memory_size : memory_size;
+	static constexpr std::size_t memory_storage_size = display_memory_start + display_memory_size * display_planes;
 
 	static constexpr uint16_t program_memory_start = 512; // The first 512 bytes are for internal use only
-	static constexpr uint16_t program_memory_end = call_stack_start;
+	static constexpr uint32_t program_memory_end = call_stack_start;
+
+	// Seeds CXNN from the time the core was compiled, so pass an explicit seed to seed_random() for reproducible runs
+	static constexpr uint32_t build_seed = hash_seed(__DATE__ " " __TIME__) | 1;
 
 	static_assert(program_memory_end - program_memory_start > 0, "No memory for programs");
+	static_assert((memory_size & (memory_size - 1)) == 0, "Memory size must be a power of two");
+	static_assert(display_height <= 64, "Dirty rows are tracked in a 64-bit mask");
+	static_assert(!profile::display_in_memory || display_planes == 1, "Only a single display plane fits in memory");
+	static_assert(display_planes <= 8, "Planes are selected with an 8-bit mask");
+
+	// Snapshots start with a magic number, the format version and whether they hold all of memory or only changes.
+	// The version must be bumped whenever the layout below changes. Each machine has a magic number of its own.
+	static constexpr std::array<uint8_t, 4> state_magic = profile::state_magic;
+	static constexpr uint16_t state_version = 2;
+
+	enum class state_kind : uint8_t
+	{
+		full = 0,
+		delta = 1
+	};
+
+	static constexpr std::size_t state_header_size = state_magic.size() + 2 + 1;
+	static constexpr std::size_t extended_state_size = (super_chip_opcodes ? 1 + 1 + 16 + 16 + 1 : 0) + (quirks::wait_for_vblank ? 1 : 0);
+	static constexpr std::size_t machine_state_size = 16 + 2 + 2 + (max_stacks * 2) + 1 + 1 + 1 + 2 + 1 + 8 + 1 + 4 + extended_state_size;
+	static constexpr std::size_t state_size = state_header_size + machine_state_size + memory_storage_size;
 
 	struct
 	{
@@ -54,25 +131,37 @@ public:
 		uint16_t address = 0;
 	} registers;
 
-	std::array<uint8_t, memory_size> memory{};
+	std::array<uint8_t, memory_storage_size> memory{};
 	uint16_t program_counter = program_memory_start;
-	std::array<uint16_t, 12> call_stack{};
+	std::array<uint16_t, max_stacks> call_stack{};
 	uint8_t stack_pointer = 0;
 
 	uint8_t delay_timer = 60;
 	uint8_t sound_timer = 60;
 
-	std::array<uint8_t, 16> keybinds{};
-	bool draw_flag = false;
-	int key_press = 0;
+	uint16_t key_state = 0; // Bit N is set while key N is held, filled in by the frontend
+	bool draw_flag = false; // Set when the display changes, and cleared by the frontend once drawn
+	uint64_t dirty_rows = 0; // Bit N is set when display row N has changed since the frontend last drew it
+	uint8_t released_key = no_key; // The lowest key let go of at the last update that released one, until FX0A takes it
+
+	uint32_t random_state = build_seed; // xorshift32 state, which is never 0
+
+	// Only used by SUPER-CHIP and XO-CHIP
+	bool high_resolution = false;
+	uint8_t plane_mask = 1; // Bit N is set while display plane N is drawn to, scrolled and cleared
+	std::array<uint8_t, 16> flag_registers{}; // Written by FX75 and read by FX85, standing in for the HP-48's flags
+	std::array<uint8_t, 16> audio_pattern{}; // XO-CHIP's 1-bit sample buffer, loaded by F002
+	uint8_t pitch = 64; // XO-CHIP's playback rate for the sample buffer, set by FX3A
 
-	constexpr chip8() noexcept
+	bool vertical_blank = false; // Set when the timers tick, only used when DXYN waits for it
+
+	constexpr basic_chip8() noexcept
 	{
 		load_font();
 	}
 
 	template<std::size_t size>
-	constexpr chip8(const std::array<uint8_t, size>& program) noexcept
+	constexpr basic_chip8(const std::array<uint8_t, size>& program) noexcept
 	{
 		load_font();
 		load_program(program);
@@ -82,14 +171,25 @@ public:
 	{
 		for (auto i = 0; i < font.size(); ++i)
 			memory[i] = font[i];
+
+		if constexpr (super_chip_opcodes)
+		{
+			for (std::size_t i = 0; i < large_font.size(); ++i)
+				memory[font.size() + i] = large_font[i];
+		}
 	}
 
 	template<std::size_t size>
 	constexpr void load_program(const std::array<uint8_t, size>& program) noexcept
+	{
+		load_program(program.data(), size);
+	}
+
+	constexpr void load_program(const uint8_t* program, const std::size_t size) noexcept
 	{
 		assert(size <= program_memory_end - program_memory_start);
 
-		for (auto i = 0; i < size; ++i)
+		for (std::size_t i = 0; i < size; ++i)
 			memory[program_memory_start + i] = program[i];
 	}
 
@@ -99,346 +199,838 @@ public:
 	}
 
 	constexpr bool next_instruction() noexcept
+	{
+		null_profiler profiler;
+		return next_instruction(profiler);
+	}
+
+	// Reports every instruction that runs to profiler.record(emu, address, decoded) once it has run, except one that
+	// quits the program
+	template<typename profiler_type>
+	constexpr bool next_instruction(profiler_type& profiler) noexcept
 	{
 		// Memory is stored as single bytes, but instructions are two bytes each, so we combine OR them together
-		const uint16_t instruction = (memory[program_counter] << 8) | memory[program_counter + 1];
+		const auto address = wrap_address(program_counter);
+		const uint16_t instruction = (memory[address] << 8) | memory[wrap_address(program_counter + 1)];
+
+		if (instruction == 0)
+			return false;
 
-		return instruction > 0 ? evaluate_instruction(instruction) : false;
+		const auto decoded = decode<profile::opcodes>(instruction);
+
+		if (!execute(decoded))
+			return false;
+
+		profiler.record(*this, address, decoded);
+		return true;
 	}
 
 	constexpr bool evaluate_instruction(const uint16_t instruction) noexcept
 	{
-		bool continue_running = true;
-		const uint16_t opcode_major = instruction & 0xF000;
+		return execute(decode<profile::opcodes>(instruction));
+	}
 
-		draw_flag = false;
+	constexpr bool execute(const decoded_instruction& decoded) noexcept
+	{
+		bool continue_running = true;
+		const auto x = decoded.x;
+		const auto y = decoded.y;
+		const auto shift_source = quirks::shift_uses_vy ? y : x;
 
-		switch (opcode_major)
+		switch (decoded.op)
 		{
-		case 0x0000:
-			switch (instruction & 0x00FF)
+		case operation::clear_screen: // 00E0 - Clear screen
+			clear_screen();
+			program_counter += 2;
+			break;
+		case operation::return_from_subroutine: // 00EE - Return from subroutine
+			if (stack_pointer == 0)
 			{
-			case 0x00E0: // 00E0 - Clear screen
-				clear_screen();
-				draw_flag = true;
-
-				program_counter += 2;
+				// Quit program if we are in the starting subroutine
+				continue_running = false;
 				break;
-			case 0x00EE: // 00EE - Return from subroutine
-				if (stack_pointer == 0)
-				{
-					// Quit program if we are in the starting subroutine
-					continue_running = false;
-					break;
-				}
+			}
 
-				program_counter = call_stack[--stack_pointer];
+			program_counter = call_stack[--stack_pointer];
+			break;
+		case operation::jump: // 1NNN - Jump to address NNN
+			program_counter = decoded.nnn;
+			break;
+		case operation::call: // 2NNN - Call subroutine at NNN
+			if (stack_pointer == max_stacks)
+			{
+				// Quit program rather than overflow the call stack
+				continue_running = false;
 				break;
 			}
+
+			call_stack[stack_pointer++] = program_counter + 2;
+			program_counter = decoded.nnn;
 			break;
-		case 0x1000: // 1NNN - Jump to address NNN
-			{
-				const uint16_t jump_address = instruction & 0x0FFF;
+		case operation::skip_if_equal: // 3XNN - Skip next instruction if Vx = NN
+			if (registers.data[x] == decoded.nn)
+				skip_instruction();
 
-				program_counter = jump_address;
-			}
+			program_counter += 2;
 			break;
-		case 0x2000: // 2NNN - Call subroutine at NNN
-			{
-				const uint16_t subroutine_address = instruction & 0x0FFF;
+		case operation::skip_if_not_equal: // 4XNN - Skip next instruction if Vx =/= NN
+			if (registers.data[x] != decoded.nn)
+				skip_instruction();
 
-				auto x = program_counter + 2;
-				call_stack[stack_pointer++] = program_counter + 2;
-				program_counter = subroutine_address;
-			}
+			program_counter += 2;
 			break;
-		case 0x3000: // 3XNN - Skip next instruction if Vx = NN
-			{
-				const uint8_t registr = (instruction & 0x0F00) >> 8;
-				const uint8_t value = instruction & 0x00FF;
+		case operation::skip_if_registers_equal: // 5XY0 - Skip next instruction if Vx = Vy
+			if (registers.data[x] == registers.data[y])
+				skip_instruction();
 
-				if (registers.data[registr] == value)
-					program_counter += 2;
+			program_counter += 2;
+			break;
+		case operation::set_register: // 6XNN - Set Vx to NN
+			registers.data[x] = decoded.nn;
+			program_counter += 2;
+			break;
+		case operation::add_to_register: // 7XNN - Add NN to Vx
+			registers.data[x] += decoded.nn;
+			program_counter += 2;
+			break;
+		case operation::copy_register: // 8XY0 - Set Vx to Vy
+			registers.data[x] = registers.data[y];
+			program_counter += 2;
+			break;
+		case operation::or_registers: // 8XY1 - Set Vx to Vx OR Vy
+			registers.data[x] |= registers.data[y];
+			program_counter += 2;
+			break;
+		case operation::and_registers: // 8XY2 - Set Vx to Vx AND Vy
+			registers.data[x] &= registers.data[y];
+			program_counter += 2;
+			break;
+		case operation::xor_registers: // 8XY3 - Set Vx to Vx XOR Vy
+			registers.data[x] ^= registers.data[y];
+			program_counter += 2;
+			break;
+		case operation::add_registers: // 8XY4 - Add Vy to Vx, set Vf to 1 if there is a carry, and 0 otherwise
+			registers.data[0xF] = (registers.data[y] > (0xFF - registers.data[x])) ? 1 : 0;
+			registers.data[x] += registers.data[y];
+			program_counter += 2;
+			break;
+		case operation::subtract_registers: // 8XY5 - Subtract Vy from Vx, set Vf to 0 if there is a borrow, and 1 otherwise
+			registers.data[0xF] = (registers.data[y] > registers.data[x]) ? 0 : 1;
+			registers.data[x] -= registers.data[y];
+			program_counter += 2;
+			break;
+		case operation::shift_right: // 8XY6 - Store the least significant bit of Vx (or Vy) in Vf, and right shift it by 1 into Vx
+			registers.data[0xF] = registers.data[shift_source] & 1;
+			registers.data[x] = registers.data[shift_source] >> 1;
+			program_counter += 2;
+			break;
+		case operation::subtract_reversed: // 8XY7 - Set Vx to Vy - Vx, set Vf to 0 if there is a borrow, and 1 otherwise
+			registers.data[0xF] = (registers.data[x] > registers.data[y]) ? 0 : 1;
+			registers.data[x] = registers.data[y] - registers.data[x];
+			program_counter += 2;
+			break;
+		case operation::shift_left: // 8XYE - Store the most significant bit of Vx (or Vy) in Vf, and left shift it by 1 into Vx
+			registers.data[0xF] = registers.data[shift_source] >> 7;
+			registers.data[x] = static_cast<uint8_t>(registers.data[shift_source] << 1);
+			program_counter += 2;
+			break;
+		case operation::skip_if_registers_not_equal: // 9XY0 - Skip next instruction if Vx =/= Vy
+			if (registers.data[x] != registers.data[y])
+				skip_instruction();
 
-				program_counter += 2;
-			}
+			program_counter += 2;
 			break;
-		case 0x4000: // 4XNN - Skip next instruction if Vx =/= NN
+		case operation::set_address: // ANNN - Set the address register to NNN
+			registers.address = decoded.nnn;
+			program_counter += 2;
+			break;
+		case operation::jump_with_offset: // BNNN - Jump to address NNN + V0, or XNN + Vx
+			program_counter = decoded.nnn + registers.data[quirks::jump_uses_vx ? x : 0x0];
+			break;
+		case operation::random: // CXNN - Set Vx to a random number AND NN
+			registers.data[x] = random_byte() & decoded.nn;
+			program_counter += 2;
+			break;
+		case operation::draw_sprite: // DXYN - Draw sprite located at address register at (Vx,Vy), with a height of N
+			if constexpr (quirks::wait_for_vblank)
 			{
-				const uint8_t registr = (instruction & 0x0F00) >> 8;
-				const uint8_t value = instruction & 0x00FF;
-
-				if (registers.data[registr] != value)
-					program_counter += 2;
+				// Runs again until the timers tick, like FX0A waiting for a key
+				if (!vertical_blank)
+					break;
 
-				program_counter += 2;
+				vertical_blank = false;
 			}
+
+			draw_sprite(registers.data[x], registers.data[y], decoded.n);
+			program_counter += 2;
 			break;
-		case 0x5000: // 5XY0 - Skip next instruction if Vx = Vy
-			{
-				const uint8_t register_x = (instruction & 0x0F00) >> 8;
-				const uint8_t register_y = (instruction & 0x00F0) >> 4;
+		case operation::skip_if_key_pressed: // EX9E - Skip next instruction if key stored in Vx is pressed
+			if (is_key_pressed(registers.data[x]))
+				skip_instruction();
 
-				if (registers.data[register_x] == registers.data[register_y])
-					program_counter += 2;
+			program_counter += 2;
+			break;
+		case operation::skip_if_key_not_pressed: // EXA1 - Skip next instruction if key stored in Vx is not pressed
+			if (!is_key_pressed(registers.data[x]))
+				skip_instruction();
 
-				program_counter += 2;
-			}
+			program_counter += 2;
+			break;
+		case operation::get_delay_timer: // FX07 - Set Vx to the value of the delay timer
+			registers.data[x] = delay_timer;
+			program_counter += 2;
 			break;
-		case 0x6000: // 6XNN - Set Vx to NN
+		case operation::wait_for_key: // FX0A - Wait for a key to be pressed and released, and store it in Vx
+			if (released_key != no_key)
 			{
-				const uint8_t registr = (instruction & 0x0F00) >> 8;
-				const uint8_t value = instruction & 0x00FF;
-
-				registers.data[registr] = value;
+				registers.data[x] = released_key;
+				released_key = no_key;
 
 				program_counter += 2;
 			}
 			break;
-		case 0x7000: // 7XNN - Add NN to Vx
-			{
-				const uint8_t registr = (instruction & 0x0F00) >> 8;
-				const uint8_t value = instruction & 0x00FF;
+		case operation::set_delay_timer: // FX15 - Set the delay timer to Vx
+			delay_timer = registers.data[x];
+			program_counter += 2;
+			break;
+		case operation::set_sound_timer: // FX18 - Set the sound timer to Vx
+			sound_timer = registers.data[x];
+			program_counter += 2;
+			break;
+		case operation::add_to_address: // FX1E - Add Vx to address register, set Vf to 1 if there is an overflow, and 0 otherwise
+			registers.data[0xF] = (registers.data[x] + registers.address > 0xFFF) ? 1 : 0;
+			registers.address += registers.data[x];
+			program_counter += 2;
+			break;
+		case operation::set_address_to_character: // FX29 - Set address register to location of sprite for character in Vx
+			registers.address = registers.data[x] * 5;
+			program_counter += 2;
+			break;
+		case operation::store_bcd: // FX33 - Store binary-coded decimal representation of Vx in address register and next two locations
+			write_memory(registers.address, registers.data[x] / 100);
+			write_memory(registers.address + 1, (registers.data[x] / 10) % 10);
+			write_memory(registers.address + 2, registers.data[x] % 10);
+			program_counter += 2;
+			break;
+		case operation::store_registers: // FX55 - Store V0 to Vx in memory starting at address register
+			for (auto i = 0; i <= x; ++i)
+				write_memory(registers.address + i, registers.data[i]);
 
-				registers.data[registr] += value;
+			if constexpr (quirks::load_store_increments_address)
+				registers.address += x + 1;
 
-				program_counter += 2;
-			}
+			program_counter += 2;
 			break;
-		case 0x8000:
-			{
-				const uint8_t register_x = (instruction & 0x0F00) >> 8;
-				const uint8_t register_y = (instruction & 0x00F0) >> 4;
-
-				switch (instruction & 0x000F)
-				{
-				case 0x0000: // 8XY0 - Set Vx to Vy
-					registers.data[register_x] = registers.data[register_y];
-					program_counter += 2;
-					break;
-				case 0x0001: // 8XY1 - Set Vx to Vx OR Vy
-					registers.data[register_x] |= registers.data[register_y];
-					program_counter += 2;
-					break;
-				case 0x0002: // 8XY2 - Set Vx to Vx AND Vy
-					registers.data[register_x] &= registers.data[register_y];
-					program_counter += 2;
-					break;
-				case 0x0003: // 8XY3 - Set Vx to Vx XOR Vy
-					registers.data[register_x] ^= registers.data[register_y];
-					program_counter += 2;
-					break;
-				case 0x0004: // 8XY4 - Add Vy to Vx, set Vf to 1 if there is a carry, and 0 otherwise
-					registers.data[0xF] = (registers.data[register_y] > (0xFF - registers.data[register_x])) ? 1 : 0;
-					registers.data[register_x] += registers.data[register_y];
-					program_counter += 2;
-					break;
-				case 0x0005: // 8XY5 - Subtract Vy from Vx, set Vf to 0 if there is a borrow, and 1 otherwise
-					registers.data[0xF] = (registers.data[register_y] > registers.data[register_x]) ? 0 : 1;
-					registers.data[register_x] -= registers.data[register_y];
-					program_counter += 2;
-					break;
-				case 0x0006: // 8XY6 - Store the least significant bit of Vx in Yf, and right shift Vx by 1
-					registers.data[0xF] = registers.data[register_x] & 1;
-					registers.data[register_x] >>= 1;
-					program_counter += 2;
-					break;
-				case 0x0007: // 8XY7 - Set Vx to Vy - Vx, set Vf to 0 if there is a borrow, and 1 otherwise
-					registers.data[0xF] = (registers.data[register_x] > registers.data[register_y]) ? 0 : 1;
-					registers.data[register_x] = registers.data[register_y] - registers.data[register_x];
-					program_counter += 2;
-					break;
-				case 0x000E: // 8XYE - Store the most significant bit of Vx in Vf, and left shift Vx by 1
-					registers.data[0xF] = registers.data[register_x] >> 7;
-					registers.data[register_x] <<= 1;
-					program_counter += 2;
-					break;
-				}
-				break;
-			}
-		case 0x9000: // 9XY0 - Skip next instruction if Vx =/= Vy
-			{
-				const uint8_t register_x = (instruction & 0x0F00) >> 8;
-				const uint8_t register_y = (instruction & 0x00F0) >> 4;
+		case operation::load_registers: // FX65 - Fill V0 to Vx with values starting at address register
+			for (auto i = 0; i <= x; ++i)
+				registers.data[i] = memory[wrap_address(registers.address + i)];
 
-				if (registers.data[register_x] != registers.data[register_y])
-					program_counter += 2;
+			if constexpr (quirks::load_store_increments_address)
+				registers.address += x + 1;
 
-				program_counter += 2;
-			}
+			program_counter += 2;
 			break;
-		case 0xA000: // ANNN - Set the address register to NNN
-			{
-				const uint16_t value = instruction & 0x0FFF;
+		case operation::scroll_down: // 00CN - Scroll the display down N pixels
+			scroll_vertically(decoded.n);
+			program_counter += 2;
+			break;
+		case operation::scroll_right: // 00FB - Scroll the display right 4 pixels
+			scroll_horizontally(4);
+			program_counter += 2;
+			break;
+		case operation::scroll_left: // 00FC - Scroll the display left 4 pixels
+			scroll_horizontally(-4);
+			program_counter += 2;
+			break;
+		case operation::exit: // 00FD - Exit the interpreter
+			continue_running = false;
+			break;
+		case operation::low_resolution: // 00FE - Switch to 64x32 pixels
+			set_resolution(false);
+			program_counter += 2;
+			break;
+		case operation::high_resolution: // 00FF - Switch to 128x64 pixels
+			set_resolution(true);
+			program_counter += 2;
+			break;
+		case operation::set_address_to_large_character: // FX30 - Set address register to location of large sprite for digit in Vx
+			registers.address = static_cast<uint16_t>(font.size() + (registers.data[x] & 0xF) * 10);
+			program_counter += 2;
+			break;
+		case operation::store_flags: // FX75 - Store V0 to Vx in the flag registers
+			for (auto i = 0; i <= x; ++i)
+				flag_registers[i] = registers.data[i];
 
-				registers.address = value;
+			program_counter += 2;
+			break;
+		case operation::load_flags: // FX85 - Fill V0 to Vx from the flag registers
+			for (auto i = 0; i <= x; ++i)
+				registers.data[i] = flag_registers[i];
 
-				program_counter += 2;
-			}
+			program_counter += 2;
 			break;
-		case 0xB000: // BNNN - Jump to address NNN + V0
-			{
-				const uint16_t jump_address = (instruction & 0x0FFF) + registers.data[0x0];
+		case operation::scroll_up: // 00DN - Scroll the display up N pixels
+			scroll_vertically(-decoded.n);
+			program_counter += 2;
+			break;
+		case operation::store_register_range: // 5XY2 - Store Vx to Vy in memory starting at address register, counting down if X > Y
+			for (auto i = 0; i <= (x < y ? y - x : x - y); ++i)
+				write_memory(registers.address + i, registers.data[x < y ? x + i : x - i]);
 
-				program_counter = jump_address;
-			}
+			program_counter += 2;
 			break;
-		case 0xC000: // CXNN - Set Vx to a random number AND NN
-			{
-				const uint8_t registr = (instruction & 0x0F00) >> 8;
-				const uint8_t value = instruction & 0x00FF;
+		case operation::load_register_range: // 5XY3 - Fill Vx to Vy with values starting at address register, counting down if X > Y
+			for (auto i = 0; i <= (x < y ? y - x : x - y); ++i)
+				registers.data[x < y ? x + i : x - i] = memory[wrap_address(registers.address + i)];
 
-				// TODO: Generate random numbers at both compile-time and runtime
-				//m_registers[registr] = random_number() & value;
+			program_counter += 2;
+			break;
+		case operation::load_long_address: // F000 NNNN - Set the address register to the 16-bit NNNN that follows
+			registers.address = static_cast<uint16_t>((memory[wrap_address(program_counter + 2)] << 8) | memory[wrap_address(program_counter + 3)]);
+			program_counter += 4;
+			break;
+		case operation::select_planes: // FN01 - Draw to, scroll and clear the display planes in bitmask N
+			plane_mask = static_cast<uint8_t>(x & ((1 << display_planes) - 1));
+			program_counter += 2;
+			break;
+		case operation::load_audio_pattern: // F002 - Load the 16 byte sample buffer from address register
+			for (std::size_t i = 0; i < audio_pattern.size(); ++i)
+				audio_pattern[i] = memory[wrap_address(registers.address + i)];
 
-				program_counter += 2;
-			}
+			program_counter += 2;
 			break;
-		case 0xD000: // DXYN - Draw sprite located at address register at (Vx,Vy), with a height of N
-			{
-				const uint8_t register_x = (instruction & 0x0F00) >> 8;
-				const uint8_t register_y = (instruction & 0x00F0) >> 4;
-				const uint8_t height = instruction & 0x000F;
+		case operation::set_pitch: // FX3A - Set the sample buffer's playback rate to Vx
+			pitch = registers.data[x];
+			program_counter += 2;
+			break;
+		case operation::unknown:
+			break;
+		}
 
-				draw_sprite(registers.data[register_x], registers.data[register_y], height);
+		return continue_running;
+	}
 
+	// Steps over the instruction after the one running, which on XO-CHIP may be the four bytes of F000 NNNN
+	constexpr void skip_instruction() noexcept
+	{
+		if constexpr (xo_chip_opcodes)
+		{
+			if (memory[wrap_address(program_counter + 2)] == 0xF0 && memory[wrap_address(program_counter + 3)] == 0x00)
 				program_counter += 2;
-			}
-			break;
-		case 0xE000:
-			{
-				const uint8_t registr = (instruction & 0x0F00) >> 8;
-				const auto key_code = registers.data[registr];
+		}
 
-				switch (instruction & 0x00FF)
-				{
-				case 0x009E: // EX9E - Skip next instruction if key stored in Vx is pressed
-					if (sf::Keyboard::isKeyPressed(static_cast<sf::Keyboard::Key>(keybinds.at(key_code))))
-						program_counter += 2;
+		program_counter += 2;
+	}
 
-					program_counter += 2;
-					break;
-				case 0x00A1: // EXA1 - Skip next instruction if key stored in Vx is not pressed
-					if (!sf::Keyboard::isKeyPressed(static_cast<sf::Keyboard::Key>(keybinds.at(key_code))))
-						program_counter += 2;
+	constexpr void seed_random(const uint32_t seed) noexcept
+	{
+		// Scrambled so that small seeds do not start out with small numbers, and never 0 where xorshift gets stuck
+		const uint32_t scrambled = (seed ^ 0x2545F491) * 0x9E3779B9;
+		random_state = scrambled != 0 ? scrambled : 0x9E3779B9;
+	}
+
+	// Steps the xorshift32 generator, returning its top byte since the low bits are the weakest
+	constexpr uint8_t random_byte() noexcept
+	{
+		random_state ^= random_state << 13;
+		random_state ^= random_state >> 17;
+		random_state ^= random_state << 5;
 
-					program_counter += 2;
+		return static_cast<uint8_t>(random_state >> 24);
+	}
+
+	// Timers count down at timer_frequency independently of instructions, so the frontend decides when they tick
+	constexpr void tick_timers(const uint32_t ticks = 1) noexcept
+	{
+		delay_timer = (ticks < delay_timer) ? static_cast<uint8_t>(delay_timer - ticks) : 0;
+		sound_timer = (ticks < sound_timer) ? static_cast<uint8_t>(sound_timer - ticks) : 0;
+
+		if constexpr (quirks::wait_for_vblank)
+		{
+			if (ticks > 0)
+				vertical_blank = true;
+		}
+	}
+
+	constexpr void draw_sprite(const uint8_t x_pos, const uint8_t y_pos, const uint8_t height) noexcept
+	{
+		if constexpr (super_chip_opcodes)
+		{
+			draw_extended_sprite(x_pos, y_pos, height);
+			return;
+		}
+
+		// Each sprite row covers at most two display bytes, so it is XORed in a byte at a time rather than per pixel
+		const auto px = x_pos % display_width;
+		const auto shift = px % 8;
+		const auto column = px / 8;
+		const auto next_column = (column + 1) % display_row_size;
+
+		uint8_t collisions = 0;
+
+		for (auto y = 0; y < height; ++y)
+		{
+			if constexpr (quirks::clip_sprites)
+			{
+				if (y_pos % display_height + y >= display_height)
 					break;
-				}
 			}
-			break;
-		case 0xF000:
+
+			const auto py = (y_pos + y) % display_height;
+			const auto row = memory[wrap_address(registers.address + y)];
+
+			if (row == 0)
+				continue;
+
+			const auto left = static_cast<uint8_t>(row >> shift);
+			// Empty when the sprite is byte-aligned, or when it would wrap around to the left edge but is clipped
+			const auto right = (quirks::clip_sprites && next_column == 0) ? uint8_t{ 0 } : static_cast<uint8_t>(row << (8 - shift));
+
+			auto& left_byte = memory[display_memory_start + (py * display_row_size) + column];
+			auto& right_byte = memory[display_memory_start + (py * display_row_size) + next_column];
+
+			collisions |= (left_byte & left) | (right_byte & right);
+			left_byte ^= left;
+			right_byte ^= right;
+
+			dirty_rows |= uint64_t{ 1 } << py;
+		}
+
+		registers.data[0xF] = (collisions != 0) ? 1 : 0;
+		draw_flag = true;
+	}
+
+	// SUPER-CHIP and XO-CHIP sprites, where DXY0 draws 16x16 and low resolution doubles every pixel both ways. Each
+	// selected plane is drawn in turn, taking its rows from where the previous plane's left off.
+	constexpr void draw_extended_sprite(const uint8_t x_pos, const uint8_t y_pos, const uint8_t n) noexcept
+	{
+		const auto scale = resolution_scale();
+		const auto width = (n == 0) ? 16 : 8;
+		const auto height = (n == 0) ? 16 : n;
+		const auto px = (x_pos % (display_width / scale)) * scale;
+		const auto shift = px % 8;
+		const auto column = px / 8;
+		const auto line_bytes = (shift + width * scale + 7) / 8;
+
+		auto source = registers.address;
+		uint8_t collisions = 0;
+
+		for (uint8_t plane = 0; plane < display_planes; ++plane)
+		{
+			if (!is_plane_selected(plane))
+				continue;
+
+			for (auto y = 0; y < height; ++y, source += width / 8)
 			{
-				const uint8_t registr = (instruction & 0x0F00) >> 8;
+				// The row's pixels from the top bit down, widened to 32 so they can be doubled in low resolution
+				auto bits = uint32_t{ memory[wrap_address(source)] } << 24;
+
+				if (width == 16)
+					bits |= uint32_t{ memory[wrap_address(source + 1)] } << 16;
+
+				if (scale == 2)
+					bits = double_bits(static_cast<uint16_t>(bits >> 16));
 
-				switch (instruction & 0x00FF)
+				const auto logical_y = y_pos % (display_height / scale) + y;
+
+				if (bits == 0 || (quirks::clip_sprites && logical_y >= display_height / scale))
+					continue;
+
+				const auto line = uint64_t{ bits } << (32 - shift);
+
+				for (auto copy = 0; copy < scale; ++copy)
 				{
-				case 0x0007: // FX07 - Set Vx to the value of the delay timer
-					registers.data[registr] = delay_timer;
-					program_counter += 2;
-					break;
-				case 0x000A: // FX0A - Wait for a key press and store it in Vx
-					if (key_press > 0)
+					const auto py = (logical_y % (display_height / scale)) * scale + copy;
+					const auto row_start = plane_start(plane) + py * display_row_size;
+
+					for (auto i = 0; i < line_bytes; ++i)
 					{
-						registers.data[registr] = key_press;
-						key_press = 0;
+						if (quirks::clip_sprites && column + i >= display_row_size)
+							break;
 
-						program_counter += 2;
-					}
-					break;
-				case 0x0015: // FX15 - Set the delay timer to Vx
-					delay_timer = registers.data[registr];
-					program_counter += 2;
-					break;
-				case 0x0018: // FX18 - Set the sound timer to Vx
-					sound_timer = registers.data[registr];
-					program_counter += 2;
-					break;
-				case 0x001E: // FX1E - Add Vx to address register, set Vf to 1 if there is an overflow, and 0 otherwise
-					registers.data[0xF] = (registers.data[registr] + registers.address > 0xFFF) ? 1 : 0;
-					registers.address += registers.data[registr];
-					program_counter += 2;
-					break;
-				case 0x0029: // FX29 - Set address register to location of sprite for character in Vx
-					registers.address = registers.data[registr] * 5;
-					program_counter += 2;
-					break;
-				case 0x0033: // FX33 - Store binary-coded decimal representation of Vx in address register and next two locations
-					memory[registers.address] = registers.data[registr] / 100;
-					memory[registers.address + 1] = (registers.data[registr] / 10) % 10;
-					memory[registers.address + 2] = registers.data[registr] % 10;
-					program_counter += 2;
-					break;
-				case 0x0055: // FX55 - Store V0 to Vx in memory starting at address register
-					for (auto i = 0; i <= registr; ++i)
-						memory[registers.address + i] = registers.data[i];
+						const auto part = static_cast<uint8_t>(line >> (56 - i * 8));
+						auto& byte = memory[row_start + (column + i) % display_row_size];
 
-					program_counter += 2;
-					break;
-				case 0x0065: // FX65 - Fill V0 to Vx with values starting at address register
-					for (auto i = 0; i <= registr; ++i)
-						registers.data[i] = memory[registers.address + i];
+						collisions |= byte & part;
+						byte ^= part;
+					}
 
-					program_counter += 2;
-					break;
+					dirty_rows |= uint64_t{ 1 } << py;
 				}
 			}
-			break;
 		}
 
-		if (delay_timer > 0)
-			--delay_timer;
+		registers.data[0xF] = (collisions != 0) ? 1 : 0;
+		draw_flag = true;
+	}
 
-		if (sound_timer > 0)
-			--sound_timer;
+	// Moves the selected planes down by rows of the current resolution, or up if negative, clearing what is uncovered
+	constexpr void scroll_vertically(const int rows) noexcept
+	{
+		const auto distance = rows * resolution_scale();
 
-		return continue_running;
+		for (uint8_t plane = 0; plane < display_planes; ++plane)
+		{
+			if (!is_plane_selected(plane))
+				continue;
+
+			const auto start = plane_start(plane);
+
+			for (auto i = 0; i < display_height; ++i)
+			{
+				// Rows are copied away from the direction of the scroll, so none are overwritten before they are read
+				const auto y = (distance > 0) ? display_height - 1 - i : i;
+				const auto from = y - distance;
+
+				for (auto column = 0; column < display_row_size; ++column)
+				{
+					memory[start + y * display_row_size + column] =
+						(from >= 0 && from < display_height) ? memory[start + from * display_row_size + column] : 0;
+				}
+			}
+		}
+
+		mark_display_dirty();
 	}
 
-	constexpr void draw_sprite(const uint8_t x_pos, const uint8_t y_pos, const uint8_t height) noexcept
+	// Moves the selected planes right by pixels of the current resolution, or left if negative
+	constexpr void scroll_horizontally(const int pixels) noexcept
 	{
-		bool pixels_inverted = false;
+		const auto distance = pixels * resolution_scale();
 
-		for (auto y = 0; y < height; ++y)
+		for (uint8_t plane = 0; plane < display_planes; ++plane)
 		{
-			const auto py = (y_pos + y) % display_height;
-			const auto row = memory[registers.address + y];
+			if (!is_plane_selected(plane))
+				continue;
 
-			for (auto x = 0; x < 8; ++x)
+			for (auto y = 0; y < display_height; ++y)
 			{
-				const bool bit = (row >> (7 - (x % 8))) & 1;
+				const auto row_start = plane_start(plane) + y * display_row_size;
+				std::array<uint8_t, display_row_size> row{};
 
-				if (bit)
+				for (auto x = 0; x < display_width; ++x)
 				{
-					const auto px = (x_pos + x) % display_width;
-
-					if (is_pixel_set(px, py))
-						pixels_inverted = true;
+					const auto from = x - distance;
 
-					invert_pixel(px, py);
+					if (from >= 0 && from < display_width && ((memory[row_start + from / 8] >> (7 - from % 8)) & 1))
+						row[x / 8] |= 0x80 >> (x % 8);
 				}
+
+				for (auto column = 0; column < display_row_size; ++column)
+					memory[row_start + column] = row[column];
 			}
 		}
 
-		registers.data[0xF] = pixels_inverted ? 1 : 0;
-		draw_flag = true;
+		mark_display_dirty();
+	}
+
+	// Switching resolution clears every plane, as what was drawn would no longer line up
+	constexpr void set_resolution(const bool high) noexcept
+	{
+		high_resolution = high;
+
+		for (std::size_t i = display_memory_start; i < memory_storage_size; ++i)
+			memory[i] = 0;
+
+		mark_display_dirty();
+	}
+
+	// The number of display pixels each way that a program's pixel covers
+	[[nodiscard]] constexpr int resolution_scale() const noexcept
+	{
+		if constexpr (super_chip_opcodes)
+			return high_resolution ? 1 : 2;
+		else
+			return 1;
+	}
+
+	[[nodiscard]] constexpr bool is_plane_selected(const uint8_t plane) const noexcept
+	{
+		if constexpr (display_planes == 1)
+			return true;
+		else
+			return (plane_mask >> plane) & 1;
+	}
+
+	[[nodiscard]] static constexpr uint32_t plane_start(const uint8_t plane) noexcept
+	{
+		return display_memory_start + plane * display_memory_size;
+	}
+
+	// Doubles each of 16 pixels into 32, for drawing in low resolution, by spreading the bits apart and then
+	// filling in the gaps
+	[[nodiscard]] static constexpr uint32_t double_bits(const uint16_t bits) noexcept
+	{
+		uint32_t spread = bits;
+		spread = (spread | (spread << 8)) & 0x00FF00FF;
+		spread = (spread | (spread << 4)) & 0x0F0F0F0F;
+		spread = (spread | (spread << 2)) & 0x33333333;
+		spread = (spread | (spread << 1)) & 0x55555555;
+
+		return spread | (spread << 1);
+	}
+
+	// Updates the held keys, and remembers the lowest key let go of for FX0A, which like the COSMAC VIP's only
+	// finishes once the key is released. An update that releases nothing keeps the last release until FX0A takes it.
+	constexpr void set_key_state(const uint16_t keys) noexcept
+	{
+		const uint16_t released = key_state & ~keys;
+
+		for (uint8_t key = 0; key < 16; ++key)
+		{
+			if ((released >> key) & 1)
+			{
+				released_key = key;
+				break;
+			}
+		}
+
+		key_state = keys;
+	}
+
+	[[nodiscard]] constexpr bool is_key_pressed(const uint8_t key) const noexcept
+	{
+		return (key_state >> (key & 0xF)) & 1;
 	}
 
 	[[nodiscard]] constexpr bool is_pixel_set(const uint8_t x_pos, const uint8_t y_pos) const noexcept
 	{
-		const auto byte = memory[display_memory_start + (y_pos * display_width / 8) + (x_pos / 8)];
+		const auto byte = memory[display_memory_start + (y_pos * display_row_size) + (x_pos / 8)];
 		return (byte >> (7 - (x_pos % 8))) & 1;
 	}
 
 	constexpr void invert_pixel(const uint8_t x_pos, const uint8_t y_pos) noexcept
 	{
-		auto& byte = memory[display_memory_start + (y_pos * display_width / 8) + (x_pos / 8)];
+		auto& byte = memory[display_memory_start + (y_pos * display_row_size) + (x_pos / 8)];
 		byte ^= (1 << (7 - (x_pos % 8)));
 	}
 
 	constexpr void clear_screen() noexcept
 	{
-		for (auto i = 0; i < display_memory_size; ++i)
-			memory[display_memory_start + i] = 0;
+		for (uint8_t plane = 0; plane < display_planes; ++plane)
+		{
+			if (!is_plane_selected(plane))
+				continue;
+
+			for (auto i = 0; i < display_memory_size; ++i)
+				memory[plane_start(plane) + i] = 0;
+		}
+
+		mark_display_dirty();
+	}
+
+	constexpr void mark_display_dirty() noexcept
+	{
+		dirty_rows = (display_height == 64) ? ~uint64_t{ 0 } : (uint64_t{ 1 } << display_height) - 1;
+		draw_flag = true;
+	}
+
+	// Stores a byte on behalf of the program, keeping track of any writes that land in display memory
+	constexpr void write_memory(const uint32_t address, const uint8_t value) noexcept
+	{
+		const auto wrapped = wrap_address(address);
+		memory[wrapped] = value;
+
+		if constexpr (profile::display_in_memory)
+		{
+			if (wrapped >= display_memory_start)
+			{
+				dirty_rows |= uint64_t{ 1 } << ((wrapped - display_memory_start) / display_row_size);
+				draw_flag = true;
+			}
+		}
+	}
+
+	// Captures the whole machine in the versioned snapshot format, little-endian throughout
+	[[nodiscard]] constexpr std::array<uint8_t, state_size> save_state() const noexcept
+	{
+		std::array<uint8_t, state_size> state{};
+
+		write_state_header(state.data(), state_kind::full);
+		write_machine_state(state.data() + state_header_size);
+
+		for (std::size_t i = 0; i < memory_storage_size; ++i)
+			state[state_header_size + machine_state_size + i] = memory[i];
+
+		return state;
+	}
+
+	// Restores a snapshot made by save_state(), leaving the machine untouched and returning false if it is not valid
+	constexpr bool load_state(const uint8_t* state, const std::size_t size) noexcept
+	{
+		if (size != state_size || !check_state_header(state, state_kind::full) || !read_machine_state(state + state_header_size))
+			return false;
+
+		for (std::size_t i = 0; i < memory_storage_size; ++i)
+			memory[i] = state[state_header_size + machine_state_size + i];
+
+		return true;
+	}
+
+	constexpr void write_state_header(uint8_t* state, const state_kind kind) const noexcept
+	{
+		for (std::size_t i = 0; i < state_magic.size(); ++i)
+			state[i] = state_magic[i];
+
+		state[4] = state_version & 0xFF;
+		state[5] = state_version >> 8;
+		state[6] = static_cast<uint8_t>(kind);
+	}
+
+	[[nodiscard]] static constexpr bool check_state_header(const uint8_t* state, const state_kind kind) noexcept
+	{
+		for (std::size_t i = 0; i < state_magic.size(); ++i)
+		{
+			if (state[i] != state_magic[i])
+				return false;
+		}
+
+		return (state[4] | (state[5] << 8)) == state_version && state[6] == static_cast<uint8_t>(kind);
+	}
+
+	// Everything except memory, which takes up machine_state_size bytes
+	constexpr void write_machine_state(uint8_t* state) const noexcept
+	{
+		std::size_t position = 0;
+
+		const auto write = [&](const uint64_t value, const std::size_t size) {
+			for (std::size_t i = 0; i < size; ++i)
+				state[position++] = static_cast<uint8_t>(value >> (i * 8));
+		};
+
+		for (const auto value : registers.data)
+			write(value, 1);
+
+		write(registers.address, 2);
+		write(program_counter, 2);
+
+		for (const auto address : call_stack)
+			write(address, 2);
+
+		write(stack_pointer, 1);
+		write(delay_timer, 1);
+		write(sound_timer, 1);
+		write(key_state, 2);
+		write(draw_flag, 1);
+		write(dirty_rows, 8);
+		write(released_key, 1);
+		write(random_state, 4);
+
+		if constexpr (super_chip_opcodes)
+		{
+			write(high_resolution, 1);
+			write(plane_mask, 1);
+
+			for (const auto value : flag_registers)
+				write(value, 1);
+
+			for (const auto value : audio_pattern)
+				write(value, 1);
+
+			write(pitch, 1);
+		}
+
+		if constexpr (quirks::wait_for_vblank)
+			write(vertical_blank, 1);
+	}
+
+	// Returns false without changing anything if the state could never have been saved from a working machine
+	constexpr bool read_machine_state(const uint8_t* state) noexcept
+	{
+		std::size_t position = 0;
+
+		const auto read = [&](const std::size_t size) {
+			uint64_t value = 0;
+
+			for (std::size_t i = 0; i < size; ++i)
+				value |= uint64_t{ state[position++] } << (i * 8);
+
+			return value;
+		};
+
+		auto loaded_registers = registers;
+		std::array<uint16_t, max_stacks> loaded_call_stack{};
+
+		for (auto& value : loaded_registers.data)
+			value = static_cast<uint8_t>(read(1));
+
+		loaded_registers.address = static_cast<uint16_t>(read(2));
+		const auto loaded_program_counter = static_cast<uint16_t>(read(2));
+
+		for (auto& address : loaded_call_stack)
+			address = static_cast<uint16_t>(read(2));
+
+		const auto loaded_stack_pointer = static_cast<uint8_t>(read(1));
+		const auto loaded_delay_timer = static_cast<uint8_t>(read(1));
+		const auto loaded_sound_timer = static_cast<uint8_t>(read(1));
+		const auto loaded_key_state = static_cast<uint16_t>(read(2));
+		const auto loaded_draw_flag = read(1) != 0;
+		const auto loaded_dirty_rows = read(8);
+		const auto loaded_released_key = static_cast<uint8_t>(read(1));
+		const auto loaded_random_state = static_cast<uint32_t>(read(4));
+
+		if (loaded_stack_pointer > max_stacks || loaded_random_state == 0 || (loaded_released_key >= 16 && loaded_released_key != no_key))
+			return false;
+
+		if constexpr (super_chip_opcodes)
+		{
+			const auto loaded_high_resolution = read(1) != 0;
+			const auto loaded_plane_mask = static_cast<uint8_t>(read(1));
+
+			if ((loaded_plane_mask >> display_planes) != 0)
+				return false;
+
+			high_resolution = loaded_high_resolution;
+			plane_mask = loaded_plane_mask;
+
+			for (auto& value : flag_registers)
+				value = static_cast<uint8_t>(read(1));
+
+			for (auto& value : audio_pattern)
+				value = static_cast<uint8_t>(read(1));
+
+			pitch = static_cast<uint8_t>(read(1));
+		}
+
+		if constexpr (quirks::wait_for_vblank)
+			vertical_blank = read(1) != 0;
+
+		registers = loaded_registers;
+		program_counter = loaded_program_counter;
+		call_stack = loaded_call_stack;
+		stack_pointer = loaded_stack_pointer;
+		delay_timer = loaded_delay_timer;
+		sound_timer = loaded_sound_timer;
+		key_state = loaded_key_state;
+		draw_flag = loaded_draw_flag;
+		dirty_rows = loaded_dirty_rows;
+		released_key = loaded_released_key;
+		random_state = loaded_random_state;
+
+		return true;
+	}
+
+	// 64-bit FNV-1a hash of the display memory in every plane, for cheaply comparing frames between runs
+	[[nodiscard]] constexpr uint64_t display_hash() const noexcept
+	{
+		uint64_t hash = 0xCBF29CE484222325;
+
+		for (std::size_t i = display_memory_start; i < memory_storage_size; ++i)
+		{
+			hash ^= memory[i];
+			hash *= 0x100000001B3;
+		}
+
+		return hash;
+	}
+
+	// Addresses wrap around the end of memory rather than reading or writing past it
+	[[nodiscard]] static constexpr uint16_t wrap_address(const uint32_t address) noexcept
+	{
+		return static_cast<uint16_t>(address & (memory_size - 1));
 	}
 };
+
+using chip8 = basic_chip8<chip8_profile>;
+using super_chip = basic_chip8<super_chip_profile>;
+using xo_chip = basic_chip8<xo_chip_profile>;
@@ -0,0 +1,626 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "chip8.h"
+#include "decoder.h"
+
+// Runs many copies of a machine in lockstep, such as the same ROM with different seeds or inputs. Every field is stored
+// lane by lane, so that an instruction every lane has reached is carried out by loops over contiguous arrays, which the
+// compiler turns into SIMD instructions as wide as the target allows. Lanes whose program counter has diverged wait
+// while the group with the lowest program counter runs, which is usually where they join back up again. Operations
+// that index memory or the call stack separately for each lane fall back to a scalar loop over the lanes taking part.
+//
+// Each lane finishes in exactly the state a chip8 would, however the lanes were grouped along the way. At over 4 KiB
+// of memory per lane this is too large for the stack, so allocate it on the heap.
+template<std::size_t lanes>
+class chip8_batch
+{
+public:
+	static_assert(lanes > 0 && lanes <= 64, "Lanes are counted in 64-bit masks");
+
+	template<typename T>
+	using lane_array = std::array<T, lanes>;
+
+	// Indexed by register then lane, and by address then lane, so that the lanes of a single register, address or row
+	// of the display sit next to each other
+	alignas(64) std::array<lane_array<uint8_t>, 16> registers{};
+	alignas(64) std::array<lane_array<uint8_t>, chip8::memory_size> memory{};
+
+	alignas(64) lane_array<uint16_t> address{};
+	alignas(64) lane_array<uint16_t> program_counter{};
+	std::array<lane_array<uint16_t>, chip8::max_stacks> call_stack{};
+	lane_array<uint8_t> stack_pointer{};
+
+	lane_array<uint8_t> delay_timer{};
+	lane_array<uint8_t> sound_timer{};
+
+	lane_array<uint16_t> key_state{};
+	lane_array<uint8_t> released_key{};
+	lane_array<uint8_t> draw_flag{};
+	lane_array<uint64_t> dirty_rows{};
+	lane_array<uint32_t> random_state{};
+
+	lane_array<uint8_t> halted{}; // 0xFF once a lane's program has quit
+	lane_array<uint64_t> cycles{}; // Instructions run by each lane since it was set
+
+	constexpr chip8_batch() noexcept
+	{
+		const chip8 emu;
+
+		for (std::size_t lane = 0; lane < lanes; ++lane)
+			set_lane(lane, emu);
+	}
+
+	constexpr void set_lane(const std::size_t lane, const chip8& emu) noexcept
+	{
+		for (std::size_t i = 0; i < 16; ++i)
+			registers[i][lane] = emu.registers.data[i];
+
+		for (std::size_t i = 0; i < chip8::memory_size; ++i)
+			memory[i][lane] = emu.memory[i];
+
+		for (std::size_t i = 0; i < chip8::max_stacks; ++i)
+			call_stack[i][lane] = emu.call_stack[i];
+
+		address[lane] = emu.registers.address;
+		program_counter[lane] = emu.program_counter;
+		stack_pointer[lane] = emu.stack_pointer;
+		delay_timer[lane] = emu.delay_timer;
+		sound_timer[lane] = emu.sound_timer;
+		key_state[lane] = emu.key_state;
+		released_key[lane] = emu.released_key;
+		draw_flag[lane] = emu.draw_flag;
+		dirty_rows[lane] = emu.dirty_rows;
+		random_state[lane] = emu.random_state;
+		halted[lane] = 0;
+		cycles[lane] = 0;
+	}
+
+	[[nodiscard]] constexpr chip8 get_lane(const std::size_t lane) const noexcept
+	{
+		chip8 emu;
+
+		for (std::size_t i = 0; i < 16; ++i)
+			emu.registers.data[i] = registers[i][lane];
+
+		for (std::size_t i = 0; i < chip8::memory_size; ++i)
+			emu.memory[i] = memory[i][lane];
+
+		for (std::size_t i = 0; i < chip8::max_stacks; ++i)
+			emu.call_stack[i] = call_stack[i][lane];
+
+		emu.registers.address = address[lane];
+		emu.program_counter = program_counter[lane];
+		emu.stack_pointer = stack_pointer[lane];
+		emu.delay_timer = delay_timer[lane];
+		emu.sound_timer = sound_timer[lane];
+		emu.key_state = key_state[lane];
+		emu.released_key = released_key[lane];
+		emu.draw_flag = draw_flag[lane] != 0;
+		emu.dirty_rows = dirty_rows[lane];
+		emu.random_state = random_state[lane];
+
+		return emu;
+	}
+
+	// Runs every lane that has not quit for max_cycles instructions, or until it quits, returning how many
+	// instructions ran across all lanes
+	constexpr uint64_t run(const uint32_t max_cycles) noexcept
+	{
+		const auto initial = map([&](const std::size_t lane) { return halted[lane] ? 0 : max_cycles; });
+		auto remaining = initial;
+		auto active = map([&](const std::size_t lane) { return mask(remaining[lane] != 0); });
+
+		while (any(active))
+		{
+			uint16_t instruction = 0;
+			std::size_t leader = 0;
+			const auto group = select_group(active, leader, instruction);
+			auto ran = run_instruction(group, instruction);
+			uint32_t steps = 1;
+
+			// While every lane is at the same instruction, keep going without rescheduling until they split up, one
+			// quits, or the first of them runs out of cycles
+			if (equal(group, active))
+			{
+				const auto budget = lowest(remaining, active);
+
+				while (steps < budget && equal(ran, active) && equal(group_at(active, leader, instruction), active))
+				{
+					ran = run_instruction(active, instruction);
+					++steps;
+				}
+			}
+
+			// Lanes in the group ran every step but the last, which only the lanes in ran finished
+			for (std::size_t lane = 0; lane < lanes; ++lane)
+			{
+				remaining[lane] -= ((steps - 1) & static_cast<uint32_t>(-(group[lane] & 1))) + (ran[lane] & 1);
+				active[lane] = mask(remaining[lane] != 0) & ~halted[lane];
+			}
+		}
+
+		uint64_t total_cycles = 0;
+
+		for (std::size_t lane = 0; lane < lanes; ++lane)
+		{
+			const auto ran = initial[lane] - remaining[lane];
+			cycles[lane] += ran;
+			total_cycles += ran;
+		}
+
+		return total_cycles;
+	}
+
+	// Ticks the timers of every lane that is still running, as the frontend would between frames
+	constexpr void tick_timers(const uint32_t ticks = 1) noexcept
+	{
+		for (std::size_t lane = 0; lane < lanes; ++lane)
+		{
+			if (!halted[lane])
+			{
+				delay_timer[lane] = (ticks < delay_timer[lane]) ? static_cast<uint8_t>(delay_timer[lane] - ticks) : 0;
+				sound_timer[lane] = (ticks < sound_timer[lane]) ? static_cast<uint8_t>(sound_timer[lane] - ticks) : 0;
+			}
+		}
+	}
+
+	// Updates a lane's held keys, remembering the lowest key let go of for FX0A as chip8::set_key_state() does
+	constexpr void set_key_state(const std::size_t lane, const uint16_t keys) noexcept
+	{
+		const uint16_t released = key_state[lane] & ~keys;
+
+		for (uint8_t key = 0; key < 16; ++key)
+		{
+			if ((released >> key) & 1)
+			{
+				released_key[lane] = key;
+				break;
+			}
+		}
+
+		key_state[lane] = keys;
+	}
+
+	[[nodiscard]] constexpr bool all_halted() const noexcept
+	{
+		uint8_t running = 0;
+
+		for (std::size_t lane = 0; lane < lanes; ++lane)
+			running |= ~halted[lane];
+
+		return running == 0;
+	}
+
+private:
+	using lane_mask = lane_array<uint8_t>; // 0xFF for every lane taking part, and 0 for the rest
+
+	static constexpr uint64_t all_rows = (chip8::display_height == 64) ? ~uint64_t{ 0 } : (uint64_t{ 1 } << chip8::display_height) - 1;
+
+	// Lane masks and values are passed around by value, since uint8_t arrays reached through pointers or references
+	// might alias any part of the machine, which stops the compiler from vectorising the loops over them
+
+	[[nodiscard]] static constexpr uint8_t mask(const bool set) noexcept
+	{
+		return set ? 0xFF : 0;
+	}
+
+	[[nodiscard]] static constexpr bool any(const lane_mask lanes_set) noexcept
+	{
+		uint8_t set = 0;
+
+		for (std::size_t lane = 0; lane < lanes; ++lane)
+			set |= lanes_set[lane];
+
+		return set != 0;
+	}
+
+	// Calculates a value for every lane into an array of its own
+	template<typename function>
+	[[nodiscard]] static constexpr auto map(function&& calculate) noexcept
+	{
+		lane_array<decltype(calculate(std::size_t{}))> values{};
+
+		for (std::size_t lane = 0; lane < lanes; ++lane)
+			values[lane] = calculate(lane);
+
+		return values;
+	}
+
+	// Stores values into the lanes of the group, leaving the other lanes as they were
+	template<typename T, typename U>
+	static constexpr void blend(lane_array<T>& target, const lane_mask group, const lane_array<U> values) noexcept
+	{
+		for (std::size_t lane = 0; lane < lanes; ++lane)
+		{
+			const auto keep = static_cast<T>((group[lane] & 1) - 1); // Selects without a branch, which would not vectorise
+			target[lane] = (target[lane] & keep) | (static_cast<T>(values[lane]) & ~keep);
+		}
+	}
+
+	[[nodiscard]] static constexpr bool equal(const lane_mask lhs, const lane_mask rhs) noexcept
+	{
+		uint8_t difference = 0;
+
+		for (std::size_t lane = 0; lane < lanes; ++lane)
+			difference |= lhs[lane] ^ rhs[lane];
+
+		return difference == 0;
+	}
+
+	[[nodiscard]] static constexpr uint32_t lowest(const lane_array<uint32_t> values, const lane_mask group) noexcept
+	{
+		uint32_t result = 0xFFFFFFFF;
+
+		for (std::size_t lane = 0; lane < lanes; ++lane)
+		{
+			const auto value = group[lane] ? values[lane] : 0xFFFFFFFF;
+			result = value < result ? value : result;
+		}
+
+		return result;
+	}
+
+	// Picks the active lanes at the lowest program counter that are about to run the same instruction
+	[[nodiscard]] constexpr lane_mask select_group(const lane_mask active, std::size_t& leader, uint16_t& instruction) const noexcept
+	{
+		leader = 0;
+
+		while (!active[leader])
+			++leader;
+
+		auto group = group_at(active, leader, instruction);
+
+		// Lanes only need sorting out by program counter once they have split up
+		if (!equal(group, active))
+		{
+			uint16_t lowest_pc = 0xFFFF;
+
+			for (std::size_t lane = 0; lane < lanes; ++lane)
+			{
+				const uint16_t pc = active[lane] ? program_counter[lane] : 0xFFFF;
+				lowest_pc = pc < lowest_pc ? pc : lowest_pc;
+			}
+
+			while (!active[leader] || program_counter[leader] != lowest_pc)
+				++leader;
+
+			group = group_at(active, leader, instruction);
+		}
+
+		return group;
+	}
+
+	// The active lanes at the leader's program counter that are about to run the same instruction as it, since lanes at
+	// the same address may still have different code there if they have written over it
+	[[nodiscard]] constexpr lane_mask group_at(const lane_mask active, const std::size_t leader, uint16_t& instruction) const noexcept
+	{
+		const auto pc = program_counter[leader];
+		const auto pcs = program_counter;
+		const auto high = memory[chip8::wrap_address(pc)];
+		const auto low = memory[chip8::wrap_address(pc + 1)];
+
+		lane_mask group{};
+
+		for (std::size_t lane = 0; lane < lanes; ++lane)
+			group[lane] = active[lane] & mask(pcs[lane] == pc) & mask(high[lane] == high[leader]) & mask(low[lane] == low[leader]);
+
+		instruction = static_cast<uint16_t>((high[leader] << 8) | low[leader]);
+		return group;
+	}
+
+	// Returns the lanes that ran the instruction, which are the group less any lanes that quit
+	[[nodiscard]] constexpr lane_mask run_instruction(const lane_mask group, const uint16_t instruction) noexcept
+	{
+		return (instruction > 0) ? execute(decode(instruction), group) : halt(group);
+	}
+
+	[[nodiscard]] constexpr lane_mask halt(const lane_mask group) noexcept
+	{
+		for (std::size_t lane = 0; lane < lanes; ++lane)
+			halted[lane] |= group[lane];
+
+		return {};
+	}
+
+	// Moves every lane in the group on to the next instruction, or the one after where skip is set
+	constexpr void advance(const lane_mask group, const lane_mask skip = {}) noexcept
+	{
+		for (std::size_t lane = 0; lane < lanes; ++lane)
+			program_counter[lane] += group[lane] & (skip[lane] ? 4 : 2);
+	}
+
+	template<typename function>
+	constexpr void skip_if(const lane_mask group, function&& condition) noexcept
+	{
+		advance(group, map([&](const std::size_t lane) { return mask(condition(lane)); }));
+	}
+
+	// Sets Vx in every lane of the group, calculating every lane before storing any so the loops vectorise
+	template<typename function>
+	constexpr void set_register(const lane_mask group, const uint8_t index, function&& calculate) noexcept
+	{
+		blend(registers[index], group, map([&](const std::size_t lane) { return static_cast<uint8_t>(calculate(lane)); }));
+	}
+
+	[[nodiscard]] constexpr lane_mask execute(const decoded_instruction& decoded, lane_mask group) noexcept
+	{
+		const auto x = decoded.x;
+		const auto y = decoded.y;
+		const auto nn = decoded.nn;
+		const auto nnn = decoded.nnn;
+
+		// Read through references, so that later loops see the flags written by earlier ones, as Vx and Vy may be VF
+		const auto& vx = registers[x];
+		const auto& vy = registers[y];
+
+		switch (decoded.op)
+		{
+		case operation::clear_screen: // 00E0
+			for (uint32_t i = chip8::display_memory_start; i < chip8::memory_size; ++i)
+				blend(memory[i], group, lane_array<uint8_t>{});
+
+			blend(dirty_rows, group, map([](std::size_t) { return all_rows; }));
+			blend(draw_flag, group, map([](std::size_t) { return 1; }));
+			advance(group);
+			break;
+		case operation::return_from_subroutine: // 00EE
+			for (std::size_t lane = 0; lane < lanes; ++lane)
+			{
+				if (!group[lane])
+					continue;
+
+				if (stack_pointer[lane] == 0)
+				{
+					halted[lane] = 0xFF;
+					group[lane] = 0;
+				}
+				else
+				{
+					program_counter[lane] = call_stack[--stack_pointer[lane]][lane];
+				}
+			}
+			break;
+		case operation::jump: // 1NNN
+			blend(program_counter, group, map([&](std::size_t) { return nnn; }));
+			break;
+		case operation::call: // 2NNN
+			for (std::size_t lane = 0; lane < lanes; ++lane)
+			{
+				if (!group[lane])
+					continue;
+
+				if (stack_pointer[lane] == chip8::max_stacks)
+				{
+					halted[lane] = 0xFF;
+					group[lane] = 0;
+				}
+				else
+				{
+					call_stack[stack_pointer[lane]++][lane] = program_counter[lane] + 2;
+					program_counter[lane] = nnn;
+				}
+			}
+			break;
+		case operation::skip_if_equal: // 3XNN
+			skip_if(group, [&](const std::size_t lane) { return vx[lane] == nn; });
+			break;
+		case operation::skip_if_not_equal: // 4XNN
+			skip_if(group, [&](const std::size_t lane) { return vx[lane] != nn; });
+			break;
+		case operation::skip_if_registers_equal: // 5XY0
+			skip_if(group, [&](const std::size_t lane) { return vx[lane] == vy[lane]; });
+			break;
+		case operation::set_register: // 6XNN
+			set_register(group, x, [&](std::size_t) { return nn; });
+			advance(group);
+			break;
+		case operation::add_to_register: // 7XNN
+			set_register(group, x, [&](const std::size_t lane) { return vx[lane] + nn; });
+			advance(group);
+			break;
+		case operation::copy_register: // 8XY0
+			set_register(group, x, [&](const std::size_t lane) { return vy[lane]; });
+			advance(group);
+			break;
+		case operation::or_registers: // 8XY1
+			set_register(group, x, [&](const std::size_t lane) { return vx[lane] | vy[lane]; });
+			advance(group);
+			break;
+		case operation::and_registers: // 8XY2
+			set_register(group, x, [&](const std::size_t lane) { return vx[lane] & vy[lane]; });
+			advance(group);
+			break;
+		case operation::xor_registers: // 8XY3
+			set_register(group, x, [&](const std::size_t lane) { return vx[lane] ^ vy[lane]; });
+			advance(group);
+			break;
+		case operation::add_registers: // 8XY4
+			set_register(group, 0xF, [&](const std::size_t lane) { return vy[lane] > (0xFF - vx[lane]) ? 1 : 0; });
+			set_register(group, x, [&](const std::size_t lane) { return vx[lane] + vy[lane]; });
+			advance(group);
+			break;
+		case operation::subtract_registers: // 8XY5
+			set_register(group, 0xF, [&](const std::size_t lane) { return vy[lane] > vx[lane] ? 0 : 1; });
+			set_register(group, x, [&](const std::size_t lane) { return vx[lane] - vy[lane]; });
+			advance(group);
+			break;
+		case operation::shift_right: // 8XY6
+			set_register(group, 0xF, [&](const std::size_t lane) { return vx[lane] & 1; });
+			set_register(group, x, [&](const std::size_t lane) { return vx[lane] >> 1; });
+			advance(group);
+			break;
+		case operation::subtract_reversed: // 8XY7
+			set_register(group, 0xF, [&](const std::size_t lane) { return vx[lane] > vy[lane] ? 0 : 1; });
+			set_register(group, x, [&](const std::size_t lane) { return vy[lane] - vx[lane]; });
+			advance(group);
+			break;
+		case operation::shift_left: // 8XYE
+			set_register(group, 0xF, [&](const std::size_t lane) { return vx[lane] >> 7; });
+			set_register(group, x, [&](const std::size_t lane) { return vx[lane] << 1; });
+			advance(group);
+			break;
+		case operation::skip_if_registers_not_equal: // 9XY0
+			skip_if(group, [&](const std::size_t lane) { return vx[lane] != vy[lane]; });
+			break;
+		case operation::set_address: // ANNN
+			blend(address, group, map([&](std::size_t) { return nnn; }));
+			advance(group);
+			break;
+		case operation::jump_with_offset: // BNNN
+			blend(program_counter, group, map([&](const std::size_t lane) { return nnn + registers[0x0][lane]; }));
+			break;
+		case operation::random: // CXNN
+			blend(random_state, group, map([&](const std::size_t lane) {
+				auto state = random_state[lane];
+				state ^= state << 13;
+				state ^= state >> 17;
+				state ^= state << 5;
+
+				return state;
+			}));
+
+			set_register(group, x, [&](const std::size_t lane) { return (random_state[lane] >> 24) & nn; });
+			advance(group);
+			break;
+		case operation::draw_sprite: // DXYN
+			for (std::size_t lane = 0; lane < lanes; ++lane)
+			{
+				if (group[lane])
+					draw_sprite(lane, vx[lane], vy[lane], decoded.n);
+			}
+
+			advance(group);
+			break;
+		case operation::skip_if_key_pressed: // EX9E
+			skip_if(group, [&](const std::size_t lane) { return (uint32_t{ key_state[lane] } >> (vx[lane] & 0xF)) & 1; });
+			break;
+		case operation::skip_if_key_not_pressed: // EXA1
+			skip_if(group, [&](const std::size_t lane) { return !((uint32_t{ key_state[lane] } >> (vx[lane] & 0xF)) & 1); });
+			break;
+		case operation::get_delay_timer: // FX07
+			set_register(group, x, [&](const std::size_t lane) { return delay_timer[lane]; });
+			advance(group);
+			break;
+		case operation::wait_for_key: // FX0A
+			{
+				// Lanes without a released key stay on this instruction
+				const auto released = map([&](const std::size_t lane) { return static_cast<uint8_t>(group[lane] & mask(released_key[lane] != chip8::no_key)); });
+				set_register(released, x, [&](const std::size_t lane) { return released_key[lane]; });
+				blend(released_key, released, map([](std::size_t) { return chip8::no_key; }));
+				advance(released);
+			}
+			break;
+		case operation::set_delay_timer: // FX15
+			blend(delay_timer, group, vx);
+			advance(group);
+			break;
+		case operation::set_sound_timer: // FX18
+			blend(sound_timer, group, vx);
+			advance(group);
+			break;
+		case operation::add_to_address: // FX1E
+			set_register(group, 0xF, [&](const std::size_t lane) { return vx[lane] + address[lane] > 0xFFF ? 1 : 0; });
+			blend(address, group, map([&](const std::size_t lane) { return address[lane] + vx[lane]; }));
+			advance(group);
+			break;
+		case operation::set_address_to_character: // FX29
+			blend(address, group, map([&](const std::size_t lane) { return vx[lane] * 5; }));
+			advance(group);
+			break;
+		case operation::store_bcd: // FX33
+			for (std::size_t lane = 0; lane < lanes; ++lane)
+			{
+				if (!group[lane])
+					continue;
+
+				const auto value = vx[lane];
+				write_memory(lane, address[lane], value / 100);
+				write_memory(lane, address[lane] + 1, (value / 10) % 10);
+				write_memory(lane, address[lane] + 2, value % 10);
+			}
+
+			advance(group);
+			break;
+		case operation::store_registers: // FX55
+			for (std::size_t lane = 0; lane < lanes; ++lane)
+			{
+				if (!group[lane])
+					continue;
+
+				for (auto i = 0; i <= x; ++i)
+					write_memory(lane, address[lane] + i, registers[i][lane]);
+			}
+
+			advance(group);
+			break;
+		case operation::load_registers: // FX65
+			for (std::size_t lane = 0; lane < lanes; ++lane)
+			{
+				if (!group[lane])
+					continue;
+
+				for (auto i = 0; i <= x; ++i)
+					registers[i][lane] = memory[chip8::wrap_address(address[lane] + i)][lane];
+			}
+
+			advance(group);
+			break;
+		default: // Unknown instructions, which include every SUPER-CHIP and XO-CHIP opcode
+			break;
+		}
+
+		return group;
+	}
+
+	// chip8::write_memory() for a single lane
+	constexpr void write_memory(const std::size_t lane, const uint32_t address, const uint8_t value) noexcept
+	{
+		const auto wrapped = chip8::wrap_address(address);
+		memory[wrapped][lane] = value;
+
+		if (wrapped >= chip8::display_memory_start)
+		{
+			dirty_rows[lane] |= uint64_t{ 1 } << ((wrapped - chip8::display_memory_start) / chip8::display_row_size);
+			draw_flag[lane] = 1;
+		}
+	}
+
+	// chip8::draw_sprite() for a single lane
+	constexpr void draw_sprite(const std::size_t lane, const uint8_t x_pos, const uint8_t y_pos, const uint8_t height) noexcept
+	{
+		const auto px = x_pos % chip8::display_width;
+		const auto shift = px % 8;
+		const auto column = px / 8;
+		const auto next_column = (column + 1) % chip8::display_row_size;
+
+		uint8_t collisions = 0;
+
+		for (auto y = 0; y < height; ++y)
+		{
+			const auto py = (y_pos + y) % chip8::display_height;
+			const auto row = memory[chip8::wrap_address(address[lane] + y)][lane];
+
+			if (row == 0)
+				continue;
+
+			const auto left = static_cast<uint8_t>(row >> shift);
+			const auto right = static_cast<uint8_t>(row << (8 - shift));
+
+			auto& left_byte = memory[chip8::display_memory_start + (py * chip8::display_row_size) + column][lane];
+			auto& right_byte = memory[chip8::display_memory_start + (py * chip8::display_row_size) + next_column][lane];
+
+			collisions |= (left_byte & left) | (right_byte & right);
+			left_byte ^= left;
+			right_byte ^= right;
+
+			dirty_rows[lane] |= uint64_t{ 1 } << py;
+		}
+
+		registers[0xF][lane] = (collisions != 0) ? 1 : 0;
+		draw_flag[lane] = 1;
+	}
+};
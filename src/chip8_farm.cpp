@@ -0,0 +1,188 @@
+#include "chip8_farm.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+	// Indices of the machines a thread will run next. The owning thread takes from the back, which keeps a machine on
+	// the thread whose cache it is already in, while thieves take from the front.
+	struct alignas(64) work_queue
+	{
+		std::mutex mutex;
+		std::deque<std::size_t> slots;
+
+		bool pop_back(std::size_t& slot)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (slots.empty())
+				return false;
+
+			slot = slots.back();
+			slots.pop_back();
+			return true;
+		}
+
+		bool pop_front(std::size_t& slot)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (slots.empty())
+				return false;
+
+			slot = slots.front();
+			slots.pop_front();
+			return true;
+		}
+
+		void push_back(const std::size_t slot)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			slots.push_back(slot);
+		}
+	};
+
+	struct worker_stats
+	{
+		uint64_t cycles = 0;
+		uint64_t slices = 0;
+		uint64_t steals = 0;
+	};
+}
+
+chip8_farm::chip8_farm(const unsigned thread_count, const uint64_t slice_cycles, const uint32_t cycles_per_frame)
+	: m_thread_count(thread_count != 0 ? thread_count : std::max(1u, std::thread::hardware_concurrency())),
+	m_slice_cycles(std::max<uint64_t>(slice_cycles, 1)),
+	m_cycles_per_frame(std::max<uint32_t>(cycles_per_frame, 1))
+{
+}
+
+std::size_t chip8_farm::add(const chip8& emu, const uint64_t max_cycles)
+{
+	m_slots.push_back({ instance{ emu, max_cycles } });
+	return m_slots.size() - 1;
+}
+
+farm_stats chip8_farm::run()
+{
+	using clock = std::chrono::steady_clock;
+
+	farm_stats stats;
+	stats.threads = static_cast<unsigned>(std::min<std::size_t>(m_thread_count, std::max<std::size_t>(m_slots.size(), 1)));
+
+	std::vector<work_queue> queues(stats.threads);
+	std::vector<worker_stats> workers(stats.threads);
+	std::atomic<std::size_t> unfinished{ 0 };
+
+	for (std::size_t i = 0; i < m_slots.size(); ++i)
+	{
+		const auto& inst = m_slots[i].inst;
+
+		if (inst.halted || inst.cycles >= inst.max_cycles)
+			continue;
+
+		queues[i % queues.size()].slots.push_back(i);
+		++unfinished;
+	}
+
+	const auto work = [&](const std::size_t self)
+	{
+		auto& own = queues[self];
+		auto& worker = workers[self];
+
+		while (unfinished.load(std::memory_order_acquire) > 0)
+		{
+			std::size_t index;
+			auto found = own.pop_back(index);
+
+			for (std::size_t i = 1; !found && i < queues.size(); ++i)
+			{
+				found = queues[(self + i) % queues.size()].pop_front(index);
+				worker.steals += found;
+			}
+
+			// Every machine left is in the middle of a slice on another thread
+			if (!found)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			auto& inst = m_slots[index].inst;
+			worker.cycles += run_slice(inst);
+			++worker.slices;
+
+			if (inst.halted || inst.cycles >= inst.max_cycles)
+				unfinished.fetch_sub(1, std::memory_order_release);
+			else
+				own.push_back(index);
+		}
+	};
+
+	const auto run_start = clock::now();
+
+	// The calling thread works as well rather than sitting idle until the others finish
+	std::vector<std::thread> threads;
+	threads.reserve(stats.threads - 1);
+
+	for (std::size_t i = 1; i < stats.threads; ++i)
+		threads.emplace_back(work, i);
+
+	work(0);
+
+	for (auto& thread : threads)
+		thread.join();
+
+	const auto run_end = clock::now();
+
+	for (const auto& worker : workers)
+	{
+		stats.cycles += worker.cycles;
+		stats.slices += worker.slices;
+		stats.steals += worker.steals;
+	}
+
+	stats.run_time_ms = std::chrono::duration<double, std::milli>(run_end - run_start).count();
+	return stats;
+}
+
+std::size_t chip8_farm::size() const noexcept
+{
+	return m_slots.size();
+}
+
+unsigned chip8_farm::thread_count() const noexcept
+{
+	return m_thread_count;
+}
+
+const chip8_farm::instance& chip8_farm::operator[](const std::size_t index) const noexcept
+{
+	return m_slots[index].inst;
+}
+
+uint64_t chip8_farm::run_slice(instance& inst) const noexcept
+{
+	const auto slice_end = inst.cycles + std::min(m_slice_cycles, inst.max_cycles - inst.cycles);
+	const auto slice_start = inst.cycles;
+
+	// Timers tick on the same instructions as they would in a single uninterrupted run
+	while (inst.cycles < slice_end)
+	{
+		if (!inst.emu.next_instruction())
+		{
+			inst.halted = true;
+			break;
+		}
+
+		if (++inst.cycles % m_cycles_per_frame == 0)
+			inst.emu.tick_timers();
+	}
+
+	return inst.cycles - slice_start;
+}
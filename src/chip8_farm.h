@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "chip8.h"
+
+// Aggregate figures for a single chip8_farm::run()
+struct farm_stats
+{
+	uint64_t cycles = 0;
+	uint64_t slices = 0;
+	uint64_t steals = 0; // Slices a thread took from another thread's queue after running out of its own
+	unsigned threads = 0;
+	double run_time_ms = 0.0;
+
+	[[nodiscard]] double instructions_per_second() const noexcept
+	{
+		return run_time_ms > 0.0 ? cycles / (run_time_ms / 1000.0) : 0.0;
+	}
+};
+
+// Runs many independent machines across a pool of threads. Every machine runs in slices of a bounded number of
+// instructions, after which it goes back on the queue of whichever thread ran it, so that long-running ROMs cannot
+// starve the rest. Threads that run out of work steal the oldest slices from the others.
+class chip8_farm
+{
+public:
+	struct instance
+	{
+		chip8 emu;
+		uint64_t max_cycles = 0;
+		uint64_t cycles = 0;
+		bool halted = false;
+	};
+
+	// A thread count of 0 uses every hardware thread
+	explicit chip8_farm(unsigned thread_count = 0, uint64_t slice_cycles = 100000, uint32_t cycles_per_frame = 10);
+
+	// Adds a machine that will run until it quits or has run max_cycles instructions, returning its index
+	std::size_t add(const chip8& emu, uint64_t max_cycles);
+
+	// Runs every machine added so far to completion, blocking until they have all finished
+	farm_stats run();
+
+	[[nodiscard]] std::size_t size() const noexcept;
+	[[nodiscard]] unsigned thread_count() const noexcept;
+
+	[[nodiscard]] const instance& operator[](std::size_t index) const noexcept;
+
+private:
+	// Aligned so that machines run by different threads never share a cache line
+	struct alignas(64) slot
+	{
+		instance inst;
+	};
+
+	unsigned m_thread_count;
+	uint64_t m_slice_cycles;
+	uint32_t m_cycles_per_frame;
+	std::vector<slot> m_slots;
+
+	// Runs a single slice, returning how many instructions ran
+	uint64_t run_slice(instance& inst) const noexcept;
+};
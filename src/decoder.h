@@ -0,0 +1,231 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class operation : uint8_t
+{
+	clear_screen,                // 00E0
+	return_from_subroutine,      // 00EE
+	jump,                        // 1NNN
+	call,                        // 2NNN
+	skip_if_equal,               // 3XNN
+	skip_if_not_equal,           // 4XNN
+	skip_if_registers_equal,     // 5XY0
+	set_register,                // 6XNN
+	add_to_register,             // 7XNN
+	copy_register,               // 8XY0
+	or_registers,                // 8XY1
+	and_registers,               // 8XY2
+	xor_registers,               // 8XY3
+	add_registers,               // 8XY4
+	subtract_registers,          // 8XY5
+	shift_right,                 // 8XY6
+	subtract_reversed,           // 8XY7
+	shift_left,                  // 8XYE
+	skip_if_registers_not_equal, // 9XY0
+	set_address,                 // ANNN
+	jump_with_offset,            // BNNN
+	random,                      // CXNN
+	draw_sprite,                 // DXYN
+	skip_if_key_pressed,         // EX9E
+	skip_if_key_not_pressed,     // EXA1
+	get_delay_timer,             // FX07
+	wait_for_key,                // FX0A
+	set_delay_timer,             // FX15
+	set_sound_timer,             // FX18
+	add_to_address,              // FX1E
+	set_address_to_character,    // FX29
+	store_bcd,                   // FX33
+	store_registers,             // FX55
+	load_registers,              // FX65
+	scroll_down,                 // 00CN (SUPER-CHIP)
+	scroll_right,                // 00FB (SUPER-CHIP)
+	scroll_left,                 // 00FC (SUPER-CHIP)
+	exit,                        // 00FD (SUPER-CHIP)
+	low_resolution,              // 00FE (SUPER-CHIP)
+	high_resolution,             // 00FF (SUPER-CHIP)
+	set_address_to_large_character, // FX30 (SUPER-CHIP)
+	store_flags,                 // FX75 (SUPER-CHIP)
+	load_flags,                  // FX85 (SUPER-CHIP)
+	scroll_up,                   // 00DN (XO-CHIP)
+	store_register_range,        // 5XY2 (XO-CHIP)
+	load_register_range,         // 5XY3 (XO-CHIP)
+	load_long_address,           // F000 NNNN (XO-CHIP)
+	select_planes,               // FN01 (XO-CHIP)
+	load_audio_pattern,          // F002 (XO-CHIP)
+	set_pitch,                   // FX3A (XO-CHIP)
+	unknown                      // Anything else, which does nothing and leaves the program counter on it, so it runs forever
+};
+
+// The instruction sets a machine can decode, each of which extends the one before it
+enum class opcode_set : uint8_t
+{
+	chip8,
+	super_chip,
+	xo_chip
+};
+
+constexpr std::size_t operation_count = static_cast<std::size_t>(operation::unknown) + 1;
+
+// An instruction split into its operation and operands, so it only has to be decoded once
+struct decoded_instruction
+{
+	uint16_t instruction = 0;
+	operation op = operation::unknown;
+	uint8_t x = 0;
+	uint8_t y = 0;
+	uint8_t n = 0;
+	uint8_t nn = 0;
+	uint16_t nnn = 0;
+};
+
+// Opcodes outside the given set decode as unknown, and the checks for them compile away for plain CHIP-8
+template<opcode_set set = opcode_set::chip8>
+[[nodiscard]] constexpr operation decode_operation(const uint16_t instruction) noexcept
+{
+	constexpr bool super_chip = set != opcode_set::chip8;
+	constexpr bool xo_chip = set == opcode_set::xo_chip;
+
+	switch (instruction & 0xF000)
+	{
+	case 0x0000:
+		if constexpr (super_chip)
+		{
+			if ((instruction & 0xFFF0) == 0x00C0)
+				return operation::scroll_down;
+
+			if (xo_chip && (instruction & 0xFFF0) == 0x00D0)
+				return operation::scroll_up;
+
+			switch (instruction)
+			{
+			case 0x00FB: return operation::scroll_right;
+			case 0x00FC: return operation::scroll_left;
+			case 0x00FD: return operation::exit;
+			case 0x00FE: return operation::low_resolution;
+			case 0x00FF: return operation::high_resolution;
+			}
+		}
+
+		switch (instruction & 0x00FF)
+		{
+		case 0x00E0: return operation::clear_screen;
+		case 0x00EE: return operation::return_from_subroutine;
+		}
+		break;
+	case 0x1000: return operation::jump;
+	case 0x2000: return operation::call;
+	case 0x3000: return operation::skip_if_equal;
+	case 0x4000: return operation::skip_if_not_equal;
+	case 0x5000:
+		if constexpr (xo_chip)
+		{
+			switch (instruction & 0x000F)
+			{
+			case 0x0002: return operation::store_register_range;
+			case 0x0003: return operation::load_register_range;
+			}
+		}
+
+		return operation::skip_if_registers_equal;
+	case 0x6000: return operation::set_register;
+	case 0x7000: return operation::add_to_register;
+	case 0x8000:
+		switch (instruction & 0x000F)
+		{
+		case 0x0000: return operation::copy_register;
+		case 0x0001: return operation::or_registers;
+		case 0x0002: return operation::and_registers;
+		case 0x0003: return operation::xor_registers;
+		case 0x0004: return operation::add_registers;
+		case 0x0005: return operation::subtract_registers;
+		case 0x0006: return operation::shift_right;
+		case 0x0007: return operation::subtract_reversed;
+		case 0x000E: return operation::shift_left;
+		}
+		break;
+	case 0x9000: return operation::skip_if_registers_not_equal;
+	case 0xA000: return operation::set_address;
+	case 0xB000: return operation::jump_with_offset;
+	case 0xC000: return operation::random;
+	case 0xD000: return operation::draw_sprite;
+	case 0xE000:
+		switch (instruction & 0x00FF)
+		{
+		case 0x009E: return operation::skip_if_key_pressed;
+		case 0x00A1: return operation::skip_if_key_not_pressed;
+		}
+		break;
+	case 0xF000:
+		if constexpr (xo_chip)
+		{
+			switch (instruction)
+			{
+			case 0xF000: return operation::load_long_address;
+			case 0xF002: return operation::load_audio_pattern;
+			}
+
+			switch (instruction & 0x00FF)
+			{
+			case 0x0001: return operation::select_planes;
+			case 0x003A: return operation::set_pitch;
+			}
+		}
+
+		if constexpr (super_chip)
+		{
+			switch (instruction & 0x00FF)
+			{
+			case 0x0030: return operation::set_address_to_large_character;
+			case 0x0075: return operation::store_flags;
+			case 0x0085: return operation::load_flags;
+			}
+		}
+
+		switch (instruction & 0x00FF)
+		{
+		case 0x0007: return operation::get_delay_timer;
+		case 0x000A: return operation::wait_for_key;
+		case 0x0015: return operation::set_delay_timer;
+		case 0x0018: return operation::set_sound_timer;
+		case 0x001E: return operation::add_to_address;
+		case 0x0029: return operation::set_address_to_character;
+		case 0x0033: return operation::store_bcd;
+		case 0x0055: return operation::store_registers;
+		case 0x0065: return operation::load_registers;
+		}
+		break;
+	}
+
+	return operation::unknown;
+}
+
+template<opcode_set set = opcode_set::chip8>
+[[nodiscard]] constexpr decoded_instruction decode(const uint16_t instruction) noexcept
+{
+	decoded_instruction decoded;
+
+	decoded.instruction = instruction;
+	decoded.op = decode_operation<set>(instruction);
+	decoded.x = (instruction & 0x0F00) >> 8;
+	decoded.y = (instruction & 0x00F0) >> 4;
+	decoded.n = instruction & 0x000F;
+	decoded.nn = instruction & 0x00FF;
+	decoded.nnn = instruction & 0x0FFF;
+
+	return decoded;
+}
+
+// The opcode pattern an operation is decoded from, such as "8XY4"
+[[nodiscard]] constexpr const char* operation_pattern(const operation op) noexcept
+{
+	constexpr const char* patterns[operation_count] = {
+		"00E0", "00EE", "1NNN", "2NNN", "3XNN", "4XNN", "5XY0", "6XNN", "7XNN", "8XY0", "8XY1", "8XY2", "8XY3", "8XY4",
+		"8XY5", "8XY6", "8XY7", "8XYE", "9XY0", "ANNN", "BNNN", "CXNN", "DXYN", "EX9E", "EXA1", "FX07", "FX0A", "FX15",
+		"FX18", "FX1E", "FX29", "FX33", "FX55", "FX65", "00CN", "00FB", "00FC", "00FD", "00FE", "00FF", "FX30", "FX75",
+		"FX85", "00DN", "5XY2", "5XY3", "F000", "FN01", "F002", "FX3A", "????"
+	};
+
+	return patterns[static_cast<std::size_t>(op)];
+}
@@ -0,0 +1,183 @@
+#include "disassembler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "chip8.h"
+
+namespace
+{
+	std::string hex(const uint32_t value, const int width)
+	{
+		std::ostringstream out;
+		out << std::uppercase << std::hex << std::setw(width) << std::setfill('0') << value;
+		return out.str();
+	}
+
+	std::string reg(const uint8_t index)
+	{
+		return "V" + hex(index, 1);
+	}
+
+	std::string byte(const uint8_t value)
+	{
+		return "#" + hex(value, 2);
+	}
+
+	// Each row of a sprite is one byte of eight pixels
+	std::string pixels(const uint8_t row)
+	{
+		std::string drawn;
+
+		for (auto bit = 7; bit >= 0; --bit)
+			drawn += (row >> bit) & 1 ? '#' : '.';
+
+		return drawn;
+	}
+
+	uint16_t read_instruction(const uint8_t* rom, const std::size_t size, const std::size_t offset)
+	{
+		return offset + 1 < size ? static_cast<uint16_t>((rom[offset] << 8) | rom[offset + 1]) : 0;
+	}
+
+	std::string block_label(const uint32_t address)
+	{
+		return "block_" + hex(address, 3);
+	}
+}
+
+std::string disassemble(const decoded_instruction& decoded, const uint16_t long_address)
+{
+	const auto vx = reg(decoded.x);
+	const auto vy = reg(decoded.y);
+
+	switch (decoded.op)
+	{
+	case operation::clear_screen: return "CLS";
+	case operation::return_from_subroutine: return "RET";
+	case operation::jump: return "JP " + hex(decoded.nnn, 3);
+	case operation::call: return "CALL " + hex(decoded.nnn, 3);
+	case operation::skip_if_equal: return "SE " + vx + ", " + byte(decoded.nn);
+	case operation::skip_if_not_equal: return "SNE " + vx + ", " + byte(decoded.nn);
+	case operation::skip_if_registers_equal: return "SE " + vx + ", " + vy;
+	case operation::set_register: return "LD " + vx + ", " + byte(decoded.nn);
+	case operation::add_to_register: return "ADD " + vx + ", " + byte(decoded.nn);
+	case operation::copy_register: return "LD " + vx + ", " + vy;
+	case operation::or_registers: return "OR " + vx + ", " + vy;
+	case operation::and_registers: return "AND " + vx + ", " + vy;
+	case operation::xor_registers: return "XOR " + vx + ", " + vy;
+	case operation::add_registers: return "ADD " + vx + ", " + vy;
+	case operation::subtract_registers: return "SUB " + vx + ", " + vy;
+	case operation::shift_right: return "SHR " + vx + ", " + vy;
+	case operation::subtract_reversed: return "SUBN " + vx + ", " + vy;
+	case operation::shift_left: return "SHL " + vx + ", " + vy;
+	case operation::skip_if_registers_not_equal: return "SNE " + vx + ", " + vy;
+	case operation::set_address: return "LD I, " + hex(decoded.nnn, 3);
+	case operation::jump_with_offset: return "JP V0, " + hex(decoded.nnn, 3);
+	case operation::random: return "RND " + vx + ", " + byte(decoded.nn);
+	case operation::draw_sprite: return "DRW " + vx + ", " + vy + ", " + hex(decoded.n, 1);
+	case operation::skip_if_key_pressed: return "SKP " + vx;
+	case operation::skip_if_key_not_pressed: return "SKNP " + vx;
+	case operation::get_delay_timer: return "LD " + vx + ", DT";
+	case operation::wait_for_key: return "LD " + vx + ", K";
+	case operation::set_delay_timer: return "LD DT, " + vx;
+	case operation::set_sound_timer: return "LD ST, " + vx;
+	case operation::add_to_address: return "ADD I, " + vx;
+	case operation::set_address_to_character: return "LD F, " + vx;
+	case operation::store_bcd: return "LD B, " + vx;
+	case operation::store_registers: return "LD [I], " + vx;
+	case operation::load_registers: return "LD " + vx + ", [I]";
+	case operation::scroll_down: return "SCD " + hex(decoded.n, 1);
+	case operation::scroll_right: return "SCR";
+	case operation::scroll_left: return "SCL";
+	case operation::exit: return "EXIT";
+	case operation::low_resolution: return "LOW";
+	case operation::high_resolution: return "HIGH";
+	case operation::set_address_to_large_character: return "LD HF, " + vx;
+	case operation::store_flags: return "LD R, " + vx;
+	case operation::load_flags: return "LD " + vx + ", R";
+	case operation::scroll_up: return "SCU " + hex(decoded.n, 1);
+	case operation::store_register_range: return "SAVE " + vx + " - " + vy;
+	case operation::load_register_range: return "LOAD " + vx + " - " + vy;
+	case operation::load_long_address: return "LD I, LONG " + hex(long_address, 4);
+	case operation::select_planes: return "PLANE " + hex(decoded.x, 1);
+	case operation::load_audio_pattern: return "AUDIO";
+	case operation::set_pitch: return "PITCH " + vx;
+	case operation::unknown:
+	default:
+		return "??? " + hex(decoded.instruction, 4);
+	}
+}
+
+void write_disassembly(std::ostream& out, const uint8_t* rom, const std::size_t size, const rom_analysis& analysis)
+{
+	std::size_t block = 0;
+
+	for (std::size_t offset = 0; offset < size;)
+	{
+		const auto address = static_cast<uint32_t>(chip8::program_memory_start + offset);
+
+		// A block starting part way through another instruction is listed with the instruction that hides it
+		while (block < analysis.blocks.size() && analysis.blocks[block].start < address)
+			++block;
+
+		if (block < analysis.blocks.size() && analysis.blocks[block].start == address)
+		{
+			const auto& successors = analysis.blocks[block].successors;
+			out << "\n" << block_label(address) << ":";
+
+			for (std::size_t i = 0; i < successors.size(); ++i)
+				out << (i == 0 ? " ; -> " : ", ") << hex(successors[i], 3);
+
+			out << "\n";
+		}
+
+		if (analysis.instruction_starts[offset])
+		{
+			const auto instruction = read_instruction(rom, size, offset);
+			const auto length = std::min<std::size_t>(instruction_size(instruction), size - offset);
+
+			out << hex(address, 3) << "  " << hex(instruction, 4) << (length > 2 ? hex(read_instruction(rom, size, offset + 2), 4) : "    ")
+				<< "  " << disassemble(decode<opcode_set::xo_chip>(instruction), read_instruction(rom, size, offset + 2)) << "\n";
+
+			offset += length;
+		}
+		else
+		{
+			out << hex(address, 3) << "  " << hex(rom[offset], 2) << "        DB " << byte(rom[offset]) << " ; "
+				<< (analysis.sprite_data[offset] ? pixels(rom[offset]) : "unused") << "\n";
+
+			++offset;
+		}
+	}
+}
+
+void write_control_flow_graph(std::ostream& out, const uint8_t* rom, const std::size_t size, const rom_analysis& analysis)
+{
+	out << "digraph rom {\n"
+		<< "\tnode [shape=box, fontname=monospace];\n";
+
+	for (const auto& block : analysis.blocks)
+	{
+		out << "\t" << block_label(block.start) << " [label=\"";
+
+		for (auto address = block.start; address < block.end;)
+		{
+			const auto offset = address - chip8::program_memory_start;
+			const auto instruction = read_instruction(rom, size, offset);
+
+			out << hex(address, 3) << "  " << disassemble(decode<opcode_set::xo_chip>(instruction), read_instruction(rom, size, offset + 2))
+				<< "\\l";
+
+			address += instruction_size(instruction);
+		}
+
+		out << "\"];\n";
+
+		for (const auto successor : block.successors)
+			out << "\t" << block_label(block.start) << " -> " << block_label(successor) << ";\n";
+	}
+
+	out << "}\n";
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "decoder.h"
+#include "rom_analysis.h"
+
+// An instruction in the mnemonics of Cowgod's CHIP-8 reference, such as "LD V0, #05", extended with SUPER-CHIP's and
+// XO-CHIP's. F000 NNNN takes its address from the word after it, which is given as long_address.
+std::string disassemble(const decoded_instruction& decoded, uint16_t long_address = 0);
+
+// A listing of every byte of a ROM: reachable instructions under a heading for each basic block, sprites drawn as
+// rows of pixels, and anything else marked as unused
+void write_disassembly(std::ostream& out, const uint8_t* rom, std::size_t size, const rom_analysis& analysis);
+
+// The control-flow graph of the basic blocks as a Graphviz digraph
+void write_control_flow_graph(std::ostream& out, const uint8_t* rom, std::size_t size, const rom_analysis& analysis);
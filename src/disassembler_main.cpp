@@ -0,0 +1,128 @@
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "chip8.h"
+#include "disassembler.h"
+#include "rom_analysis.h"
+#include "rom_file.h"
+
+// chip8-disasm lists a ROM's reachable code by basic block, separating it from the sprites it draws and the bytes
+// nothing uses, or writes its control-flow graph for Graphviz. --trim writes the ROM without any unused bytes at its end.
+namespace
+{
+	struct options
+	{
+		bool graph = false;
+		std::string trim_file_path;
+		std::string rom_file_path;
+	};
+
+	void print_usage()
+	{
+		std::cerr << "Usage: chip8-disasm [--graph] [--trim OUTPUT] ROM\n";
+	}
+
+	options parse_options(const int argc, char* argv[])
+	{
+		options opts;
+
+		for (auto i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+
+			if (arg == "--graph")
+				opts.graph = true;
+			else if (arg == "--trim" && i + 1 < argc)
+				opts.trim_file_path = argv[++i];
+			else if (arg.rfind("--", 0) == 0)
+				throw std::invalid_argument("Unknown option \"" + arg + "\"");
+			else if (opts.rom_file_path.empty())
+				opts.rom_file_path = arg;
+			else
+				throw std::invalid_argument("Expected a single ROM");
+		}
+
+		if (opts.rom_file_path.empty())
+			throw std::invalid_argument("Expected a ROM");
+
+		return opts;
+	}
+
+	const char* machine_name(const machine_type machine)
+	{
+		switch (machine)
+		{
+		case machine_type::super_chip:
+			return "SUPER-CHIP";
+		case machine_type::xo_chip:
+			return "XO-CHIP";
+		case machine_type::chip8:
+		default:
+			return "CHIP-8";
+		}
+	}
+
+	void trim_rom(const std::vector<uint8_t>& rom, const rom_analysis& analysis, const std::string& file_path)
+	{
+		if (analysis.indirect_jumps)
+			throw std::runtime_error("The ROM jumps with BNNN to code that could not be followed, so it cannot be trimmed safely");
+
+		std::ofstream file(file_path, std::ios::binary);
+
+		if (!file.is_open())
+			throw std::runtime_error("Failed to open \"" + file_path + "\" for writing");
+
+		file.write(reinterpret_cast<const char*>(rom.data()), static_cast<std::streamsize>(analysis.used_size()));
+
+		if (!file)
+			throw std::runtime_error("Failed to write \"" + file_path + "\"");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	options opts;
+
+	try
+	{
+		opts = parse_options(argc, argv);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << "\n";
+		print_usage();
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		// XO-CHIP has the most program memory of any machine
+		const auto rom = read_rom_file(opts.rom_file_path, xo_chip::program_memory_end - xo_chip::program_memory_start);
+		const auto analysis = analyze_rom(rom.data(), rom.size());
+
+		if (opts.graph)
+			write_control_flow_graph(std::cout, rom.data(), rom.size(), analysis);
+		else
+			write_disassembly(std::cout, rom.data(), rom.size(), analysis);
+
+		std::cerr << rom.size() << " bytes: " << analysis.code_size() << " of code in " << analysis.blocks.size() << " blocks, "
+			<< analysis.sprite_data_size() << " of sprites and " << (rom.size() - analysis.used_size()) << " unused at the end. "
+			<< "Needs " << machine_name(analysis.machine) << (analysis.indirect_jumps ? ", and jumps with BNNN to code that could not be followed" : "")
+			<< ".\n";
+
+		if (!opts.trim_file_path.empty())
+			trim_rom(rom, analysis, opts.trim_file_path);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << "\n";
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -1,24 +1,39 @@
 #include "emulator.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
-#include <fstream>
 #include <ios>
+#include <iomanip>
 #include <iostream>
-#include <iterator>
+#include <random>
+#include <sstream>
 #include <stdexcept>
 #include <vector>
 
 #include "config_file.h"
+#include "rom_file.h"
+#include "snapshot.h"
 
-emulator::emulator(const std::string& rom_file_path)
+namespace
+{
+	std::chrono::nanoseconds elapsed_since(const std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+	}
+}
+
+emulator::emulator(const std::string& rom_file_path, const movie_mode mode, const std::string& movie_file_path)
+	: m_state_file_path(rom_file_path + ".state"), m_movie_mode(mode), m_movie_file_path(movie_file_path)
 {
 	load_config();
 	load_keybinds();
 	load_rom(rom_file_path);
+	start_movie();
 
 	generate_tone();
 	create_sprite();
+	create_pixel_lookup();
 }
 
 void emulator::run()
@@ -29,6 +44,29 @@ void emulator::run()
 		update();
 		render();
 	}
+
+	if (m_movie_mode == movie_mode::record)
+	{
+		m_movie.save(m_movie_file_path);
+		std::cout << "Saved " << m_movie.frame_count() << " frames to \"" << m_movie_file_path << "\"\n";
+	}
+}
+
+void emulator::save_state(const std::string& file_path) const
+{
+	save_state_file(file_path, m_chip8);
+}
+
+void emulator::load_state(const std::string& file_path)
+{
+	load_state_file(file_path, m_chip8);
+	m_rewind.clear();
+	m_idle_detector.reset();
+
+	// The display texture still shows the frame from before the load
+	m_chip8.mark_display_dirty();
+	m_cycle_budget = 0.0;
+	m_running = true;
 }
 
 void emulator::handle_events()
@@ -40,64 +78,249 @@ void emulator::handle_events()
 		{
 			m_window.close();
 		}
-		else if (event.type == sf::Event::KeyPressed)
+		else if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F3)
+		{
+			toggle_hud();
+		}
+		else if (event.type == sf::Event::KeyPressed && (event.key.code == sf::Keyboard::F5 || event.key.code == sf::Keyboard::F9))
 		{
-			for (auto i = 0; i < m_chip8.keybinds.size(); ++i)
+			// A failed quick save or load is reported rather than ending the session
+			try
 			{
-				if (m_chip8.keybinds[i] == event.key.code)
-					m_chip8.key_press = i;
+				if (event.key.code == sf::Keyboard::F5)
+					save_state(m_state_file_path);
+				else if (m_movie_mode != movie_mode::none)
+					std::cerr << "Save states cannot be loaded while recording or replaying a movie\n";
+				else
+					load_state(m_state_file_path);
 			}
+			catch (const std::exception& e)
+			{
+				std::cerr << e.what() << "\n";
+			}
+		}
+		else if (event.type == sf::Event::KeyPressed || event.type == sf::Event::KeyReleased)
+		{
+			// Bound keys are queued with when they arrived, to reach the machine at the matching point of a frame
+			const auto key = event.key.code != sf::Keyboard::Unknown ? m_key_lookup[event.key.code] : chip8::no_key;
+
+			if (key != chip8::no_key && event.type == sf::Event::KeyPressed)
+				m_input.press(key, input_queue::clock::now());
+			else if (key != chip8::no_key)
+				m_input.release(key, input_queue::clock::now());
+		}
+		else if (event.type == sf::Event::LostFocus)
+		{
+			m_input.release_all(input_queue::clock::now());
 		}
 	}
 }
 
 void emulator::update()
 {
-	static float total_time = 0.0f;
-	const auto delta = m_delta_clock.restart().asSeconds();
+	const auto frame_time = m_delta_clock.restart();
+	const auto delta = frame_time.asSeconds();
+	m_metrics.add_frame_time(std::chrono::microseconds(frame_time.asMicroseconds()));
+
+	update_timers();
+
+	m_frame_accumulator = std::min(m_frame_accumulator + delta, max_frames_per_update * frame_duration);
 
-	if (total_time >= 1.0f)
+	// The frames run here catch up on the real time the accumulator holds, which places each key event within them
+	const auto to_clock = [](const float seconds)
 	{
-		std::cout << "FPS: " << (1.0f / delta) << "\n";
-		total_time = 0.0f;
+		return std::chrono::duration_cast<input_queue::clock::duration>(std::chrono::duration<float>(seconds));
+	};
+
+	const auto frame_length = to_clock(frame_duration);
+	auto frame_start = input_queue::clock::now() - to_clock(m_frame_accumulator);
+
+	while (m_frame_accumulator >= frame_duration)
+	{
+		run_frame(frame_start, frame_start + frame_length);
+		m_frame_accumulator -= frame_duration;
+		frame_start += frame_length;
+	}
+
+	if (m_show_hud && m_hud_clock.getElapsedTime().asSeconds() >= hud_update_interval)
+		update_hud();
+}
+
+void emulator::run_frame(const input_queue::clock::time_point frame_start, const input_queue::clock::time_point frame_end)
+{
+	// Holding backspace steps back through the recorded frames instead of running new ones, unless a movie is
+	// recording or replaying, as it could not follow the jump
+	if (m_movie_mode == movie_mode::none && sf::Keyboard::isKeyPressed(sf::Keyboard::BackSpace))
+	{
+		rewind_frame();
+		return;
 	}
 
-	if (m_running)
+	if (!m_running)
+		return;
+
+	// Fractional clock speeds carry the remainder over to the next frame, and key events only land on instructions
+	// this frame runs
+	const auto cycles = next_frame_cycles(m_cycles_per_frame, m_cycle_budget);
+	const auto& input = next_frame_input(frame_start, frame_end, cycles);
+	apply_frame_input(m_chip8, input);
+
+	// The timers only change between frames and the keys at the changes in the input, so a program waiting for
+	// them can skip up to the next of those
+	const auto executed = run_frame_input(m_chip8, input, cycles, [this](const uint64_t count)
 	{
-		if (!m_chip8.next_instruction())
-			m_running = false;
+		uint64_t ran = 0;
+
+		for (; ran < count; ++ran)
+		{
+			if (!m_chip8.next_instruction(m_idle_detector))
+			{
+				m_running = false;
+				break;
+			}
+
+			ran += m_idle_detector.skip(count - ran - 1);
+		}
+
+		return ran;
+	});
 
-		if (m_chip8.sound_timer != 0)
-			m_tone.play();
+	// Counted once per frame, keeping the metrics out of the instruction loop
+	m_metrics.add_instructions(executed);
+	m_rewind.record(m_chip8);
+}
+
+void emulator::rewind_frame()
+{
+	if (!m_rewind.step_back(m_chip8))
+		return;
+
+	m_idle_detector.reset();
+
+	// The restored frame may have been drawn with different pixels, and may be from before the program quit
+	m_chip8.mark_display_dirty();
+	m_cycle_budget = 0.0;
+	m_pending_timer_ticks = 0;
+	m_running = true;
+}
+
+const movie_frame& emulator::next_frame_input(const input_queue::clock::time_point frame_start, const input_queue::clock::time_point frame_end, const uint64_t cycles)
+{
+	m_input.next_frame(frame_start, frame_end, cycles, m_frame_input);
+	m_frame_input.timer_ticks = static_cast<uint8_t>(std::min<uint32_t>(m_pending_timer_ticks, 0xFF));
+	m_pending_timer_ticks = 0;
+
+	if (m_movie_mode == movie_mode::replay && !m_movie_player.next(m_frame_input))
+	{
+		std::cout << "Replay finished, handing over to the keyboard\n";
+		m_movie_mode = movie_mode::none;
+	}
+	else if (m_movie_mode == movie_mode::record)
+	{
+		m_movie.record(m_frame_input);
+	}
+
+	return m_frame_input;
+}
+
+void emulator::update_timers()
+{
+	m_pending_timer_ticks += m_timer_clock.poll();
+
+	const auto playing = m_tone.getStatus() == sf::Sound::Playing;
+
+	if (m_chip8.sound_timer != 0 && !playing)
+	{
+		// The tone ran out while the sound timer still wanted it, leaving an audible gap before it restarts
+		if (m_tone_playing)
+			m_metrics.add_audio_underrun();
+
+		m_tone.play();
 	}
 
-	total_time += delta;
+	m_tone_playing = playing || m_chip8.sound_timer != 0;
 }
 
 void emulator::render()
 {
+	const auto render_start = std::chrono::steady_clock::now();
+
 	if (m_chip8.draw_flag)
 	{
-		m_window.clear();
+		const auto upload_start = std::chrono::steady_clock::now();
 
-		sf::Image frame;
-		frame.create(chip8::display_width, chip8::display_height);
+		// Consecutive dirty rows are uploaded together, and clean rows are skipped entirely
+		const auto dirty_rows = m_chip8.dirty_rows;
+		unsigned int row = 0;
 
-		for (auto y = 0; y < chip8::display_height; ++y)
+		while (row < chip8::display_height)
 		{
-			for (auto x = 0; x < chip8::display_width; ++x)
+			if (((dirty_rows >> row) & 1) == 0)
 			{
-				frame.setPixel(x, y, m_chip8.is_pixel_set(x, y) ? m_foreground_colour : m_background_colour);
+				++row;
+				continue;
 			}
+
+			const auto first_row = row;
+			while (row < chip8::display_height && ((dirty_rows >> row) & 1))
+				++row;
+
+			upload_rows(first_row, row - first_row);
 		}
 
-		m_frame_texture.update(frame);
-		m_window.draw(m_frame_sprite);
+		m_chip8.dirty_rows = 0;
+		m_chip8.draw_flag = false;
+		m_metrics.add_upload_time(elapsed_since(upload_start));
 	}
 
+	m_window.clear();
+	m_window.draw(m_frame_sprite);
+
+	if (m_show_hud)
+		m_window.draw(m_hud);
+
+	// Displaying waits for the frame rate limit or vsync, which is not part of the time spent rendering
+	m_metrics.add_render_time(elapsed_since(render_start));
 	m_window.display();
 }
 
+void emulator::upload_rows(const unsigned int first_row, const unsigned int row_count)
+{
+	const auto* const pixels = m_frame_pixels.convert_rows(m_chip8, first_row, row_count);
+	m_frame_texture.update(pixels, chip8::display_width, row_count, 0, first_row);
+}
+
+void emulator::toggle_hud()
+{
+	m_show_hud = !m_show_hud;
+
+	// The figures shown first cover the time since the overlay appeared, not since it was last hidden
+	m_hud_snapshot = m_metrics.snapshot();
+	m_hud_clock.restart();
+	m_hud.set_text("");
+}
+
+void emulator::update_hud()
+{
+	const auto elapsed = m_hud_clock.restart().asSeconds();
+	const auto snapshot = m_metrics.snapshot();
+	const auto interval = snapshot - m_hud_snapshot;
+	m_hud_snapshot = snapshot;
+
+	std::ostringstream text;
+	text << std::fixed << std::setprecision(2)
+		<< "MIPS " << interval.instructions / elapsed / 1e6 << "\n"
+		<< "FPS " << interval.frames / elapsed << "\n"
+		<< "FRAME MS P50 " << interval.frame_time_percentile(50.0) * 1000.0
+		<< " P95 " << interval.frame_time_percentile(95.0) * 1000.0
+		<< " P99 " << interval.frame_time_percentile(99.0) * 1000.0 << "\n"
+		<< "RENDER MS " << interval.mean_render_time() * 1000.0
+		<< " UPLOAD MS " << interval.mean_upload_time() * 1000.0 << "\n"
+		<< "AUDIO UNDERRUNS " << snapshot.audio_underruns;
+
+	m_hud.set_text(text.str());
+}
+
 void emulator::load_config()
 {
 	config_file config("window.cfg");
@@ -118,12 +341,37 @@ void emulator::load_config()
 	const auto width = config.get_value<unsigned int>("width");
 	const auto height = config.get_value<unsigned int>("height");
 	const auto title = config.get_value<std::string>("title");
-	const auto max_fps = config.get_value<unsigned int>("max_fps");
+	const auto refresh_rate = config.get_value<unsigned int>("refresh_rate");
 	const auto vsync = config.get_value<bool>("vsync");
 
 	m_window.create(sf::VideoMode(width.value_or(800), height.value_or(400)), title.value_or("CHIP-8"));
-	m_window.setFramerateLimit(max_fps.value_or(500));
+	m_window.setFramerateLimit(refresh_rate.value_or(60));
 	m_window.setVerticalSyncEnabled(vsync.value_or(false));
+
+	// A clock speed in Hz takes priority over a fixed number of instructions per frame
+	const auto clock_speed = config.get_value<double>("clock_speed");
+	const auto instructions_per_frame = config.get_value<unsigned int>("instructions_per_frame");
+
+	if (clock_speed)
+		m_cycles_per_frame = *clock_speed / frame_rate;
+	else
+		m_cycles_per_frame = instructions_per_frame.value_or(10);
+
+	// A fixed seed makes CXNN repeat the same numbers every run
+	const auto seed = config.get_value<uint32_t>("seed");
+	m_movie.seed = seed.value_or(std::random_device{}());
+
+	m_show_hud = config.get_value<bool>("show_hud").value_or(false);
+
+	// The metrics file is rewritten every metrics_interval seconds, for node_exporter's textfile collector
+	const auto metrics_file = config.get_value<std::string>("metrics_file");
+	const auto metrics_interval = config.get_value<double>("metrics_interval");
+
+	if (metrics_file)
+	{
+		const auto interval = std::chrono::milliseconds(static_cast<long long>(std::max(metrics_interval.value_or(5.0), 0.1) * 1000.0));
+		m_metrics_exporter = std::make_unique<metrics_exporter>(m_metrics, *metrics_file, interval);
+	}
 }
 
 void emulator::load_keybinds()
@@ -147,43 +395,60 @@ void emulator::load_keybinds()
 	const auto key_e = keybinds.get_value<uint8_t>("e");
 	const auto key_f = keybinds.get_value<uint8_t>("f");
 
-	m_chip8.keybinds.at(0) = key_0.value_or(sf::Keyboard::Num0);
-	m_chip8.keybinds.at(1) = key_1.value_or(sf::Keyboard::Num1);
-	m_chip8.keybinds.at(2) = key_2.value_or(sf::Keyboard::Num2);
-	m_chip8.keybinds.at(3) = key_3.value_or(sf::Keyboard::Num3);
-	m_chip8.keybinds.at(4) = key_4.value_or(sf::Keyboard::Num4);
-	m_chip8.keybinds.at(5) = key_5.value_or(sf::Keyboard::Num5);
-	m_chip8.keybinds.at(6) = key_6.value_or(sf::Keyboard::Num6);
-	m_chip8.keybinds.at(7) = key_7.value_or(sf::Keyboard::Num7);
-	m_chip8.keybinds.at(8) = key_8.value_or(sf::Keyboard::Num8);
-	m_chip8.keybinds.at(9) = key_9.value_or(sf::Keyboard::Num9);
-	m_chip8.keybinds.at(10) = key_a.value_or(sf::Keyboard::A);
-	m_chip8.keybinds.at(11) = key_b.value_or(sf::Keyboard::B);
-	m_chip8.keybinds.at(12) = key_c.value_or(sf::Keyboard::C);
-	m_chip8.keybinds.at(13) = key_d.value_or(sf::Keyboard::D);
-	m_chip8.keybinds.at(14) = key_e.value_or(sf::Keyboard::E);
-	m_chip8.keybinds.at(15) = key_f.value_or(sf::Keyboard::F);
+	std::array<sf::Keyboard::Key, 16> bound_keys{};
+	bound_keys.at(0) = static_cast<sf::Keyboard::Key>(key_0.value_or(sf::Keyboard::Num0));
+	bound_keys.at(1) = static_cast<sf::Keyboard::Key>(key_1.value_or(sf::Keyboard::Num1));
+	bound_keys.at(2) = static_cast<sf::Keyboard::Key>(key_2.value_or(sf::Keyboard::Num2));
+	bound_keys.at(3) = static_cast<sf::Keyboard::Key>(key_3.value_or(sf::Keyboard::Num3));
+	bound_keys.at(4) = static_cast<sf::Keyboard::Key>(key_4.value_or(sf::Keyboard::Num4));
+	bound_keys.at(5) = static_cast<sf::Keyboard::Key>(key_5.value_or(sf::Keyboard::Num5));
+	bound_keys.at(6) = static_cast<sf::Keyboard::Key>(key_6.value_or(sf::Keyboard::Num6));
+	bound_keys.at(7) = static_cast<sf::Keyboard::Key>(key_7.value_or(sf::Keyboard::Num7));
+	bound_keys.at(8) = static_cast<sf::Keyboard::Key>(key_8.value_or(sf::Keyboard::Num8));
+	bound_keys.at(9) = static_cast<sf::Keyboard::Key>(key_9.value_or(sf::Keyboard::Num9));
+	bound_keys.at(10) = static_cast<sf::Keyboard::Key>(key_a.value_or(sf::Keyboard::A));
+	bound_keys.at(11) = static_cast<sf::Keyboard::Key>(key_b.value_or(sf::Keyboard::B));
+	bound_keys.at(12) = static_cast<sf::Keyboard::Key>(key_c.value_or(sf::Keyboard::C));
+	bound_keys.at(13) = static_cast<sf::Keyboard::Key>(key_d.value_or(sf::Keyboard::D));
+	bound_keys.at(14) = static_cast<sf::Keyboard::Key>(key_e.value_or(sf::Keyboard::E));
+	bound_keys.at(15) = static_cast<sf::Keyboard::Key>(key_f.value_or(sf::Keyboard::F));
+
+	// Looked up by SFML key for every key event, rather than searching the bindings
+	m_key_lookup.fill(chip8::no_key);
+
+	// Keys SFML does not know about can never be pressed
+	for (uint8_t key = 0; key < bound_keys.size(); ++key)
+	{
+		if (bound_keys[key] >= 0 && bound_keys[key] < sf::Keyboard::KeyCount)
+			m_key_lookup[bound_keys[key]] = key;
+	}
 }
 
 void emulator::load_rom(const std::string& rom_file_path)
 {
-	std::ifstream file;
-	file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+	const auto result = load_rom_file(m_chip8, rom_file_path);
+	std::cout << "Loaded " << result.loaded_size << " bytes from \"" << rom_file_path << "\" in " << result.load_time_ms << " ms\n";
+}
 
-	try
+void emulator::start_movie()
+{
+	if (m_movie_mode == movie_mode::replay)
 	{
-		file.open(rom_file_path, std::ios::binary);
+		m_movie = movie::load(m_movie_file_path);
 
-		uint16_t count = 0;
-		std::for_each(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>(), [this, &count](const char c) {
-			m_chip8.memory[chip8::program_memory_start + count] = static_cast<uint8_t>(c);
-			++count;
-		});
+		if (m_movie.program_hash != program_hash(m_chip8))
+			throw std::runtime_error("\"" + m_movie_file_path + "\" was recorded with a different ROM");
+
+		m_cycles_per_frame = m_movie.cycles_per_frame;
 	}
-	catch (const std::ifstream::failure&)
+	else
 	{
-		throw std::runtime_error("Failed to open \"" + rom_file_path + "\"");
+		m_movie.cycles_per_frame = m_cycles_per_frame;
+		m_movie.program_hash = program_hash(m_chip8);
 	}
+
+	// Every run is seeded through the movie, even when nothing is being recorded
+	m_chip8.seed_random(m_movie.seed);
 }
 
 void emulator::generate_tone()
@@ -216,3 +481,13 @@ void emulator::create_sprite()
 	m_frame_sprite.setTexture(m_frame_texture);
 	m_frame_sprite.setScale(scale_x, scale_y);
 }
+
+void emulator::create_pixel_lookup()
+{
+	const auto& fg = m_foreground_colour;
+	const auto& bg = m_background_colour;
+	m_frame_pixels.set_colours({ fg.r, fg.g, fg.b, fg.a }, { bg.r, bg.g, bg.b, bg.a });
+
+	// The texture starts out undefined, so the whole frame is uploaded first
+	m_chip8.mark_display_dirty();
+}
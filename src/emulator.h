@@ -1,40 +1,103 @@
 #pragma once
 
+#include <array>
+#include <memory>
 #include <string>
 
 #include <SFML/Audio.hpp>
 #include <SFML/Graphics.hpp>
 
 #include "chip8.h"
+#include "hud.h"
+#include "idle_detector.h"
+#include "input_queue.h"
+#include "metrics.h"
+#include "movie.h"
+#include "rewind_buffer.h"
+#include "rgba_frame.h"
+#include "timer_clock.h"
 
 class emulator
 {
 public:
-	emulator(const std::string& rom_file_path);
+	enum class movie_mode
+	{
+		none,
+		record, // Saves every frame of input to the movie file when the window closes
+		replay // Feeds the frames from the movie file back in, then hands over to the keyboard
+	};
+
+	emulator(const std::string& rom_file_path, movie_mode mode = movie_mode::none, const std::string& movie_file_path = {});
 
 	void run();
 
+	// Full snapshots of the machine, throwing std::runtime_error if the file cannot be written or read
+	void save_state(const std::string& file_path) const;
+	void load_state(const std::string& file_path);
+
 private:
+	// CPU instructions are batched into frames emulated at a fixed rate, independent of the display rate
+	static constexpr float frame_rate = 60.0f;
+	static constexpr float frame_duration = 1.0f / frame_rate;
+	static constexpr unsigned int max_frames_per_update = 5; // Stops the emulator spiralling after a stall
+	static constexpr std::size_t rewind_seconds = 60;
+	static constexpr std::size_t rewind_capacity = 8 * 1024 * 1024; // Bytes, which rarely runs out before rewind_seconds
+	static constexpr float hud_pixel_size = 3.0f;
+	static constexpr float hud_update_interval = 0.5f; // Seconds between refreshes of the overlay's figures
+
 	sf::RenderWindow m_window;
 	sf::Clock m_delta_clock;
+	float m_frame_accumulator = 0.0f;
+	double m_cycles_per_frame = 10.0;
+	double m_cycle_budget = 0.0;
+	timer_clock m_timer_clock{ chip8::timer_frequency };
+	uint32_t m_pending_timer_ticks = 0; // Applied at the start of the next frame, so movies can record them
 
 	sf::Texture m_frame_texture;
 	sf::Sprite m_frame_sprite;
+	rgba_frame m_frame_pixels;
 	sf::SoundBuffer m_sound_buffer;
 
 	chip8 m_chip8;
+	std::string m_state_file_path; // Quick save slot next to the ROM
+	rewind_buffer m_rewind{ rewind_seconds * static_cast<std::size_t>(frame_rate), rewind_capacity };
+	movie_mode m_movie_mode;
+	std::string m_movie_file_path;
+	movie m_movie;
+	movie_player m_movie_player{ m_movie };
+	std::array<uint8_t, sf::Keyboard::KeyCount> m_key_lookup{}; // The CHIP-8 key bound to each key, or chip8::no_key
+	input_queue m_input;
+	movie_frame m_frame_input; // Kept between frames so its key changes reuse their storage
 	sf::Sound m_tone;
+	bool m_tone_playing = false; // As of the last check, so the tone running out early can be noticed
 	sf::Color m_foreground_colour;
 	sf::Color m_background_colour;
 	bool m_running = true;
+	idle_detector<chip8> m_idle_detector; // Skips instructions a program only spends waiting for a key or the timers
+
+	emulator_metrics m_metrics;
+	std::unique_ptr<metrics_exporter> m_metrics_exporter; // Only exists when a metrics file is configured
+	hud m_hud{ hud_pixel_size };
+	bool m_show_hud = false;
+	sf::Clock m_hud_clock;
+	metrics_snapshot m_hud_snapshot; // The totals when the overlay was last refreshed
 
 	void handle_events();
 	void update();
+	void run_frame(input_queue::clock::time_point frame_start, input_queue::clock::time_point frame_end);
+	void rewind_frame();
+	void update_timers();
+	const movie_frame& next_frame_input(input_queue::clock::time_point frame_start, input_queue::clock::time_point frame_end, uint64_t cycles);
 	void render();
+	void upload_rows(unsigned int first_row, unsigned int row_count);
+	void toggle_hud();
+	void update_hud();
 
 	void load_config();
 	void load_keybinds();
 	void load_rom(const std::string& rom_file_path);
+	void start_movie();
 	void generate_tone();
 	void create_sprite();
+	void create_pixel_lookup();
 };
@@ -0,0 +1,896 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "cached_interpreter.h"
+#include "chip8.h"
+#include "chip8_farm.h"
+#include "idle_detector.h"
+#include "jit_engine.h"
+#include "machine_dispatch.h"
+#include "movie.h"
+#include "profiler.h"
+#include "rom_cache.h"
+#include "rom_file.h"
+#include "rom_pack.h"
+#include "snapshot.h"
+#include "state_json.h"
+
+namespace
+{
+	enum class engine_type
+	{
+		interpreter,
+		cached,
+		jit
+	};
+
+	struct options
+	{
+		uint64_t max_cycles = 10000000;
+		uint32_t cycles_per_frame = 10; // Timers tick once every frame, as they do at 60 Hz in the emulator
+		uint32_t seed = chip8::build_seed; // Printed with the results so any run can be repeated
+		engine_type engine = engine_type::interpreter;
+		machine_type machine = machine_type::chip8; // Any other machine or quirks run in the interpreter built for them
+		quirk_type quirks = quirk_type::machine;
+		bool machine_given = false; // Otherwise the ROM cache picks the machine and quirks each ROM was detected as
+		std::string load_state_path; // Runs from a snapshot rather than a ROM when set
+		std::string save_state_path;
+		std::string replay_path; // Replays a recorded movie into the ROM instead of running with no input
+		std::string profile_path; // Profiles the run when either of these is set
+		std::string profile_stacks_path;
+		unsigned threads = 1; // Any more runs every ROM at once through a chip8_farm, and 0 uses every hardware thread
+		bool skip_idle = false; // Skips loops that only wait for the timers, which gives the same results sooner
+		oversized_rom oversized = oversized_rom::reject;
+		std::string rom_pack_path; // Runs every ROM in this archive rather than separate ROM files when set
+		std::shared_ptr<const rom_pack> pack;
+		std::string rom_cache_path; // Looks up the machine ROMs need and checks runs against known results when set
+		std::shared_ptr<const rom_cache> cache;
+		std::vector<std::string> rom_file_paths; // Or the names of the ROMs in the pack
+	};
+
+	// Instructions a farmed ROM runs before going back on the queue, long enough that queueing costs next to nothing
+	constexpr uint64_t farm_slice_cycles = 100000;
+
+	// How a run's final state compared with the result the ROM cache holds for the same run
+	enum class result_check
+	{
+		recorded, // There was none, so this run's is now the known result
+		matched,
+		mismatched
+	};
+
+	struct run_result
+	{
+		uint64_t cycles = 0;
+		bool halted = false;
+		bool truncated = false;
+		double load_time_ms = 0.0;
+		double run_time_ms = 0.0;
+		uint64_t idle_cycles = 0; // Included in cycles, but skipped rather than run
+		machine_type machine = machine_type::chip8; // What the ROM runs as, from the options or the ROM cache
+		quirk_type quirks = quirk_type::machine;
+		bool cache_hit = false; // The rest is only filled in with --rom-cache
+		rom_cache_entry cache_entry;
+		result_check check = result_check::recorded;
+	};
+
+	void print_usage()
+	{
+		std::cerr << "Usage: chip8-headless [--cycles N] [--cycles-per-frame N] [--seed N] [--engine interpreter|cached|jit]\n"
+			<< "                      [--save-state FILE] [--replay MOVIE] [--threads N] [--profile FILE] [--profile-stacks FILE]\n"
+			<< "                      [--truncate-roms] [--rom-cache DIR] [--skip-idle] ROM...\n"
+			<< "       chip8-headless [options] --rom-pack TAR\n"
+			<< "       chip8-headless [--cycles N] [--cycles-per-frame N] [--seed N] [--machine chip8|schip|xochip]\n"
+			<< "                      [--quirks machine|chip8|vip|schip|xochip] ROM...\n"
+			<< "       chip8-headless [options] --load-state FILE\n";
+	}
+
+	engine_type parse_engine(const std::string& engine)
+	{
+		if (engine == "interpreter")
+			return engine_type::interpreter;
+		else if (engine == "cached")
+			return engine_type::cached;
+		else if (engine == "jit")
+			return engine_type::jit;
+
+		throw std::invalid_argument("Unknown engine \"" + engine + "\"");
+	}
+
+	machine_type parse_machine(const std::string& machine)
+	{
+		if (machine == "chip8")
+			return machine_type::chip8;
+		else if (machine == "schip")
+			return machine_type::super_chip;
+		else if (machine == "xochip")
+			return machine_type::xo_chip;
+
+		throw std::invalid_argument("Unknown machine \"" + machine + "\"");
+	}
+
+	const char* quirks_name(const quirk_type quirks)
+	{
+		switch (quirks)
+		{
+		case quirk_type::cosmac_vip:
+			return "vip";
+		case quirk_type::super_chip:
+			return "schip";
+		case quirk_type::xo_chip:
+			return "xochip";
+		case quirk_type::machine:
+			return "machine";
+		case quirk_type::chip8:
+		default:
+			return "chip8";
+		}
+	}
+
+	const char* machine_name(const machine_type machine)
+	{
+		switch (machine)
+		{
+		case machine_type::super_chip:
+			return "schip";
+		case machine_type::xo_chip:
+			return "xochip";
+		case machine_type::chip8:
+		default:
+			return "chip8";
+		}
+	}
+
+	quirk_type parse_quirks(const std::string& quirks)
+	{
+		if (quirks == "machine")
+			return quirk_type::machine;
+		else if (quirks == "chip8")
+			return quirk_type::chip8;
+		else if (quirks == "vip")
+			return quirk_type::cosmac_vip;
+		else if (quirks == "schip")
+			return quirk_type::super_chip;
+		else if (quirks == "xochip")
+			return quirk_type::xo_chip;
+
+		throw std::invalid_argument("Unknown quirks \"" + quirks + "\"");
+	}
+
+	// Plain CHIP-8 with its own quirks can run in any engine, while anything else only has an interpreter
+	bool uses_other_machine(const machine_type machine, const quirk_type quirks)
+	{
+		return machine != machine_type::chip8 || (quirks != quirk_type::machine && quirks != quirk_type::chip8);
+	}
+
+	bool can_run_other_machines(const options& opts)
+	{
+		return opts.engine == engine_type::interpreter && opts.threads == 1 && opts.load_state_path.empty() && opts.save_state_path.empty()
+			&& opts.replay_path.empty() && opts.profile_path.empty() && opts.profile_stacks_path.empty();
+	}
+
+	options parse_options(const int argc, char* argv[])
+	{
+		options opts;
+
+		for (auto i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+
+			if (arg == "--cycles" && i + 1 < argc)
+				opts.max_cycles = std::stoull(argv[++i]);
+			else if (arg == "--cycles-per-frame" && i + 1 < argc)
+				opts.cycles_per_frame = static_cast<uint32_t>(std::stoul(argv[++i]));
+			else if (arg == "--seed" && i + 1 < argc)
+				opts.seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+			else if (arg == "--engine" && i + 1 < argc)
+				opts.engine = parse_engine(argv[++i]);
+			else if (arg == "--machine" && i + 1 < argc)
+			{
+				opts.machine = parse_machine(argv[++i]);
+				opts.machine_given = true;
+			}
+			else if (arg == "--quirks" && i + 1 < argc)
+			{
+				opts.quirks = parse_quirks(argv[++i]);
+				opts.machine_given = true;
+			}
+			else if (arg == "--load-state" && i + 1 < argc)
+				opts.load_state_path = argv[++i];
+			else if (arg == "--save-state" && i + 1 < argc)
+				opts.save_state_path = argv[++i];
+			else if (arg == "--replay" && i + 1 < argc)
+				opts.replay_path = argv[++i];
+			else if (arg == "--threads" && i + 1 < argc)
+				opts.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+			else if (arg == "--profile" && i + 1 < argc)
+				opts.profile_path = argv[++i];
+			else if (arg == "--profile-stacks" && i + 1 < argc)
+				opts.profile_stacks_path = argv[++i];
+			else if (arg == "--truncate-roms")
+				opts.oversized = oversized_rom::truncate;
+			else if (arg == "--rom-pack" && i + 1 < argc)
+				opts.rom_pack_path = argv[++i];
+			else if (arg == "--rom-cache" && i + 1 < argc)
+				opts.rom_cache_path = argv[++i];
+			else if (arg == "--skip-idle")
+				opts.skip_idle = true;
+			else if (arg.rfind("--", 0) == 0)
+				throw std::invalid_argument("Unknown option \"" + arg + "\"");
+			else
+				opts.rom_file_paths.push_back(arg);
+		}
+
+		if (opts.cycles_per_frame == 0)
+			throw std::invalid_argument("--cycles-per-frame must be greater than 0");
+
+		if (!opts.load_state_path.empty())
+		{
+			if (!opts.rom_file_paths.empty())
+				throw std::invalid_argument("--load-state cannot be combined with ROMs");
+
+			opts.rom_file_paths.push_back(opts.load_state_path);
+		}
+
+		if (!opts.rom_pack_path.empty() && (!opts.rom_file_paths.empty() || !opts.save_state_path.empty() || !opts.replay_path.empty()))
+			throw std::invalid_argument("--rom-pack cannot be combined with ROM files, states or movies");
+
+		if (!opts.rom_cache_path.empty() && (!opts.load_state_path.empty() || !opts.replay_path.empty()))
+			throw std::invalid_argument("--rom-cache only runs ROMs from the start, without states or movies");
+
+		if (!opts.save_state_path.empty() && opts.rom_file_paths.size() != 1)
+			throw std::invalid_argument("--save-state needs exactly one ROM");
+
+		if (!opts.replay_path.empty() && (!opts.load_state_path.empty() || opts.rom_file_paths.size() != 1))
+			throw std::invalid_argument("--replay needs exactly one ROM, and cannot start from a save state");
+
+		if (opts.threads != 1 && (opts.engine != engine_type::interpreter || !opts.save_state_path.empty() || !opts.replay_path.empty()))
+			throw std::invalid_argument("--threads only runs the interpreter, and cannot save states or replay movies");
+
+		if ((!opts.profile_path.empty() || !opts.profile_stacks_path.empty())
+			&& (opts.engine != engine_type::interpreter || opts.rom_file_paths.size() != 1 || opts.threads != 1))
+			throw std::invalid_argument("--profile and --profile-stacks need exactly one ROM run by the interpreter");
+
+		if (opts.skip_idle && (opts.engine != engine_type::interpreter || opts.threads != 1 || !opts.profile_path.empty()
+			|| !opts.profile_stacks_path.empty()))
+			throw std::invalid_argument("--skip-idle only runs the interpreter on one thread, without profiles");
+
+		if (uses_other_machine(opts.machine, opts.quirks) && !can_run_other_machines(opts))
+			throw std::invalid_argument("--machine and --quirks only run the interpreter on one thread, without states, movies or profiles");
+
+		return opts;
+	}
+
+	template<typename machine, typename engine>
+	void run_cycles(machine& emu, engine& eng, run_result& result, const options& opts)
+	{
+		while (result.cycles < opts.max_cycles)
+		{
+			if (!eng.next_instruction())
+			{
+				result.halted = true;
+				break;
+			}
+
+			if (++result.cycles % opts.cycles_per_frame == 0)
+				emu.tick_timers();
+		}
+	}
+
+	// The interpreter skipping whole iterations of any loop the program is waiting in
+	template<typename machine>
+	struct idle_skipping_interpreter
+	{
+		machine& emu;
+		idle_detector<machine> detector;
+		uint64_t skipped_cycles = 0;
+
+		bool next_instruction()
+		{
+			return emu.next_instruction(detector);
+		}
+
+		uint64_t skip(const uint64_t max_cycles)
+		{
+			const auto skipped = detector.skip(max_cycles);
+			skipped_cycles += skipped;
+			return skipped;
+		}
+	};
+
+	template<typename machine>
+	void run_cycles(machine& emu, idle_skipping_interpreter<machine>& eng, run_result& result, const options& opts)
+	{
+		while (result.cycles < opts.max_cycles)
+		{
+			if (!eng.next_instruction())
+			{
+				result.halted = true;
+				break;
+			}
+
+			// Skipping stops at the next tick, as that may be what the loop is waiting for
+			if (++result.cycles % opts.cycles_per_frame != 0)
+			{
+				const auto frame_cycles = opts.cycles_per_frame - (result.cycles % opts.cycles_per_frame);
+				result.cycles += eng.skip(std::min<uint64_t>(frame_cycles, opts.max_cycles - result.cycles));
+			}
+
+			if (result.cycles % opts.cycles_per_frame == 0)
+				emu.tick_timers();
+		}
+	}
+
+	void run_cycles(chip8& emu, jit_engine& jit, run_result& result, const options& opts)
+	{
+		// The JIT runs a whole frame at a time, stopping exactly where the interpreter would tick the timers
+		while (result.cycles < opts.max_cycles)
+		{
+			const auto frame_cycles = opts.cycles_per_frame - (result.cycles % opts.cycles_per_frame);
+			result.cycles += jit.run(std::min<uint64_t>(frame_cycles, opts.max_cycles - result.cycles));
+
+			if (jit.halted())
+			{
+				result.halted = true;
+				break;
+			}
+
+			if (result.cycles % opts.cycles_per_frame == 0)
+				emu.tick_timers();
+		}
+	}
+
+	// Runs exactly the given number of instructions unless the program quits first, returning how many ran
+	template<typename engine>
+	uint64_t run_exactly(engine& eng, const uint64_t cycles)
+	{
+		for (uint64_t i = 0; i < cycles; ++i)
+		{
+			if (!eng.next_instruction())
+				return i;
+		}
+
+		return cycles;
+	}
+
+	uint64_t run_exactly(jit_engine& jit, const uint64_t cycles)
+	{
+		return jit.run(cycles);
+	}
+
+	// Movies only change the timers between frames and the keys at each recorded change, and replays run up to one of
+	// those at a time, so waiting loops are skipped up to the end of the run
+	template<typename machine>
+	uint64_t run_exactly(idle_skipping_interpreter<machine>& eng, const uint64_t cycles)
+	{
+		for (uint64_t i = 0; i < cycles;)
+		{
+			if (!eng.next_instruction())
+				return i;
+
+			++i;
+			i += eng.skip(cycles - i);
+		}
+
+		return cycles;
+	}
+
+	// Replays every frame of a movie as fast as possible, ignoring the cycle limit
+	template<typename engine>
+	void replay_movie(chip8& emu, engine& eng, run_result& result, const movie& recording)
+	{
+		movie_player player(recording);
+		movie_frame frame;
+		double cycle_budget = 0.0;
+
+		while (player.next(frame))
+		{
+			const auto cycles = next_frame_cycles(recording.cycles_per_frame, cycle_budget);
+			apply_frame_input(emu, frame);
+			const auto ran = run_frame_input(emu, frame, cycles, [&eng](const uint64_t count) { return run_exactly(eng, count); });
+			result.cycles += ran;
+
+			if (ran < cycles)
+			{
+				result.halted = true;
+				break;
+			}
+		}
+	}
+
+	template<typename engine>
+	void run_engine(chip8& emu, engine& eng, run_result& result, const options& opts, const movie* recording)
+	{
+		if (recording)
+			replay_movie(emu, eng, result, *recording);
+		else
+			run_cycles(emu, eng, result, opts);
+	}
+
+	// The interpreter reporting every instruction it runs to a profiler
+	struct profiled_interpreter
+	{
+		chip8& emu;
+		execution_profiler& profiler;
+
+		bool next_instruction()
+		{
+			return emu.next_instruction(profiler);
+		}
+	};
+
+	void write_profile(const execution_profiler& profiler, const options& opts)
+	{
+		const auto write = [&profiler](const std::string& file_path, void (execution_profiler::*writer)(std::ostream&) const)
+		{
+			std::ofstream file(file_path);
+
+			if (!file.is_open())
+				throw std::runtime_error("Failed to open \"" + file_path + "\" for writing");
+
+			(profiler.*writer)(file);
+		};
+
+		if (!opts.profile_path.empty())
+			write(opts.profile_path, &execution_profiler::write_flat_profile);
+
+		if (!opts.profile_stacks_path.empty())
+			write(opts.profile_stacks_path, &execution_profiler::write_collapsed_stacks);
+	}
+
+	// Copies a ROM straight into program memory from its file or from the ROM pack
+	template<typename machine>
+	rom_load_result load_rom_from_source(machine& emu, const std::string& rom_name, const options& opts)
+	{
+		if (!opts.pack)
+			return load_rom_file(emu, rom_name, opts.oversized);
+
+		// Every name run comes from the pack, so it is always found
+		const auto* rom = opts.pack->find(rom_name);
+		return load_rom(emu, opts.pack->data(*rom), rom->size, rom_name, opts.oversized);
+	}
+
+	// Returns nothing loaded for a state
+	rom_load_result load_rom_or_state(chip8& emu, const std::string& rom_file_path, const options& opts)
+	{
+		if (!opts.load_state_path.empty())
+		{
+			load_state_file(opts.load_state_path, emu);
+			return {};
+		}
+
+		return load_rom_from_source(emu, rom_file_path, opts);
+	}
+
+	// Finds a ROM in the ROM cache, analysing and adding it if it is new
+	void find_or_add_rom(const uint8_t* rom, const std::size_t size, const options& opts, run_result& result)
+	{
+		result.cache_hit = opts.cache->find(rom, size, result.cache_entry);
+
+		if (!result.cache_hit)
+			result.cache_entry = opts.cache->add(rom, size);
+	}
+
+	// Picks the machine and quirks a ROM runs as, which without --machine or --quirks are those the ROM cache detected.
+	// Throws std::runtime_error if the run cannot use the machine picked.
+	void pick_machine(const std::string& rom_name, const options& opts, run_result& result)
+	{
+		result.machine = opts.machine;
+		result.quirks = opts.quirks;
+
+		if (!opts.cache || opts.machine_given)
+			return;
+
+		// Looked up as stored rather than once loaded, as the machine decides how much program memory there is
+		if (opts.pack)
+		{
+			const auto* rom = opts.pack->find(rom_name);
+			find_or_add_rom(opts.pack->data(*rom), rom->size, opts, result);
+		}
+		else
+		{
+			const auto rom = read_rom_file(rom_name, std::numeric_limits<std::size_t>::max());
+			find_or_add_rom(rom.data(), rom.size(), opts, result);
+		}
+
+		result.machine = result.cache_entry.machine;
+		result.quirks = result.cache_entry.quirks;
+
+		if (uses_other_machine(result.machine, result.quirks) && !can_run_other_machines(opts))
+			throw std::runtime_error(std::string("Detected as ") + machine_name(result.machine) + " with " + quirks_name(result.quirks)
+				+ " quirks, which only run in the interpreter on one thread, without states, movies or profiles. Pass --machine or"
+				" --quirks to run it as something else.");
+	}
+
+	// Finds the ROM just loaded into program memory in the ROM cache
+	template<typename machine>
+	void look_up_rom(const machine& emu, const rom_load_result& loaded, const options& opts, run_result& result)
+	{
+		result.truncated = loaded.truncated();
+
+		if (!opts.cache)
+			return;
+
+		// Usually already found by pick_machine(), unless loading truncated the ROM
+		const auto* rom = emu.memory.data() + machine::program_memory_start;
+		const auto& cached = result.cache_entry.rom;
+
+		if (cached.empty() || !std::equal(rom, rom + loaded.loaded_size, cached.begin(), cached.end()))
+			find_or_add_rom(rom, loaded.loaded_size, opts, result);
+	}
+
+	// Compares the final state with the known result of the same run, or records it as the known result if there is none
+	template<typename machine>
+	void check_known_result(const machine& emu, const options& opts, run_result& result)
+	{
+		if (!opts.cache)
+			return;
+
+		known_result run;
+		run.machine = result.machine;
+		run.quirks = result.quirks;
+		run.cycles = opts.max_cycles;
+		run.cycles_per_frame = opts.cycles_per_frame;
+		run.seed = opts.seed;
+		run.state_hash = state_hash(emu);
+
+		if (const auto* known = result.cache_entry.find_known_result(run))
+		{
+			result.check = known->state_hash == run.state_hash ? result_check::matched : result_check::mismatched;
+			return;
+		}
+
+		result.cache_entry.known_results.push_back(run);
+		opts.cache->store(result.cache_entry);
+		result.check = result_check::recorded;
+	}
+
+	void run_rom(chip8& emu, const std::string& rom_file_path, const options& opts, run_result& result)
+	{
+		using clock = std::chrono::steady_clock;
+
+		const auto load_start = clock::now();
+		look_up_rom(emu, load_rom_or_state(emu, rom_file_path, opts), opts, result);
+
+		movie recording;
+
+		if (!opts.replay_path.empty())
+		{
+			recording = movie::load(opts.replay_path);
+
+			if (recording.program_hash != program_hash(emu))
+				throw std::runtime_error("\"" + opts.replay_path + "\" was recorded with a different ROM");
+
+			emu.seed_random(recording.seed);
+		}
+
+		const auto replaying = opts.replay_path.empty() ? nullptr : &recording;
+
+		// Only created when asked for, so an unprofiled run never pays for it
+		std::unique_ptr<execution_profiler> profiler;
+
+		if (!opts.profile_path.empty() || !opts.profile_stacks_path.empty())
+			profiler = std::make_unique<execution_profiler>();
+
+		const auto run_start = clock::now();
+
+		switch (opts.engine)
+		{
+		case engine_type::interpreter:
+			if (profiler)
+			{
+				profiled_interpreter profiled{ emu, *profiler };
+				run_engine(emu, profiled, result, opts, replaying);
+			}
+			else if (opts.skip_idle)
+			{
+				idle_skipping_interpreter<chip8> skipping{ emu, {} };
+				run_engine(emu, skipping, result, opts, replaying);
+				result.idle_cycles = skipping.skipped_cycles;
+			}
+			else
+			{
+				run_engine(emu, emu, result, opts, replaying);
+			}
+			break;
+		case engine_type::cached:
+			{
+				cached_interpreter cache(emu);
+				run_engine(emu, cache, result, opts, replaying);
+			}
+			break;
+		case engine_type::jit:
+			{
+				jit_engine jit(emu);
+				run_engine(emu, jit, result, opts, replaying);
+			}
+			break;
+		}
+
+		const auto run_end = clock::now();
+
+		result.load_time_ms = std::chrono::duration<double, std::milli>(run_start - load_start).count();
+		result.run_time_ms = std::chrono::duration<double, std::milli>(run_end - run_start).count();
+
+		if (!opts.save_state_path.empty())
+			save_state_file(opts.save_state_path, emu);
+
+		if (profiler)
+			write_profile(*profiler, opts);
+
+		check_known_result(emu, opts, result);
+	}
+
+	// Runs a ROM in the interpreter for whichever machine and quirks with_machine() picked
+	template<typename machine>
+	void run_rom_as(machine& emu, const std::string& rom_file_path, const options& opts, run_result& result)
+	{
+		using clock = std::chrono::steady_clock;
+
+		const auto load_start = clock::now();
+		look_up_rom(emu, load_rom_from_source(emu, rom_file_path, opts), opts, result);
+
+		const auto run_start = clock::now();
+
+		if (opts.skip_idle)
+		{
+			idle_skipping_interpreter<machine> skipping{ emu, {} };
+			run_cycles(emu, skipping, result, opts);
+			result.idle_cycles = skipping.skipped_cycles;
+		}
+		else
+		{
+			run_cycles(emu, emu, result, opts);
+		}
+
+		const auto run_end = clock::now();
+
+		result.load_time_ms = std::chrono::duration<double, std::milli>(run_start - load_start).count();
+		result.run_time_ms = std::chrono::duration<double, std::milli>(run_end - run_start).count();
+
+		check_known_result(emu, opts, result);
+	}
+
+	void write_result_start(const std::string& rom_file_path, const options& opts)
+	{
+		std::cout << (opts.load_state_path.empty() ? "  {\"rom\": " : "  {\"state\": ");
+		write_json_string(std::cout, rom_file_path);
+	}
+
+	template<typename machine>
+	void write_result(const run_result& result, const machine& emu, const options& opts)
+	{
+		// A loaded snapshot carries on with its own random number generator, and a movie has its own seed
+		if (opts.load_state_path.empty() && opts.replay_path.empty())
+			std::cout << ", \"seed\": " << opts.seed;
+
+		if (opts.oversized == oversized_rom::truncate)
+			std::cout << ", \"truncated\": " << (result.truncated ? "true" : "false");
+
+		if (opts.cache)
+		{
+			constexpr const char* checks[] = { "recorded", "matched", "mismatched" };
+			const auto& entry = result.cache_entry;
+
+			std::cout << ", \"rom_hash\": \"" << std::hex << std::setw(16) << std::setfill('0')
+				<< content_hash(entry.rom.data(), entry.rom.size()) << std::dec << std::setfill(' ') << '"'
+				<< ", \"cache_hit\": " << (result.cache_hit ? "true" : "false")
+				<< ", \"detected_machine\": \"" << machine_name(entry.machine) << '"'
+				<< ", \"detected_quirks\": \"" << quirks_name(entry.quirks) << '"'
+				<< ", \"code_bytes\": " << entry.code_size
+				<< ", \"known_result\": \"" << checks[static_cast<int>(result.check)] << '"';
+		}
+
+		std::cout << ", \"cycles\": " << result.cycles
+			<< ", \"halted\": " << (result.halted ? "true" : "false")
+			<< ", \"load_time_ms\": " << result.load_time_ms
+			<< ", \"run_time_ms\": " << result.run_time_ms
+			<< ", ";
+
+		if (opts.skip_idle)
+			std::cout << "\"idle_cycles\": " << result.idle_cycles << ", ";
+
+		write_json_state(std::cout, emu);
+	}
+
+	void write_error(const std::string& error)
+	{
+		std::cout << ", \"error\": ";
+		write_json_string(std::cout, error);
+	}
+
+	// Runs every ROM at once, printing the results in the same order and format as running them one at a time. Each
+	// ROM's run time is that of the whole farm, which is summarised on stderr.
+	int run_farm(const options& opts)
+	{
+		using clock = std::chrono::steady_clock;
+
+		chip8_farm farm(opts.threads, farm_slice_cycles, opts.cycles_per_frame);
+		std::vector<run_result> results(opts.rom_file_paths.size());
+		std::vector<std::string> errors(opts.rom_file_paths.size());
+		std::vector<std::size_t> slots(opts.rom_file_paths.size());
+
+		for (std::size_t i = 0; i < opts.rom_file_paths.size(); ++i)
+		{
+			const auto load_start = clock::now();
+
+			try
+			{
+				pick_machine(opts.rom_file_paths[i], opts, results[i]);
+
+				chip8 emu;
+				emu.seed_random(opts.seed);
+				look_up_rom(emu, load_rom_or_state(emu, opts.rom_file_paths[i], opts), opts, results[i]);
+				slots[i] = farm.add(emu, opts.max_cycles);
+			}
+			catch (const std::exception& e)
+			{
+				errors[i] = e.what();
+			}
+
+			results[i].load_time_ms = std::chrono::duration<double, std::milli>(clock::now() - load_start).count();
+		}
+
+		const auto stats = farm.run();
+		auto exit_code = EXIT_SUCCESS;
+
+		for (std::size_t i = 0; i < opts.rom_file_paths.size(); ++i)
+		{
+			try
+			{
+				if (errors[i].empty())
+					check_known_result(farm[slots[i]].emu, opts, results[i]);
+			}
+			catch (const std::exception& e)
+			{
+				errors[i] = e.what();
+			}
+		}
+
+		std::cout << "[\n";
+
+		for (std::size_t i = 0; i < opts.rom_file_paths.size(); ++i)
+		{
+			write_result_start(opts.rom_file_paths[i], opts);
+
+			if (errors[i].empty())
+			{
+				const auto& inst = farm[slots[i]];
+				results[i].cycles = inst.cycles;
+				results[i].halted = inst.halted;
+				results[i].run_time_ms = stats.run_time_ms;
+				write_result(results[i], inst.emu, opts);
+			}
+			else
+			{
+				write_error(errors[i]);
+				exit_code = EXIT_FAILURE;
+			}
+
+			std::cout << "}" << (i + 1 < opts.rom_file_paths.size() ? "," : "") << "\n";
+		}
+
+		std::cout << "]\n";
+
+		std::cerr << "Ran " << stats.cycles << " instructions across " << farm.size() << " ROMs on " << stats.threads
+			<< " threads in " << stats.run_time_ms << " ms (" << stats.instructions_per_second() / 1e6 << " MIPS, "
+			<< stats.steals << " of " << stats.slices << " slices stolen)\n";
+
+		return exit_code;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	options opts;
+
+	try
+	{
+		opts = parse_options(argc, argv);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << "\n";
+		print_usage();
+		return EXIT_FAILURE;
+	}
+
+	if (!opts.rom_pack_path.empty())
+	{
+		try
+		{
+			using clock = std::chrono::steady_clock;
+			const auto pack_start = clock::now();
+
+			opts.pack = std::make_shared<const rom_pack>(rom_pack::load(opts.rom_pack_path));
+
+			for (const auto& rom : opts.pack->entries())
+				opts.rom_file_paths.push_back(rom.name);
+
+			std::cerr << "Read " << opts.pack->entries().size() << " ROMs from \"" << opts.rom_pack_path << "\" in "
+				<< std::chrono::duration<double, std::milli>(clock::now() - pack_start).count() << " ms\n";
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << e.what() << "\n";
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (opts.rom_file_paths.empty())
+	{
+		print_usage();
+		return EXIT_FAILURE;
+	}
+
+	if (!opts.rom_cache_path.empty())
+	{
+		try
+		{
+			opts.cache = std::make_shared<const rom_cache>(opts.rom_cache_path);
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << e.what() << "\n";
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (opts.threads != 1)
+		return run_farm(opts);
+
+	auto exit_code = EXIT_SUCCESS;
+
+	std::cout << "[\n";
+
+	for (std::size_t i = 0; i < opts.rom_file_paths.size(); ++i)
+	{
+		const auto& rom_file_path = opts.rom_file_paths[i];
+		write_result_start(rom_file_path, opts);
+
+		try
+		{
+			run_result result;
+			pick_machine(rom_file_path, opts, result);
+
+			if (uses_other_machine(result.machine, result.quirks))
+			{
+				with_machine(result.machine, result.quirks, [&](auto& emu)
+				{
+					emu.seed_random(opts.seed);
+					run_rom_as(emu, rom_file_path, opts, result);
+					write_result(result, emu, opts);
+				});
+			}
+			else
+			{
+				chip8 emu;
+				emu.seed_random(opts.seed);
+				run_rom(emu, rom_file_path, opts, result);
+				write_result(result, emu, opts);
+			}
+		}
+		catch (const std::exception& e)
+		{
+			write_error(e.what());
+			exit_code = EXIT_FAILURE;
+		}
+
+		std::cout << "}" << (i + 1 < opts.rom_file_paths.size() ? "," : "") << "\n";
+	}
+
+	std::cout << "]\n";
+
+	return exit_code;
+}
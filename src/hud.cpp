@@ -0,0 +1,119 @@
+#include "hud.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+
+namespace
+{
+	constexpr int glyph_width = 3;
+	constexpr int glyph_height = 5;
+	constexpr int padding = 2; // Pixels of background around the text
+
+	// One row per byte, with the leftmost pixel in bit 2
+	using glyph = std::array<uint8_t, glyph_height>;
+
+	constexpr std::array<glyph, 10> digit_glyphs = { {
+		{ 7, 5, 5, 5, 7 }, { 2, 6, 2, 2, 7 }, { 7, 1, 7, 4, 7 }, { 7, 1, 7, 1, 7 }, { 5, 5, 7, 1, 1 },
+		{ 7, 4, 7, 1, 7 }, { 7, 4, 7, 5, 7 }, { 7, 1, 1, 1, 1 }, { 7, 5, 7, 5, 7 }, { 7, 5, 7, 1, 7 }
+	} };
+
+	constexpr std::array<glyph, 26> letter_glyphs = { {
+		{ 2, 5, 7, 5, 5 }, { 6, 5, 6, 5, 6 }, { 3, 4, 4, 4, 3 }, { 6, 5, 5, 5, 6 }, { 7, 4, 6, 4, 7 },
+		{ 7, 4, 6, 4, 4 }, { 3, 4, 5, 5, 3 }, { 5, 5, 7, 5, 5 }, { 7, 2, 2, 2, 7 }, { 1, 1, 1, 5, 2 },
+		{ 5, 5, 6, 5, 5 }, { 4, 4, 4, 4, 7 }, { 5, 7, 7, 5, 5 }, { 6, 5, 5, 5, 5 }, { 2, 5, 5, 5, 2 },
+		{ 6, 5, 6, 4, 4 }, { 2, 5, 5, 6, 3 }, { 6, 5, 6, 5, 5 }, { 3, 4, 2, 1, 6 }, { 7, 2, 2, 2, 2 },
+		{ 5, 5, 5, 5, 7 }, { 5, 5, 5, 5, 2 }, { 5, 5, 7, 7, 5 }, { 5, 5, 2, 5, 5 }, { 5, 5, 2, 2, 2 },
+		{ 7, 1, 2, 4, 7 }
+	} };
+
+	glyph find_glyph(const char c)
+	{
+		if (c >= '0' && c <= '9')
+			return digit_glyphs[c - '0'];
+
+		if (std::isalpha(static_cast<unsigned char>(c)))
+			return letter_glyphs[std::toupper(static_cast<unsigned char>(c)) - 'A'];
+
+		switch (c)
+		{
+		case '.': return { 0, 0, 0, 0, 2 };
+		case ':': return { 0, 2, 0, 2, 0 };
+		case '%': return { 5, 1, 2, 4, 5 };
+		case '/': return { 1, 1, 2, 4, 4 };
+		case '-': return { 0, 0, 7, 0, 0 };
+		default: return {};
+		}
+	}
+}
+
+hud::hud(const float pixel_size)
+	: m_pixel_size(pixel_size)
+{
+}
+
+void hud::set_text(const std::string& text)
+{
+	m_background.clear();
+	m_glyphs.clear();
+
+	// Each glyph is followed by a column of space, and each line by a row of it
+	int column = 0;
+	int row = 0;
+	int widest = 0;
+
+	for (const auto c : text)
+	{
+		if (c == '\n')
+		{
+			column = 0;
+			++row;
+			continue;
+		}
+
+		const auto shape = find_glyph(c);
+		const auto left = padding + column * (glyph_width + 1);
+		const auto top = padding + row * (glyph_height + 1);
+
+		for (auto y = 0; y < glyph_height; ++y)
+		{
+			for (auto x = 0; x < glyph_width; ++x)
+			{
+				if ((shape[y] >> (glyph_width - 1 - x)) & 1)
+					add_quad(m_glyphs, static_cast<float>(left + x), static_cast<float>(top + y), 1.0f, 1.0f, sf::Color::White);
+			}
+		}
+
+		widest = std::max(widest, ++column);
+	}
+
+	if (widest == 0)
+		return;
+
+	const auto lines = row + 1;
+	add_quad(m_background, 0.0f, 0.0f, static_cast<float>(widest * (glyph_width + 1) - 1 + padding * 2),
+		static_cast<float>(lines * (glyph_height + 1) - 1 + padding * 2), sf::Color(0, 0, 0, 160));
+}
+
+void hud::draw(sf::RenderTarget& target, sf::RenderStates states) const
+{
+	states.transform.scale(m_pixel_size, m_pixel_size);
+	target.draw(m_background, states);
+	target.draw(m_glyphs, states);
+}
+
+void hud::add_quad(sf::VertexArray& vertices, const float x, const float y, const float width, const float height, const sf::Color colour) const
+{
+	const sf::Vertex top_left({ x, y }, colour);
+	const sf::Vertex top_right({ x + width, y }, colour);
+	const sf::Vertex bottom_right({ x + width, y + height }, colour);
+	const sf::Vertex bottom_left({ x, y + height }, colour);
+
+	vertices.append(top_left);
+	vertices.append(top_right);
+	vertices.append(bottom_right);
+	vertices.append(top_left);
+	vertices.append(bottom_right);
+	vertices.append(bottom_left);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+#include <SFML/Graphics.hpp>
+
+// Lines of text drawn over the display in a built-in 3x5 pixel font, so the overlay needs no font file. Only digits,
+// capital letters and a little punctuation have glyphs; anything else is drawn as a space.
+class hud : public sf::Drawable
+{
+public:
+	explicit hud(float pixel_size);
+
+	// Rebuilds the overlay, starting a new line at every '\n'
+	void set_text(const std::string& text);
+
+private:
+	float m_pixel_size;
+	sf::VertexArray m_background{ sf::Triangles };
+	sf::VertexArray m_glyphs{ sf::Triangles };
+
+	void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+	void add_quad(sf::VertexArray& vertices, float x, float y, float width, float height, sf::Color colour) const;
+};
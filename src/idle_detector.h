@@ -0,0 +1,155 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "chip8.h"
+#include "decoder.h"
+
+// Watches the instructions run through basic_chip8::next_instruction(detector) for a program that is only waiting:
+// FX0A with no key pressed, DXYN waiting for the timers to tick, a jump to itself, or a loop such as FX07/3X00/1NNN
+// polling the delay timer. A loop counts once the machine returns to exactly the same state at its backward jump
+// without writing to memory or the display in between. Nothing but a timer tick or a change of keys can then break
+// it, so whole iterations up to the next of those can be skipped without changing the outcome of the run.
+template<typename machine>
+class idle_detector
+{
+public:
+	constexpr void record(const machine& emu, const uint16_t address, const decoded_instruction& decoded) noexcept
+	{
+		++m_instructions;
+		m_period = 0;
+
+		switch (decoded.op)
+		{
+		case operation::clear_screen:
+		case operation::store_bcd:
+		case operation::store_registers:
+		case operation::scroll_down:
+		case operation::scroll_right:
+		case operation::scroll_left:
+		case operation::low_resolution:
+		case operation::high_resolution:
+		case operation::store_flags:
+		case operation::store_register_range:
+		case operation::scroll_up:
+		case operation::load_audio_pattern:
+		case operation::set_pitch:
+			m_side_effects = true;
+			break;
+		case operation::draw_sprite:
+		case operation::wait_for_key:
+			// Both stay on the same instruction while they wait, having changed nothing
+			if (emu.program_counter == address)
+				m_period = 1;
+			else
+				m_side_effects = true;
+			break;
+		case operation::jump:
+		case operation::jump_with_offset:
+			if (emu.program_counter == address)
+				m_period = 1;
+			else if (emu.program_counter < address)
+				check_loop(emu, address);
+			break;
+		default:
+			break;
+		}
+	}
+
+	// How many instructions a single iteration of the loop the program is waiting in takes, or 0 if it is not waiting.
+	// Only set by the instruction that found the loop.
+	[[nodiscard]] constexpr uint64_t idle_period() const noexcept
+	{
+		return m_period;
+	}
+
+	// Returns how many of the next max_instructions can be skipped by leaving the machine as it is, which is every
+	// whole iteration of the loop that fits when the program is waiting. The caller must make sure no timer tick or key
+	// change falls within them.
+	constexpr uint64_t skip(const uint64_t max_instructions) noexcept
+	{
+		const auto skipped = m_period > 0 ? max_instructions - (max_instructions % m_period) : 0;
+		m_period = 0;
+		return skipped;
+	}
+
+	// Forgets the loop being watched, which must be called when the machine is changed from outside, such as by loading a
+	// snapshot, as that may rewrite the loop's code
+	constexpr void reset() noexcept
+	{
+		m_period = 0;
+		m_watching = false;
+	}
+
+private:
+	// Everything a loop without side effects can read, so the same state at the same jump means the same iterations
+	struct loop_state
+	{
+		std::array<uint8_t, 16> registers{};
+		uint16_t address = 0;
+		uint16_t program_counter = 0;
+		std::array<uint16_t, machine::max_stacks> call_stack{};
+		uint8_t stack_pointer = 0;
+		uint8_t delay_timer = 0;
+		uint8_t sound_timer = 0;
+		uint16_t key_state = 0;
+		uint8_t released_key = 0;
+		uint32_t random_state = 0;
+		bool vertical_blank = false;
+		uint8_t plane_mask = 0;
+		bool high_resolution = false;
+
+		[[nodiscard]] constexpr bool operator==(const loop_state& other) const noexcept
+		{
+			return registers == other.registers && address == other.address && program_counter == other.program_counter
+				&& call_stack == other.call_stack && stack_pointer == other.stack_pointer && delay_timer == other.delay_timer
+				&& sound_timer == other.sound_timer && key_state == other.key_state && released_key == other.released_key
+				&& random_state == other.random_state && vertical_blank == other.vertical_blank && plane_mask == other.plane_mask
+				&& high_resolution == other.high_resolution;
+		}
+	};
+
+	uint64_t m_instructions = 0;
+	uint64_t m_period = 0;
+	bool m_watching = false; // Whether m_jump_address, m_jump_state and m_jump_instructions describe a backward jump
+	bool m_side_effects = false; // Since that jump
+	uint16_t m_jump_address = 0;
+	loop_state m_jump_state;
+	uint64_t m_jump_instructions = 0;
+
+	[[nodiscard]] static constexpr loop_state capture(const machine& emu) noexcept
+	{
+		loop_state state;
+		state.registers = emu.registers.data;
+		state.address = emu.registers.address;
+		state.program_counter = emu.program_counter;
+		state.call_stack = emu.call_stack;
+		state.stack_pointer = emu.stack_pointer;
+		state.delay_timer = emu.delay_timer;
+		state.sound_timer = emu.sound_timer;
+		state.key_state = emu.key_state;
+		state.released_key = emu.released_key;
+		state.random_state = emu.random_state;
+		state.vertical_blank = emu.vertical_blank;
+		state.plane_mask = emu.plane_mask;
+		state.high_resolution = emu.high_resolution;
+
+		return state;
+	}
+
+	// Compares the state at a backward jump with the last time it was taken, then watches it from here
+	constexpr void check_loop(const machine& emu, const uint16_t address) noexcept
+	{
+		const auto state = capture(emu);
+
+		if (m_watching && m_jump_address == address && !m_side_effects && state == m_jump_state)
+			m_period = m_instructions - m_jump_instructions;
+
+		m_watching = true;
+		m_side_effects = false;
+		m_jump_address = address;
+		m_jump_state = state;
+		m_jump_instructions = m_instructions;
+	}
+};
@@ -0,0 +1,74 @@
+#include "input_queue.h"
+
+#include <algorithm>
+
+void input_queue::press(const uint8_t key, const clock::time_point time) noexcept
+{
+	push(key, true, time);
+}
+
+void input_queue::release(const uint8_t key, const clock::time_point time) noexcept
+{
+	push(key, false, time);
+}
+
+void input_queue::release_all(const clock::time_point time) noexcept
+{
+	for (uint8_t key = 0; key < 16; ++key)
+		release(key, time);
+}
+
+void input_queue::next_frame(const clock::time_point frame_start, const clock::time_point frame_end, const uint64_t cycles, movie_frame& frame)
+{
+	frame.key_state = m_keys;
+	frame.key_changes.clear();
+
+	// Worked out in clock ticks, which keeps whole fractions of the frame exact
+	const auto frame_length = static_cast<double>((frame_end - frame_start).count());
+	uint32_t earliest = 0;
+
+	while (m_count > 0 && m_events[m_first].time < frame_end)
+	{
+		const auto elapsed = static_cast<double>((m_events[m_first].time - frame_start).count());
+		const auto position = elapsed > 0.0 ? static_cast<uint32_t>(elapsed * static_cast<double>(cycles) / frame_length) : 0;
+		const auto offset = std::max(position, earliest);
+
+		if (offset >= cycles)
+			break;
+
+		apply_oldest();
+		frame.key_changes.push_back({ offset, m_keys });
+		earliest = offset + 1;
+	}
+}
+
+std::size_t input_queue::pending() const noexcept
+{
+	return m_count;
+}
+
+void input_queue::push(const uint8_t key, const bool pressed, const clock::time_point time) noexcept
+{
+	const uint16_t bit = 1 << (key & 0xF);
+	const uint16_t latest = pressed ? (m_latest | bit) : (m_latest & ~bit);
+
+	if (latest == m_latest)
+		return;
+
+	if (m_count == m_events.size())
+		apply_oldest();
+
+	m_events[(m_first + m_count) % m_events.size()] = { static_cast<uint8_t>(key & 0xF), pressed, time };
+	++m_count;
+	m_latest = latest;
+}
+
+void input_queue::apply_oldest() noexcept
+{
+	const auto& event = m_events[m_first];
+	const uint16_t bit = 1 << event.key;
+
+	m_keys = event.pressed ? (m_keys | bit) : (m_keys & ~bit);
+	m_first = (m_first + 1) % m_events.size();
+	--m_count;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "movie.h"
+
+// Keeps the key presses and releases the frontend sees, each stamped with when it arrived, and hands them to the
+// machine a frame at a time. Each event lands on the instruction matching how far through the frame it happened, one
+// instruction after the last at the least, so a key tapped within a frame is still seen and FX0A sees every release.
+// Events are kept in a fixed ring, and once that fills up the oldest are applied straight away. The queue is filled
+// and drained on the thread that runs the machine, so it needs no locking.
+class input_queue
+{
+public:
+	using clock = std::chrono::steady_clock;
+
+	static constexpr std::size_t capacity = 64;
+
+	// Events that do not change a key, such as repeats while it is held, are dropped
+	void press(uint8_t key, clock::time_point time) noexcept;
+	void release(uint8_t key, clock::time_point time) noexcept;
+
+	// Lets go of every key, for when the window loses focus and will not see them released
+	void release_all(clock::time_point time) noexcept;
+
+	// Fills in the keys for the frame of cycles instructions emulating frame_start up to frame_end: those held as it
+	// starts, bit N for key N, and a change for each event before frame_end. Events from before frame_start land on the
+	// first instructions, and any that would land past the frame's last instruction are left for the next frame.
+	void next_frame(clock::time_point frame_start, clock::time_point frame_end, uint64_t cycles, movie_frame& frame);
+
+	[[nodiscard]] std::size_t pending() const noexcept;
+
+private:
+	struct key_event
+	{
+		uint8_t key = 0;
+		bool pressed = false;
+		clock::time_point time;
+	};
+
+	std::array<key_event, capacity> m_events{}; // Ring of events, oldest first
+	std::size_t m_first = 0;
+	std::size_t m_count = 0;
+
+	uint16_t m_keys = 0; // As of the last event handed to a frame
+	uint16_t m_latest = 0; // Once every queued event is applied
+
+	void push(uint8_t key, bool pressed, clock::time_point time) noexcept;
+	void apply_oldest() noexcept;
+};
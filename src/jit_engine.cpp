@@ -0,0 +1,547 @@
+#include "jit_engine.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CHIP8_JIT_X64
+#endif
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+	using reg = x64_emitter::reg;
+
+	constexpr std::size_t code_memory_size = 4 * 1024 * 1024;
+	constexpr uint8_t shadow_space = 32; // Required by the Windows calling convention, and keeps the stack aligned
+
+#if defined(_WIN32)
+	constexpr reg argument_0 = x64_emitter::rcx;
+	constexpr reg argument_1 = x64_emitter::rdx;
+#else
+	constexpr reg argument_0 = x64_emitter::rdi;
+	constexpr reg argument_1 = x64_emitter::rsi;
+#endif
+
+	const int32_t register_offset = static_cast<int32_t>(offsetof(chip8, registers) + offsetof(decltype(chip8::registers), data));
+	const int32_t address_offset = static_cast<int32_t>(offsetof(chip8, registers) + offsetof(decltype(chip8::registers), address));
+	const int32_t memory_offset = static_cast<int32_t>(offsetof(chip8, memory));
+	const int32_t program_counter_offset = static_cast<int32_t>(offsetof(chip8, program_counter));
+	const int32_t delay_timer_offset = static_cast<int32_t>(offsetof(chip8, delay_timer));
+	const int32_t sound_timer_offset = static_cast<int32_t>(offsetof(chip8, sound_timer));
+	const int32_t key_state_offset = static_cast<int32_t>(offsetof(chip8, key_state));
+	const int32_t call_stack_offset = static_cast<int32_t>(offsetof(chip8, call_stack));
+	const int32_t stack_pointer_offset = static_cast<int32_t>(offsetof(chip8, stack_pointer));
+
+	int32_t register_at(const uint8_t index)
+	{
+		return register_offset + index;
+	}
+
+	// Instructions that rarely appear in hot loops, or have too much logic to be worth emitting, are called out to
+	void execute_instruction(chip8* emu, const uint32_t instruction)
+	{
+		emu->evaluate_instruction(static_cast<uint16_t>(instruction));
+	}
+
+	bool is_compilable(const operation op)
+	{
+		switch (op)
+		{
+		case operation::clear_screen:
+		case operation::set_register:
+		case operation::add_to_register:
+		case operation::copy_register:
+		case operation::or_registers:
+		case operation::and_registers:
+		case operation::xor_registers:
+		case operation::add_registers:
+		case operation::subtract_registers:
+		case operation::shift_right:
+		case operation::subtract_reversed:
+		case operation::shift_left:
+		case operation::set_address:
+		case operation::random:
+		case operation::draw_sprite:
+		case operation::get_delay_timer:
+		case operation::set_delay_timer:
+		case operation::set_sound_timer:
+		case operation::add_to_address:
+		case operation::set_address_to_character:
+		case operation::load_registers:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// Branches end a block, setting the program counter themselves
+	bool is_branch(const operation op)
+	{
+		switch (op)
+		{
+		case operation::return_from_subroutine:
+		case operation::jump:
+		case operation::call:
+		case operation::skip_if_equal:
+		case operation::skip_if_not_equal:
+		case operation::skip_if_registers_equal:
+		case operation::skip_if_registers_not_equal:
+		case operation::skip_if_key_pressed:
+		case operation::skip_if_key_not_pressed:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	uint8_t* allocate_code_memory()
+	{
+#if !defined(CHIP8_JIT_X64)
+		return nullptr;
+#elif defined(_WIN32)
+		return static_cast<uint8_t*>(VirtualAlloc(nullptr, code_memory_size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE));
+#else
+		void* memory = mmap(nullptr, code_memory_size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		return memory != MAP_FAILED ? static_cast<uint8_t*>(memory) : nullptr;
+#endif
+	}
+
+	void free_code_memory(uint8_t* memory)
+	{
+		if (!memory)
+			return;
+
+#if defined(_WIN32)
+		VirtualFree(memory, 0, MEM_RELEASE);
+#else
+		munmap(memory, code_memory_size);
+#endif
+	}
+}
+
+jit_engine::jit_engine(chip8& emu)
+	: m_chip8(emu), m_code_memory(allocate_code_memory())
+{
+}
+
+jit_engine::~jit_engine()
+{
+	free_code_memory(m_code_memory);
+}
+
+uint64_t jit_engine::run(const uint64_t max_cycles)
+{
+	uint64_t cycles = 0;
+	m_halted = false;
+
+	while (cycles < max_cycles)
+	{
+		// Program counters past the end of memory wrap when fetched, so only unwrapped ones can use compiled blocks
+		if (m_code_memory && m_chip8.program_counter < compiled_memory_end)
+		{
+			const auto& compiled = find_block(m_chip8.program_counter);
+
+			if (compiled.length > 0 && compiled.length <= max_cycles - cycles)
+			{
+				if (!compiled.function(&m_chip8))
+				{
+					// The instruction that quits is not counted, as with the interpreter
+					cycles += compiled.length - 1;
+					m_halted = true;
+					break;
+				}
+
+				cycles += compiled.length;
+				continue;
+			}
+		}
+
+		if (!interpret_instruction())
+		{
+			m_halted = true;
+			break;
+		}
+
+		++cycles;
+	}
+
+	return cycles;
+}
+
+void jit_engine::invalidate()
+{
+	flush();
+}
+
+void jit_engine::invalidate(const uint16_t address, const uint16_t size)
+{
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		const auto written = chip8::wrap_address(address + i);
+		const auto first = std::max(0, written - max_block_length * 2 + 1);
+		const auto last = std::min<int>(written, compiled_memory_end - 1);
+
+		for (auto start = first; start <= last; ++start)
+		{
+			auto& entry = m_blocks[start];
+
+			// Entries with no compiled instructions still cover the instruction that stopped them
+			if (entry.compiled && start + std::max(entry.length * 2, 2) > written)
+				entry = block{};
+		}
+	}
+}
+
+bool jit_engine::halted() const noexcept
+{
+	return m_halted;
+}
+
+bool jit_engine::supported() noexcept
+{
+#if defined(CHIP8_JIT_X64)
+	return true;
+#else
+	return false;
+#endif
+}
+
+const jit_engine::block& jit_engine::find_block(const uint16_t address)
+{
+	auto& entry = m_blocks[address];
+
+	if (!entry.compiled)
+		entry = compile_block(address);
+
+	return entry;
+}
+
+jit_engine::block jit_engine::compile_block(const uint16_t address)
+{
+	m_emitter.clear();
+	m_emitter.push(x64_emitter::rbx);
+	m_emitter.mov_reg64(x64_emitter::rbx, argument_0);
+	m_emitter.sub_rsp(shadow_space);
+
+	uint16_t length = 0;
+	auto program_counter = address;
+	auto ends_with_branch = false;
+
+	for (; length < max_block_length && program_counter < compiled_memory_end; ++length, program_counter += 2)
+	{
+		const auto decoded = decode((m_chip8.memory[program_counter] << 8) | m_chip8.memory[program_counter + 1]);
+
+		if (is_branch(decoded.op))
+		{
+			emit_branch(decoded, program_counter);
+			ends_with_branch = true;
+			++length;
+			break;
+		}
+
+		if (decoded.instruction == 0 || !is_compilable(decoded.op))
+			break;
+
+		emit_instruction(decoded, program_counter);
+	}
+
+	if (length == 0)
+		return block{ nullptr, 0, true };
+
+	if (!ends_with_branch)
+	{
+		m_emitter.store_word_imm(x64_emitter::rbx, program_counter_offset, program_counter);
+		m_emitter.mov_imm32(x64_emitter::rax, 1);
+	}
+
+	m_emitter.add_rsp(shadow_space);
+	m_emitter.pop(x64_emitter::rbx);
+	m_emitter.ret();
+
+	const auto& code = m_emitter.code();
+
+	if (m_code_used + code.size() > code_memory_size)
+		flush();
+
+	auto* const destination = m_code_memory + m_code_used;
+	std::memcpy(destination, code.data(), code.size());
+	m_code_used += code.size();
+
+	return block{ reinterpret_cast<block_function>(destination), length, true };
+}
+
+void jit_engine::emit_instruction(const decoded_instruction& decoded, const uint16_t address)
+{
+	auto& e = m_emitter;
+
+	constexpr auto rax = x64_emitter::rax;
+	constexpr auto rbx = x64_emitter::rbx;
+	constexpr auto rcx = x64_emitter::rcx;
+	constexpr auto rdx = x64_emitter::rdx;
+
+	const auto vx = register_at(decoded.x);
+	const auto vy = register_at(decoded.y);
+	const auto vf = register_at(0xF);
+
+	// Operands are reloaded after Vf is written, matching the interpreter when X or Y is F
+	switch (decoded.op)
+	{
+	case operation::set_register:
+		e.store_byte_imm(rbx, vx, decoded.nn);
+		break;
+	case operation::add_to_register:
+		e.add_byte_imm(rbx, vx, decoded.nn);
+		break;
+	case operation::copy_register:
+		e.load_byte(rax, rbx, vy);
+		e.store_byte(rbx, vx, rax);
+		break;
+	case operation::or_registers:
+	case operation::and_registers:
+	case operation::xor_registers:
+		e.load_byte(rax, rbx, vx);
+		e.load_byte(rcx, rbx, vy);
+
+		if (decoded.op == operation::or_registers)
+			e.or8(rax, rcx);
+		else if (decoded.op == operation::and_registers)
+			e.and8(rax, rcx);
+		else
+			e.xor8(rax, rcx);
+
+		e.store_byte(rbx, vx, rax);
+		break;
+	case operation::add_registers:
+		e.load_byte(rax, rbx, vx);
+		e.load_byte(rcx, rbx, vy);
+		e.add8(rax, rcx);
+		e.setc(rdx);
+		e.store_byte(rbx, vf, rdx);
+		e.load_byte(rax, rbx, vx);
+		e.load_byte(rcx, rbx, vy);
+		e.add8(rax, rcx);
+		e.store_byte(rbx, vx, rax);
+		break;
+	case operation::subtract_registers:
+		e.load_byte(rax, rbx, vx);
+		e.load_byte(rcx, rbx, vy);
+		e.cmp8(rax, rcx);
+		e.setnc(rdx);
+		e.store_byte(rbx, vf, rdx);
+		e.load_byte(rax, rbx, vx);
+		e.load_byte(rcx, rbx, vy);
+		e.sub8(rax, rcx);
+		e.store_byte(rbx, vx, rax);
+		break;
+	case operation::subtract_reversed:
+		e.load_byte(rax, rbx, vx);
+		e.load_byte(rcx, rbx, vy);
+		e.cmp8(rcx, rax);
+		e.setnc(rdx);
+		e.store_byte(rbx, vf, rdx);
+		e.load_byte(rax, rbx, vx);
+		e.load_byte(rcx, rbx, vy);
+		e.sub8(rcx, rax);
+		e.store_byte(rbx, vx, rcx);
+		break;
+	case operation::shift_right:
+		e.load_byte(rax, rbx, vx);
+		e.and32_imm(rax, 1);
+		e.store_byte(rbx, vf, rax);
+		e.load_byte(rax, rbx, vx);
+		e.shr8(rax, 1);
+		e.store_byte(rbx, vx, rax);
+		break;
+	case operation::shift_left:
+		e.load_byte(rax, rbx, vx);
+		e.shr8(rax, 7);
+		e.store_byte(rbx, vf, rax);
+		e.load_byte(rax, rbx, vx);
+		e.shl8_1(rax);
+		e.store_byte(rbx, vx, rax);
+		break;
+	case operation::set_address:
+		e.store_word_imm(rbx, address_offset, decoded.nnn);
+		break;
+	case operation::add_to_address:
+		e.load_byte(rax, rbx, vx);
+		e.load_word(rcx, rbx, address_offset);
+		e.add32(rax, rcx);
+		e.cmp32_imm(rax, 0xFFF);
+		e.seta(rdx);
+		e.store_byte(rbx, vf, rdx);
+		e.load_byte(rax, rbx, vx);
+		e.load_word(rcx, rbx, address_offset);
+		e.add32(rax, rcx);
+		e.store_word(rbx, address_offset, rax);
+		break;
+	case operation::set_address_to_character:
+		e.load_byte(rax, rbx, vx);
+		e.multiply_by_5(rax, rax);
+		e.store_word(rbx, address_offset, rax);
+		break;
+	case operation::get_delay_timer:
+		e.load_byte(rax, rbx, delay_timer_offset);
+		e.store_byte(rbx, vx, rax);
+		break;
+	case operation::set_delay_timer:
+		e.load_byte(rax, rbx, vx);
+		e.store_byte(rbx, delay_timer_offset, rax);
+		break;
+	case operation::set_sound_timer:
+		e.load_byte(rax, rbx, vx);
+		e.store_byte(rbx, sound_timer_offset, rax);
+		break;
+	case operation::load_registers:
+		for (auto i = 0; i <= decoded.x; ++i)
+		{
+			e.load_word(rax, rbx, address_offset);
+			e.add32_imm(rax, i);
+			e.and32_imm(rax, chip8::memory_size - 1);
+			e.load_byte_indexed(rcx, rbx, rax, memory_offset);
+			e.store_byte(rbx, register_at(i), rcx);
+		}
+		break;
+	default:
+		// The interpreter advances the program counter itself, so it has to be up to date first
+		e.store_word_imm(rbx, program_counter_offset, address);
+		e.mov_reg64(argument_0, rbx);
+		e.mov_imm32(argument_1, decoded.instruction);
+		e.mov_imm64(rax, reinterpret_cast<uint64_t>(&execute_instruction));
+		e.call(rax);
+		break;
+	}
+}
+
+void jit_engine::emit_branch(const decoded_instruction& decoded, const uint16_t address)
+{
+	auto& e = m_emitter;
+
+	constexpr auto rax = x64_emitter::rax;
+	constexpr auto rbx = x64_emitter::rbx;
+	constexpr auto rcx = x64_emitter::rcx;
+
+	switch (decoded.op)
+	{
+	case operation::jump:
+		e.store_word_imm(rbx, program_counter_offset, decoded.nnn);
+		e.mov_imm32(rax, 1);
+		return;
+	case operation::call:
+	case operation::return_from_subroutine:
+		{
+			// Quitting leaves the program counter on the instruction that quit, so it is stored up front
+			e.store_word_imm(rbx, program_counter_offset, address);
+			e.load_byte(rax, rbx, stack_pointer_offset);
+
+			std::size_t quit;
+
+			if (decoded.op == operation::call)
+			{
+				e.cmp32_imm(rax, chip8::max_stacks);
+				quit = e.jump_if(x64_emitter::equal);
+				e.mov_imm32(rcx, address + 2);
+				e.store_word_indexed(rbx, rax, call_stack_offset, rcx);
+				e.add_byte_imm(rbx, stack_pointer_offset, 1);
+				e.store_word_imm(rbx, program_counter_offset, decoded.nnn);
+			}
+			else
+			{
+				e.test32(rax, rax);
+				quit = e.jump_if(x64_emitter::equal);
+				e.add32_imm(rax, 0xFFFFFFFF);
+				e.store_byte(rbx, stack_pointer_offset, rax);
+				e.load_word_indexed(rcx, rbx, rax, call_stack_offset);
+				e.store_word(rbx, program_counter_offset, rcx);
+			}
+
+			e.mov_imm32(rax, 1);
+			const auto done = e.jump();
+			e.bind(quit);
+			e.mov_imm32(rax, 0);
+			e.bind(done);
+		}
+		return;
+	default:
+		break;
+	}
+
+	const auto vx = register_at(decoded.x);
+	const auto vy = register_at(decoded.y);
+
+	// Skips are branch-free: the condition is turned into 0 or 1, and the program counter advances by 2 or 4
+	switch (decoded.op)
+	{
+	case operation::skip_if_equal:
+	case operation::skip_if_not_equal:
+		e.cmp_byte_imm(rbx, vx, decoded.nn);
+
+		if (decoded.op == operation::skip_if_equal)
+			e.sete(rax);
+		else
+			e.setne(rax);
+		break;
+	case operation::skip_if_registers_equal:
+	case operation::skip_if_registers_not_equal:
+		e.load_byte(rax, rbx, vx);
+		e.load_byte(rcx, rbx, vy);
+		e.cmp8(rax, rcx);
+
+		if (decoded.op == operation::skip_if_registers_equal)
+			e.sete(rax);
+		else
+			e.setne(rax);
+		break;
+	default:
+		e.load_word(rax, rbx, key_state_offset);
+		e.load_byte(rcx, rbx, vx);
+		e.and32_imm(rcx, 0xF);
+		e.shr32_cl(rax);
+		e.and32_imm(rax, 1);
+
+		if (decoded.op == operation::skip_if_key_not_pressed)
+			e.xor32_imm(rax, 1);
+		break;
+	}
+
+	e.zero_extend8(rax, rax);
+	e.add32(rax, rax);
+	e.add32_imm(rax, address + 2);
+	e.store_word(rbx, program_counter_offset, rax);
+	e.mov_imm32(rax, 1);
+}
+
+bool jit_engine::interpret_instruction()
+{
+	const auto address = chip8::wrap_address(m_chip8.program_counter);
+	const uint16_t instruction = (m_chip8.memory[address] << 8) | m_chip8.memory[chip8::wrap_address(address + 1)];
+
+	if (instruction == 0)
+		return false;
+
+	const auto decoded = decode(instruction);
+	const auto store_address = m_chip8.registers.address;
+	const auto continue_running = m_chip8.execute(decoded);
+
+	if (decoded.op == operation::store_bcd)
+		invalidate(store_address, 3);
+	else if (decoded.op == operation::store_registers)
+		invalidate(store_address, decoded.x + 1);
+
+	return continue_running;
+}
+
+void jit_engine::flush()
+{
+	m_blocks.fill(block{});
+	m_code_used = 0;
+}
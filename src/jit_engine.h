@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "chip8.h"
+#include "decoder.h"
+#include "x64_emitter.h"
+
+// Compiles straight-line runs of CHIP-8 instructions into native x86-64 code. Blocks end with a jump, skip, call or
+// return, or just before any instruction that can wait or write to memory; those instructions are run by the
+// interpreter, which keeps the results identical to chip8::execute. Writes made by FX33 and FX55 discard any compiled
+// blocks they overlap, but any other change to program memory made from outside must be followed by invalidate().
+// On platforms other than x86-64 every instruction is simply interpreted.
+class jit_engine
+{
+public:
+	static constexpr uint16_t max_block_length = 64;
+	static constexpr uint16_t compiled_memory_end = chip8::display_memory_start - 1;
+
+	jit_engine(chip8& emu);
+	~jit_engine();
+
+	jit_engine(const jit_engine&) = delete;
+	jit_engine& operator=(const jit_engine&) = delete;
+
+	// Runs at most max_cycles instructions, stopping early if the program quits, and returns how many ran
+	uint64_t run(uint64_t max_cycles);
+
+	void invalidate();
+	void invalidate(uint16_t address, uint16_t size);
+
+	[[nodiscard]] bool halted() const noexcept;
+	[[nodiscard]] static bool supported() noexcept;
+
+private:
+	using block_function = bool (*)(chip8*); // Returns false if the last instruction quit the program
+
+	struct block
+	{
+		block_function function = nullptr;
+		uint16_t length = 0; // In instructions, where 0 means the first instruction has to be interpreted
+		bool compiled = false;
+	};
+
+	chip8& m_chip8;
+	std::array<block, compiled_memory_end> m_blocks{};
+	x64_emitter m_emitter;
+	uint8_t* m_code_memory = nullptr;
+	std::size_t m_code_used = 0;
+	bool m_halted = false;
+
+	const block& find_block(uint16_t address);
+	block compile_block(uint16_t address);
+	void emit_instruction(const decoded_instruction& decoded, uint16_t address);
+	void emit_branch(const decoded_instruction& decoded, uint16_t address);
+	bool interpret_instruction();
+	void flush();
+};
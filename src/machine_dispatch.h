@@ -0,0 +1,65 @@
+#pragma once
+
+#include <memory>
+
+#include "chip8.h"
+
+enum class machine_type
+{
+	chip8,
+	super_chip,
+	xo_chip
+};
+
+enum class quirk_type
+{
+	machine, // Whichever quirks the machine has by default
+	chip8,
+	cosmac_vip,
+	super_chip,
+	xo_chip
+};
+
+// Machines are created on the heap since XO-CHIP's memory alone is over 64 KiB
+template<typename machine, typename function>
+auto with_new_machine(function&& body)
+{
+	const auto emu = std::make_unique<machine>();
+	return body(*emu);
+}
+
+template<typename profile, typename function>
+auto with_machine_quirks(const quirk_type quirks, function&& body)
+{
+	switch (quirks)
+	{
+	case quirk_type::chip8:
+		return with_new_machine<basic_chip8<profile, chip8_quirks>>(body);
+	case quirk_type::cosmac_vip:
+		return with_new_machine<basic_chip8<profile, cosmac_vip_quirks>>(body);
+	case quirk_type::super_chip:
+		return with_new_machine<basic_chip8<profile, super_chip_quirks>>(body);
+	case quirk_type::xo_chip:
+		return with_new_machine<basic_chip8<profile, xo_chip_quirks>>(body);
+	case quirk_type::machine:
+	default:
+		return with_new_machine<basic_chip8<profile>>(body);
+	}
+}
+
+// Calls body(emu) with a new machine of the type and quirks chosen at runtime. This is the only place they are
+// checked: body is instantiated for every combination, so whatever it runs is specialised for the one picked.
+template<typename function>
+auto with_machine(const machine_type machine, const quirk_type quirks, function&& body)
+{
+	switch (machine)
+	{
+	case machine_type::super_chip:
+		return with_machine_quirks<super_chip_profile>(quirks, body);
+	case machine_type::xo_chip:
+		return with_machine_quirks<xo_chip_profile>(quirks, body);
+	case machine_type::chip8:
+	default:
+		return with_machine_quirks<chip8_profile>(quirks, body);
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "decoder.h"
+
+// How a machine runs the opcodes that interpreters have disagreed on over the years. Like profiles these are fixed at
+// compile time, so every combination of machine and quirks gets its own interpreter.
+
+// The behaviour this emulator has always had, which most CHIP-8 ROMs written since the 90s expect
+struct chip8_quirks
+{
+	static constexpr bool shift_uses_vy = false; // 8XY6 and 8XYE shift Vy into Vx rather than shifting Vx in place
+	static constexpr bool load_store_increments_address = false; // FX55 and FX65 leave the address register after the last register
+	static constexpr bool jump_uses_vx = false; // BXNN jumps to XNN + Vx rather than BNNN jumping to NNN + V0
+	static constexpr bool clip_sprites = false; // Sprites are cut off at the edges of the display rather than wrapping around
+	static constexpr bool wait_for_vblank = false; // DXYN waits for the timers to tick, so sprites are drawn at most once a frame
+};
+
+// The original interpreter on the COSMAC VIP
+struct cosmac_vip_quirks
+{
+	static constexpr bool shift_uses_vy = true;
+	static constexpr bool load_store_increments_address = true;
+	static constexpr bool jump_uses_vx = false;
+	static constexpr bool clip_sprites = true;
+	static constexpr bool wait_for_vblank = true;
+};
+
+// SUPER-CHIP 1.1 on the HP-48
+struct super_chip_quirks
+{
+	static constexpr bool shift_uses_vy = false;
+	static constexpr bool load_store_increments_address = false;
+	static constexpr bool jump_uses_vx = true;
+	static constexpr bool clip_sprites = true;
+	static constexpr bool wait_for_vblank = false;
+};
+
+// XO-CHIP as Octo runs it
+struct xo_chip_quirks
+{
+	static constexpr bool shift_uses_vy = true;
+	static constexpr bool load_store_increments_address = true;
+	static constexpr bool jump_uses_vx = false;
+	static constexpr bool clip_sprites = false;
+	static constexpr bool wait_for_vblank = false;
+};
+
+// The machines basic_chip8 can be instantiated as. Everything a profile describes is fixed at compile time, so each
+// machine gets an interpreter of its own with no runtime checks for features it lacks.
+
+// Plain CHIP-8, which like the COSMAC VIP keeps the display at the top of its 4 KiB of memory
+struct chip8_profile
+{
+	static constexpr opcode_set opcodes = opcode_set::chip8;
+	static constexpr uint32_t memory_size = 4096;
+	static constexpr uint8_t display_width = 64;
+	static constexpr uint8_t display_height = 32;
+	static constexpr uint8_t display_planes = 1;
+	static constexpr uint8_t max_stacks = 12;
+	static constexpr bool display_in_memory = true; // Programs can read and write the display through memory
+	static constexpr std::array<uint8_t, 4> state_magic = { 'C', '8', 'S', 'T' };
+
+	using quirks = chip8_quirks; // Used unless basic_chip8 is given others
+};
+
+// SUPER-CHIP 1.1, with a 128x64 high resolution mode, 16x16 sprites, scrolling and a large font
+struct super_chip_profile
+{
+	static constexpr opcode_set opcodes = opcode_set::super_chip;
+	static constexpr uint32_t memory_size = 4096;
+	static constexpr uint8_t display_width = 128;
+	static constexpr uint8_t display_height = 64;
+	static constexpr uint8_t display_planes = 1;
+	static constexpr uint8_t max_stacks = 16;
+	static constexpr bool display_in_memory = false;
+	static constexpr std::array<uint8_t, 4> state_magic = { 'S', 'C', 'S', 'T' };
+
+	using quirks = super_chip_quirks;
+};
+
+// XO-CHIP, which extends SUPER-CHIP with 64 KiB of memory and a second display plane
+struct xo_chip_profile
+{
+	static constexpr opcode_set opcodes = opcode_set::xo_chip;
+	static constexpr uint32_t memory_size = 65536;
+	static constexpr uint8_t display_width = 128;
+	static constexpr uint8_t display_height = 64;
+	static constexpr uint8_t display_planes = 2;
+	static constexpr uint8_t max_stacks = 16;
+	static constexpr bool display_in_memory = false;
+	static constexpr std::array<uint8_t, 4> state_magic = { 'X', 'O', 'S', 'T' };
+
+	using quirks = xo_chip_quirks;
+};
@@ -1,6 +1,7 @@
 #include <cstdlib>
 #include <iostream>
 #include <stdexcept>
+#include <string>
 
 #include "emulator.h"
 
@@ -12,9 +13,38 @@ int main(int argc, char* argv[])
 		return EXIT_FAILURE;
 	}
 
+	if (argc != 2 && argc != 4)
+	{
+		std::cerr << "Usage: chip8-emu ROM [--record MOVIE | --replay MOVIE]\n";
+		return EXIT_FAILURE;
+	}
+
+	auto mode = emulator::movie_mode::none;
+	std::string movie_file_path;
+
+	if (argc == 4)
+	{
+		const std::string option = argv[2];
+		movie_file_path = argv[3];
+
+		if (option == "--record")
+		{
+			mode = emulator::movie_mode::record;
+		}
+		else if (option == "--replay")
+		{
+			mode = emulator::movie_mode::replay;
+		}
+		else
+		{
+			std::cerr << "Unknown option \"" << option << "\"\n";
+			return EXIT_FAILURE;
+		}
+	}
+
 	try
 	{
-		emulator emu(argv[1]);
+		emulator emu(argv[1], mode, movie_file_path);
 		emu.run();
 	}
 	catch (const std::exception& e)
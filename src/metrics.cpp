@@ -0,0 +1,244 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+namespace
+{
+	constexpr double smallest_frame_time_bound = 0.00025;
+	constexpr double buckets_per_octave = 4.0;
+
+	std::size_t frame_time_bucket(const std::chrono::nanoseconds time) noexcept
+	{
+		const auto seconds = std::chrono::duration<double>(time).count();
+
+		if (seconds <= smallest_frame_time_bound)
+			return 0;
+
+		const auto bucket = std::ceil(std::log2(seconds / smallest_frame_time_bound) * buckets_per_octave);
+		return static_cast<std::size_t>(std::min(bucket, static_cast<double>(metrics_snapshot::frame_time_buckets - 1)));
+	}
+
+	void write_header(std::ostream& out, const char* name, const char* type, const char* help)
+	{
+		out << "# HELP chip8_" << name << " " << help << "\n"
+			<< "# TYPE chip8_" << name << " " << type << "\n";
+	}
+
+	void write_summary(std::ostream& out, const char* name, const char* help, const uint64_t count, const uint64_t time_ns)
+	{
+		write_header(out, name, "summary", help);
+		out << "chip8_" << name << "_sum " << time_ns / 1e9 << "\n"
+			<< "chip8_" << name << "_count " << count << "\n";
+	}
+}
+
+double metrics_snapshot::frame_time_bound(const std::size_t bucket) noexcept
+{
+	if (bucket + 1 >= frame_time_buckets)
+		return std::numeric_limits<double>::infinity();
+
+	return smallest_frame_time_bound * std::exp2(bucket / buckets_per_octave);
+}
+
+metrics_snapshot metrics_snapshot::operator-(const metrics_snapshot& earlier) const noexcept
+{
+	metrics_snapshot difference;
+	difference.instructions = instructions - earlier.instructions;
+	difference.frames = frames - earlier.frames;
+	difference.frame_time_ns = frame_time_ns - earlier.frame_time_ns;
+	difference.renders = renders - earlier.renders;
+	difference.render_time_ns = render_time_ns - earlier.render_time_ns;
+	difference.uploads = uploads - earlier.uploads;
+	difference.upload_time_ns = upload_time_ns - earlier.upload_time_ns;
+	difference.audio_underruns = audio_underruns - earlier.audio_underruns;
+
+	for (std::size_t i = 0; i < frame_time_buckets; ++i)
+		difference.frame_time_counts[i] = frame_time_counts[i] - earlier.frame_time_counts[i];
+
+	return difference;
+}
+
+double metrics_snapshot::frame_time_percentile(const double percentile) const noexcept
+{
+	uint64_t total = 0;
+
+	for (const auto count : frame_time_counts)
+		total += count;
+
+	if (total == 0)
+		return 0.0;
+
+	const auto rank = percentile / 100.0 * total;
+	uint64_t below = 0;
+
+	for (std::size_t i = 0; i < frame_time_buckets; ++i)
+	{
+		const auto count = frame_time_counts[i];
+
+		if (count > 0 && below + count >= rank)
+		{
+			// The slowest bucket has no upper bound, so the best that can be said is that it is at least the one before
+			const auto lower = (i > 0) ? frame_time_bound(i - 1) : 0.0;
+
+			if (i + 1 == frame_time_buckets)
+				return lower;
+
+			return lower + (frame_time_bound(i) - lower) * std::clamp((rank - below) / count, 0.0, 1.0);
+		}
+
+		below += count;
+	}
+
+	return frame_time_bound(frame_time_buckets - 2);
+}
+
+double metrics_snapshot::mean_render_time() const noexcept
+{
+	return renders > 0 ? render_time_ns / 1e9 / renders : 0.0;
+}
+
+double metrics_snapshot::mean_upload_time() const noexcept
+{
+	return uploads > 0 ? upload_time_ns / 1e9 / uploads : 0.0;
+}
+
+void metrics_snapshot::write_prometheus(std::ostream& out) const
+{
+	out << std::setprecision(9);
+
+	write_header(out, "instructions_total", "counter", "CHIP-8 instructions emulated.");
+	out << "chip8_instructions_total " << instructions << "\n";
+
+	write_header(out, "frame_time_seconds", "histogram", "Time between the starts of consecutive frames.");
+	uint64_t cumulative = 0;
+
+	for (std::size_t i = 0; i < frame_time_buckets; ++i)
+	{
+		cumulative += frame_time_counts[i];
+		out << "chip8_frame_time_seconds_bucket{le=\"";
+
+		if (i + 1 == frame_time_buckets)
+			out << "+Inf";
+		else
+			out << frame_time_bound(i);
+
+		out << "\"} " << cumulative << "\n";
+	}
+
+	out << "chip8_frame_time_seconds_sum " << frame_time_ns / 1e9 << "\n"
+		<< "chip8_frame_time_seconds_count " << frames << "\n";
+
+	write_summary(out, "render_time_seconds", "Time spent drawing each frame, including texture uploads.", renders, render_time_ns);
+	write_summary(out, "upload_time_seconds", "Time spent converting and uploading changed display rows.", uploads, upload_time_ns);
+
+	write_header(out, "audio_underruns_total", "counter", "Times the tone ran out while the sound timer was still running.");
+	out << "chip8_audio_underruns_total " << audio_underruns << "\n";
+}
+
+void emulator_metrics::add_instructions(const uint64_t count) noexcept
+{
+	m_instructions.add(count);
+}
+
+void emulator_metrics::add_frame_time(const std::chrono::nanoseconds time) noexcept
+{
+	m_frames.add(1);
+	m_frame_time_ns.add(time.count());
+	m_frame_time_counts[frame_time_bucket(time)].add(1);
+}
+
+void emulator_metrics::add_render_time(const std::chrono::nanoseconds time) noexcept
+{
+	m_renders.add(1);
+	m_render_time_ns.add(time.count());
+}
+
+void emulator_metrics::add_upload_time(const std::chrono::nanoseconds time) noexcept
+{
+	m_uploads.add(1);
+	m_upload_time_ns.add(time.count());
+}
+
+void emulator_metrics::add_audio_underrun() noexcept
+{
+	m_audio_underruns.add(1);
+}
+
+metrics_snapshot emulator_metrics::snapshot() const noexcept
+{
+	// Each counter is read separately, so a snapshot taken mid-frame can be a frame behind in some of them
+	metrics_snapshot snap;
+	snap.instructions = m_instructions.value();
+	snap.frames = m_frames.value();
+	snap.frame_time_ns = m_frame_time_ns.value();
+	snap.renders = m_renders.value();
+	snap.render_time_ns = m_render_time_ns.value();
+	snap.uploads = m_uploads.value();
+	snap.upload_time_ns = m_upload_time_ns.value();
+	snap.audio_underruns = m_audio_underruns.value();
+
+	for (std::size_t i = 0; i < metrics_snapshot::frame_time_buckets; ++i)
+		snap.frame_time_counts[i] = m_frame_time_counts[i].value();
+
+	return snap;
+}
+
+metrics_exporter::metrics_exporter(const emulator_metrics& metrics, const std::string& file_path, const std::chrono::milliseconds interval)
+	: m_metrics(metrics), m_file_path(file_path), m_interval(interval), m_thread(&metrics_exporter::run, this)
+{
+}
+
+metrics_exporter::~metrics_exporter()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+
+	m_wake.notify_one();
+	m_thread.join();
+}
+
+void metrics_exporter::run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	// The file is written once more on the way out, so it ends up with the final totals
+	while (!m_wake.wait_for(lock, m_interval, [this] { return m_stopping; }))
+		write();
+
+	write();
+}
+
+void metrics_exporter::write()
+{
+	const auto temporary_path = m_file_path + ".tmp";
+
+	{
+		std::ofstream file(temporary_path);
+		m_metrics.snapshot().write_prometheus(file);
+
+		if (!file.good())
+		{
+			// Reported once, rather than every interval for the rest of the session
+			if (!m_reported_failure)
+				std::cerr << "Failed to write metrics to \"" << temporary_path << "\"\n";
+
+			m_reported_failure = true;
+			return;
+		}
+	}
+
+	// Renaming over an existing file fails on Windows, where it has to be removed first
+	if (std::rename(temporary_path.c_str(), m_file_path.c_str()) != 0)
+	{
+		std::remove(m_file_path.c_str());
+		std::rename(temporary_path.c_str(), m_file_path.c_str());
+	}
+}
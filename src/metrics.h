@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+// A running total written by one thread and read by any. As there is only ever one writer, adding to it is a plain
+// load and store rather than a locked read-modify-write.
+class metric_counter
+{
+public:
+	void add(const uint64_t amount) noexcept
+	{
+		m_value.store(m_value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+	}
+
+	[[nodiscard]] uint64_t value() const noexcept
+	{
+		return m_value.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<uint64_t> m_value{ 0 };
+};
+
+// Totals read from emulator_metrics at one moment. Subtracting an earlier snapshot gives the totals in between.
+struct metrics_snapshot
+{
+	// Frame times are counted in buckets a quarter of an octave apart from 0.25 ms to 256 ms, plus one for anything slower
+	static constexpr std::size_t frame_time_buckets = 42;
+
+	uint64_t instructions = 0;
+	uint64_t frames = 0;
+	uint64_t frame_time_ns = 0;
+	std::array<uint64_t, frame_time_buckets> frame_time_counts{};
+	uint64_t renders = 0;
+	uint64_t render_time_ns = 0;
+	uint64_t uploads = 0;
+	uint64_t upload_time_ns = 0;
+	uint64_t audio_underruns = 0;
+
+	// The upper bound of a frame time bucket in seconds, which is infinite for the last
+	[[nodiscard]] static double frame_time_bound(std::size_t bucket) noexcept;
+
+	[[nodiscard]] metrics_snapshot operator-(const metrics_snapshot& earlier) const noexcept;
+
+	// Interpolated within the bucket it falls in, in seconds
+	[[nodiscard]] double frame_time_percentile(double percentile) const noexcept;
+
+	[[nodiscard]] double mean_render_time() const noexcept;
+	[[nodiscard]] double mean_upload_time() const noexcept;
+
+	// The Prometheus text exposition format, with every metric prefixed by chip8_
+	void write_prometheus(std::ostream& out) const;
+};
+
+// Counters the emulator updates at most a few times a frame, never per instruction, so they cost next to nothing
+class emulator_metrics
+{
+public:
+	void add_instructions(uint64_t count) noexcept;
+	void add_frame_time(std::chrono::nanoseconds time) noexcept;
+	void add_render_time(std::chrono::nanoseconds time) noexcept;
+	void add_upload_time(std::chrono::nanoseconds time) noexcept;
+	void add_audio_underrun() noexcept;
+
+	[[nodiscard]] metrics_snapshot snapshot() const noexcept;
+
+private:
+	metric_counter m_instructions;
+	metric_counter m_frames;
+	metric_counter m_frame_time_ns;
+	std::array<metric_counter, metrics_snapshot::frame_time_buckets> m_frame_time_counts;
+	metric_counter m_renders;
+	metric_counter m_render_time_ns;
+	metric_counter m_uploads;
+	metric_counter m_upload_time_ns;
+	metric_counter m_audio_underruns;
+};
+
+// Rewrites a file with the current metrics on a thread of its own, for node_exporter's textfile collector or anything
+// else that reads the Prometheus format. The file is written beside the target and renamed over it, so readers never
+// see half of it.
+class metrics_exporter
+{
+public:
+	metrics_exporter(const emulator_metrics& metrics, const std::string& file_path, std::chrono::milliseconds interval);
+	~metrics_exporter();
+
+	metrics_exporter(const metrics_exporter&) = delete;
+	metrics_exporter& operator=(const metrics_exporter&) = delete;
+
+private:
+	const emulator_metrics& m_metrics;
+	std::string m_file_path;
+	std::chrono::milliseconds m_interval;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	bool m_stopping = false;
+	bool m_reported_failure = false;
+	std::thread m_thread;
+
+	void run();
+	void write();
+};
@@ -0,0 +1,212 @@
+#include "movie.h"
+
+#include <cstring>
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <stdexcept>
+
+namespace
+{
+	constexpr std::array<uint8_t, 4> magic = { 'C', '8', 'M', 'V' };
+
+	void write(std::vector<uint8_t>& data, const uint64_t value, const std::size_t size)
+	{
+		for (std::size_t i = 0; i < size; ++i)
+			data.push_back(static_cast<uint8_t>(value >> (i * 8)));
+	}
+
+	class reader
+	{
+	public:
+		reader(const std::vector<uint8_t>& data, const std::string& file_path)
+			: m_data(data), m_file_path(file_path)
+		{
+		}
+
+		uint64_t read(const std::size_t size)
+		{
+			if (m_position + size > m_data.size())
+				throw std::runtime_error("\"" + m_file_path + "\" is truncated");
+
+			uint64_t value = 0;
+
+			for (std::size_t i = 0; i < size; ++i)
+				value |= uint64_t{ m_data[m_position++] } << (i * 8);
+
+			return value;
+		}
+
+		[[nodiscard]] bool finished() const noexcept
+		{
+			return m_position == m_data.size();
+		}
+
+	private:
+		const std::vector<uint8_t>& m_data;
+		const std::string& m_file_path;
+		std::size_t m_position = 0;
+	};
+}
+
+void movie::record(const movie_frame& frame)
+{
+	if (!m_runs.empty() && m_runs.back().frame == frame && m_runs.back().length < UINT32_MAX)
+		++m_runs.back().length;
+	else
+		m_runs.push_back({ frame, 1 });
+}
+
+uint64_t movie::frame_count() const noexcept
+{
+	uint64_t count = 0;
+
+	for (const auto& run : m_runs)
+		count += run.length;
+
+	return count;
+}
+
+void movie::save(const std::string& file_path) const
+{
+	// Little-endian throughout, with the clock speed stored as the bits of an IEEE 754 double
+	std::vector<uint8_t> data(magic.begin(), magic.end());
+	uint64_t cycles_bits = 0;
+	std::memcpy(&cycles_bits, &cycles_per_frame, sizeof(cycles_bits));
+
+	write(data, version, 2);
+	write(data, seed, 4);
+	write(data, cycles_bits, 8);
+	write(data, program_hash, 8);
+	write(data, m_runs.size(), 4);
+
+	for (const auto& run : m_runs)
+	{
+		write(data, run.length, 4);
+		write(data, run.frame.key_state, 2);
+		write(data, run.frame.timer_ticks, 1);
+		write(data, run.frame.key_changes.size(), 2);
+
+		for (const auto& change : run.frame.key_changes)
+		{
+			write(data, change.offset, 4);
+			write(data, change.key_state, 2);
+		}
+	}
+
+	std::ofstream file(file_path, std::ios::binary);
+
+	if (!file.is_open())
+		throw std::runtime_error("Failed to open \"" + file_path + "\" for writing");
+
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+	if (!file)
+		throw std::runtime_error("Failed to write \"" + file_path + "\"");
+}
+
+movie movie::load(const std::string& file_path)
+{
+	std::ifstream file(file_path, std::ios::binary);
+
+	if (!file.is_open())
+		throw std::runtime_error("Failed to open \"" + file_path + "\"");
+
+	const std::vector<uint8_t> data{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+	reader in(data, file_path);
+
+	for (const auto byte : magic)
+	{
+		if (in.read(1) != byte)
+			throw std::runtime_error("\"" + file_path + "\" is not a movie");
+	}
+
+	if (in.read(2) != version)
+		throw std::runtime_error("\"" + file_path + "\" was recorded by an incompatible version");
+
+	movie loaded;
+	loaded.seed = static_cast<uint32_t>(in.read(4));
+
+	const auto cycles_bits = in.read(8);
+	std::memcpy(&loaded.cycles_per_frame, &cycles_bits, sizeof(cycles_bits));
+
+	loaded.program_hash = in.read(8);
+
+	const auto run_count = in.read(4);
+
+	for (uint64_t i = 0; i < run_count; ++i)
+	{
+		run r;
+		r.length = static_cast<uint32_t>(in.read(4));
+		r.frame.key_state = static_cast<uint16_t>(in.read(2));
+		r.frame.timer_ticks = static_cast<uint8_t>(in.read(1));
+
+		const auto change_count = in.read(2);
+
+		for (uint64_t j = 0; j < change_count; ++j)
+		{
+			key_change change;
+			change.offset = static_cast<uint32_t>(in.read(4));
+			change.key_state = static_cast<uint16_t>(in.read(2));
+
+			r.frame.key_changes.push_back(change);
+		}
+
+		loaded.m_runs.push_back(r);
+	}
+
+	if (!in.finished())
+		throw std::runtime_error("\"" + file_path + "\" has trailing data");
+
+	return loaded;
+}
+
+movie_player::movie_player(const movie& recording) noexcept
+	: m_movie(recording)
+{
+}
+
+bool movie_player::next(movie_frame& frame)
+{
+	while (m_run < m_movie.m_runs.size() && m_played == m_movie.m_runs[m_run].length)
+	{
+		++m_run;
+		m_played = 0;
+	}
+
+	if (m_run == m_movie.m_runs.size())
+		return false;
+
+	frame = m_movie.m_runs[m_run].frame;
+	++m_played;
+
+	return true;
+}
+
+uint64_t program_hash(const chip8& emu) noexcept
+{
+	uint64_t hash = 0xCBF29CE484222325;
+
+	for (auto i = chip8::program_memory_start; i < chip8::program_memory_end; ++i)
+	{
+		hash ^= emu.memory[i];
+		hash *= 0x100000001B3;
+	}
+
+	return hash;
+}
+
+uint64_t next_frame_cycles(const double cycles_per_frame, double& cycle_budget) noexcept
+{
+	cycle_budget += cycles_per_frame;
+	const auto cycles = static_cast<uint64_t>(cycle_budget);
+	cycle_budget -= static_cast<double>(cycles);
+
+	return cycles;
+}
+
+void apply_frame_input(chip8& emu, const movie_frame& frame) noexcept
+{
+	emu.set_key_state(frame.key_state);
+	emu.tick_timers(frame.timer_ticks);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "chip8.h"
+
+// The keys held from partway through a frame onwards
+struct key_change
+{
+	uint32_t offset = 0; // Instructions run in the frame before the change applies
+	uint16_t key_state = 0;
+
+	[[nodiscard]] bool operator==(const key_change& other) const noexcept
+	{
+		return offset == other.offset && key_state == other.key_state;
+	}
+};
+
+// The input to a single emulated frame, which is all a run depends on besides the ROM, seed and clock speed
+struct movie_frame
+{
+	uint16_t key_state = 0; // Held as the frame starts
+	uint8_t timer_ticks = 0; // Timer ticks applied before the frame runs
+	std::vector<key_change> key_changes; // In order of offset
+
+	[[nodiscard]] bool operator==(const movie_frame& other) const noexcept
+	{
+		return key_state == other.key_state && timer_ticks == other.timer_ticks && key_changes == other.key_changes;
+	}
+};
+
+// A recording of every frame of input to a run, stored as runs of identical frames. Replaying the frames into a
+// machine started from the same ROM with the same seed and clock speed reproduces the run exactly.
+class movie
+{
+public:
+	static constexpr uint16_t version = 3;
+
+	uint32_t seed = 0;
+	double cycles_per_frame = 10.0;
+	uint64_t program_hash = 0; // Of the program memory the run started from, to catch replays of the wrong ROM
+
+	void record(const movie_frame& frame);
+
+	[[nodiscard]] uint64_t frame_count() const noexcept;
+
+	// Throws std::runtime_error if the file cannot be written or read, or is not a movie of this version
+	void save(const std::string& file_path) const;
+	static movie load(const std::string& file_path);
+
+private:
+	friend class movie_player;
+
+	struct run
+	{
+		movie_frame frame;
+		uint32_t length = 0;
+	};
+
+	std::vector<run> m_runs;
+};
+
+// Steps through the frames of a movie in order
+class movie_player
+{
+public:
+	explicit movie_player(const movie& recording) noexcept;
+
+	// Returns false once every frame has been played
+	bool next(movie_frame& frame);
+
+private:
+	const movie& m_movie;
+	std::size_t m_run = 0;
+	uint32_t m_played = 0; // Frames played from the current run
+};
+
+// 64-bit FNV-1a hash of program memory
+[[nodiscard]] uint64_t program_hash(const chip8& emu) noexcept;
+
+// Returns how many instructions the next frame runs, carrying fractional cycles over to the frame after in cycle_budget
+[[nodiscard]] uint64_t next_frame_cycles(double cycles_per_frame, double& cycle_budget) noexcept;
+
+// Applies the input for the start of a frame. Recording and replaying both go through here and next_frame_cycles() so
+// that frames line up exactly.
+void apply_frame_input(chip8& emu, const movie_frame& frame) noexcept;
+
+// Runs the instructions of a frame through run(count), which runs up to count instructions and returns how many it did,
+// applying each key change once the instructions before it have run. Changes past the end of the frame apply after its
+// last instruction. Returns how many instructions ran, which is fewer than cycles once the program halts.
+template<typename function>
+uint64_t run_frame_input(chip8& emu, const movie_frame& frame, const uint64_t cycles, function&& run)
+{
+	uint64_t executed = 0;
+
+	for (const auto& change : frame.key_changes)
+	{
+		const auto offset = std::min<uint64_t>(change.offset, cycles);
+
+		if (offset > executed)
+		{
+			const auto count = offset - executed;
+			const uint64_t ran = run(count);
+			executed += ran;
+
+			if (ran < count)
+				return executed;
+		}
+
+		emu.set_key_state(change.key_state);
+	}
+
+	if (executed < cycles)
+		executed += run(cycles - executed);
+
+	return executed;
+}
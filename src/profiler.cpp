@@ -0,0 +1,164 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <string>
+#include <utility>
+
+namespace
+{
+	std::string hex_address(const uint16_t address)
+	{
+		constexpr char digits[] = "0123456789ABCDEF";
+		return { digits[(address >> 8) & 0xF], digits[(address >> 4) & 0xF], digits[address & 0xF] };
+	}
+
+	double percent(const uint64_t count, const uint64_t total)
+	{
+		return total > 0 ? 100.0 * count / total : 0.0;
+	}
+}
+
+execution_profiler::execution_profiler()
+{
+	// The root of the call tree has no subroutine of its own, since profiling may start anywhere
+	m_nodes.emplace_back();
+	m_stack.push_back({ 0, 0 });
+}
+
+void execution_profiler::record(const chip8&, const uint16_t address, const decoded_instruction& decoded)
+{
+	++m_instructions;
+	++m_operation_counts[static_cast<std::size_t>(decoded.op)];
+	++m_address_counts[address];
+
+	// The call is counted in the caller, and the return in the subroutine it leaves
+	++m_nodes[m_stack.back().node].self_instructions;
+
+	if (decoded.op == operation::call)
+	{
+		m_stack.push_back({ find_child(m_stack.back().node, decoded.nnn), m_instructions });
+		++m_calls[decoded.nnn].calls;
+	}
+	else if (decoded.op == operation::return_from_subroutine && m_stack.size() > 1)
+	{
+		const auto frame = m_stack.back();
+		m_stack.pop_back();
+		m_calls[m_nodes[frame.node].address].inclusive_instructions += m_instructions - frame.start_instructions;
+	}
+}
+
+uint64_t execution_profiler::instructions() const noexcept
+{
+	return m_instructions;
+}
+
+uint64_t execution_profiler::executions(const operation op) const noexcept
+{
+	return m_operation_counts[static_cast<std::size_t>(op)];
+}
+
+uint64_t execution_profiler::executions_at(const uint16_t address) const noexcept
+{
+	return m_address_counts[chip8::wrap_address(address)];
+}
+
+std::map<uint16_t, execution_profiler::subroutine_stats> execution_profiler::subroutines() const
+{
+	auto stats = m_calls;
+
+	for (const auto& node : m_nodes)
+	{
+		if (&node != &m_nodes.front())
+			stats[node.address].self_instructions += node.self_instructions;
+	}
+
+	return stats;
+}
+
+void execution_profiler::write_flat_profile(std::ostream& out) const
+{
+	out << std::fixed << std::setprecision(2);
+
+	std::vector<std::pair<uint64_t, operation>> operations;
+
+	for (std::size_t i = 0; i < operation_count; ++i)
+	{
+		if (m_operation_counts[i] > 0)
+			operations.emplace_back(m_operation_counts[i], static_cast<operation>(i));
+	}
+
+	std::sort(operations.rbegin(), operations.rend());
+
+	out << "Instructions: " << m_instructions << "\n\n"
+		<< "Operation       Count        %\n";
+
+	for (const auto& [count, op] : operations)
+		out << std::left << std::setw(8) << operation_pattern(op) << std::right << std::setw(13) << count << std::setw(9) << percent(count, m_instructions) << "\n";
+
+	std::vector<std::pair<uint64_t, uint16_t>> addresses;
+
+	for (std::size_t address = 0; address < m_address_counts.size(); ++address)
+	{
+		if (m_address_counts[address] > 0)
+			addresses.emplace_back(m_address_counts[address], static_cast<uint16_t>(address));
+	}
+
+	std::sort(addresses.rbegin(), addresses.rend());
+
+	out << "\nAddress         Count        %\n";
+
+	for (const auto& [count, address] : addresses)
+		out << std::left << std::setw(8) << hex_address(address) << std::right << std::setw(13) << count << std::setw(9) << percent(count, m_instructions) << "\n";
+
+	std::vector<std::pair<uint64_t, uint16_t>> order;
+	const auto stats = subroutines();
+
+	for (const auto& [address, subroutine] : stats)
+		order.emplace_back(subroutine.self_instructions, address);
+
+	std::sort(order.rbegin(), order.rend());
+
+	out << "\nSubroutine      Calls         Self        %    Inclusive\n";
+
+	for (const auto& [self, address] : order)
+	{
+		const auto& subroutine = stats.at(address);
+		out << std::left << std::setw(8) << hex_address(address) << std::right << std::setw(13) << subroutine.calls
+			<< std::setw(13) << self << std::setw(9) << percent(self, m_instructions) << std::setw(13) << subroutine.inclusive_instructions << "\n";
+	}
+}
+
+void execution_profiler::write_collapsed_stacks(std::ostream& out) const
+{
+	for (std::size_t i = 0; i < m_nodes.size(); ++i)
+	{
+		if (m_nodes[i].self_instructions == 0)
+			continue;
+
+		std::vector<std::size_t> path;
+
+		for (auto node = i; node != 0; node = m_nodes[node].parent)
+			path.push_back(node);
+
+		out << "start";
+
+		for (auto node = path.rbegin(); node != path.rend(); ++node)
+			out << ";sub_" << hex_address(m_nodes[*node].address);
+
+		out << " " << m_nodes[i].self_instructions << "\n";
+	}
+}
+
+std::size_t execution_profiler::find_child(const std::size_t node, const uint16_t address)
+{
+	for (const auto child : m_nodes[node].children)
+	{
+		if (m_nodes[child].address == address)
+			return child;
+	}
+
+	m_nodes.push_back({ address, node, 0, {} });
+	m_nodes[node].children.push_back(m_nodes.size() - 1);
+	return m_nodes.size() - 1;
+}
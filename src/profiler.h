@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <vector>
+
+#include "chip8.h"
+#include "decoder.h"
+
+// Counts the instructions run through chip8::next_instruction(profiler) by operation and by address, and follows
+// 2NNN and 00EE to attribute them to subroutines. A subroutine's inclusive count includes every call it makes,
+// so a recursive one is counted once for each call still running beneath it.
+class execution_profiler
+{
+public:
+	struct subroutine_stats
+	{
+		uint64_t calls = 0;
+		uint64_t self_instructions = 0; // Run in the subroutine itself
+		uint64_t inclusive_instructions = 0; // Run between each call and its return, for calls that have returned
+	};
+
+	execution_profiler();
+
+	void record(const chip8& emu, uint16_t address, const decoded_instruction& decoded);
+
+	[[nodiscard]] uint64_t instructions() const noexcept;
+	[[nodiscard]] uint64_t executions(operation op) const noexcept;
+	[[nodiscard]] uint64_t executions_at(uint16_t address) const noexcept;
+
+	// Keyed by the address each subroutine starts at, with the code the profiler started in under its own address
+	[[nodiscard]] std::map<uint16_t, subroutine_stats> subroutines() const;
+
+	// Operations, addresses and subroutines, each sorted with the most instructions first
+	void write_flat_profile(std::ostream& out) const;
+
+	// One line of "start;sub_2A0;sub_31C count" for every call stack, as read by flamegraph.pl and speedscope
+	void write_collapsed_stacks(std::ostream& out) const;
+
+private:
+	// The call tree, where each node is a subroutine reached through one particular chain of calls
+	struct call_node
+	{
+		uint16_t address = 0;
+		std::size_t parent = 0;
+		uint64_t self_instructions = 0;
+		std::vector<std::size_t> children;
+	};
+
+	struct call_frame
+	{
+		std::size_t node;
+		uint64_t start_instructions;
+	};
+
+	std::array<uint64_t, operation_count> m_operation_counts{};
+	std::array<uint64_t, chip8::memory_size> m_address_counts{};
+	std::vector<call_node> m_nodes;
+	std::vector<call_frame> m_stack;
+	std::map<uint16_t, subroutine_stats> m_calls; // Only calls and inclusive_instructions are filled in
+	uint64_t m_instructions = 0;
+
+	std::size_t find_child(std::size_t node, uint16_t address);
+};
@@ -0,0 +1,147 @@
+#include "rewind_buffer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+	// Each run of changed bytes is stored as a 16-bit count of unchanged bytes to skip, a 16-bit length and the XOR of
+	// the changed bytes. Gaps shorter than a run header are folded into the surrounding run.
+	constexpr std::size_t run_header_size = 4;
+
+	static_assert(chip8::state_size <= 0xFFFF, "Run offsets and lengths are 16-bit");
+
+	// Every run is followed by a gap of at least run_header_size bytes, which bounds the size of an encoded delta
+	constexpr std::size_t max_delta_size = chip8::state_size + (chip8::state_size / run_header_size + 1) * run_header_size;
+}
+
+rewind_buffer::rewind_buffer(const std::size_t max_frames, const std::size_t capacity)
+	: m_data(capacity), m_entries(max_frames), m_scratch(max_delta_size)
+{
+	if (max_frames == 0 || capacity < max_delta_size)
+		throw std::invalid_argument("Rewind buffer is too small to hold a single frame");
+}
+
+void rewind_buffer::record(const chip8& emu)
+{
+	const auto next = emu.save_state();
+
+	if (!m_has_current)
+	{
+		m_current = next;
+		m_has_current = true;
+		return;
+	}
+
+	const auto size = encode_delta(next);
+	m_current = next;
+
+	while (m_entry_count == m_entries.size() || m_data_used + size > m_data.size())
+		drop_oldest();
+
+	const auto offset = (m_data_start + m_data_used) % m_data.size();
+
+	for (std::size_t i = 0; i < size; ++i)
+		m_data[(offset + i) % m_data.size()] = m_scratch[i];
+
+	m_entries[(m_first_entry + m_entry_count) % m_entries.size()] = { offset, size };
+	m_data_used += size;
+	++m_entry_count;
+}
+
+bool rewind_buffer::step_back(chip8& emu)
+{
+	if (m_entry_count == 0)
+		return false;
+
+	const auto& last = m_entries[(m_first_entry + m_entry_count - 1) % m_entries.size()];
+	const auto byte = [&](const std::size_t i) { return m_data[(last.offset + i) % m_data.size()]; };
+
+	// XOR the newest delta back out of the current state
+	std::size_t position = 0;
+
+	for (std::size_t i = 0; i < last.size;)
+	{
+		const auto skip = byte(i) | (byte(i + 1) << 8);
+		const auto length = byte(i + 2) | (byte(i + 3) << 8);
+		i += run_header_size;
+		position += skip;
+
+		for (auto j = 0; j < length; ++j)
+			m_current[position++] ^= byte(i++);
+	}
+
+	m_data_used -= last.size;
+	--m_entry_count;
+
+	emu.load_state(m_current.data(), m_current.size());
+	return true;
+}
+
+void rewind_buffer::clear() noexcept
+{
+	m_has_current = false;
+	m_data_start = 0;
+	m_data_used = 0;
+	m_first_entry = 0;
+	m_entry_count = 0;
+}
+
+std::size_t rewind_buffer::frames() const noexcept
+{
+	return m_entry_count;
+}
+
+std::size_t rewind_buffer::bytes_used() const noexcept
+{
+	return m_data_used;
+}
+
+std::size_t rewind_buffer::encode_delta(const state& next)
+{
+	std::size_t size = 0;
+	std::size_t previous_end = 0;
+
+	for (std::size_t position = 0; position < next.size();)
+	{
+		if (next[position] == m_current[position])
+		{
+			++position;
+			continue;
+		}
+
+		// Extend the run until it reaches a gap too long to be worth including
+		auto end = position + 1;
+		auto gap = std::size_t{ 0 };
+
+		for (; end < next.size() && gap < run_header_size; ++end)
+			gap = next[end] == m_current[end] ? gap + 1 : 0;
+
+		end -= gap;
+
+		const auto skip = position - previous_end;
+		const auto length = end - position;
+
+		m_scratch[size++] = static_cast<uint8_t>(skip);
+		m_scratch[size++] = static_cast<uint8_t>(skip >> 8);
+		m_scratch[size++] = static_cast<uint8_t>(length);
+		m_scratch[size++] = static_cast<uint8_t>(length >> 8);
+
+		for (; position < end; ++position)
+			m_scratch[size++] = next[position] ^ m_current[position];
+
+		previous_end = end;
+	}
+
+	return size;
+}
+
+void rewind_buffer::drop_oldest() noexcept
+{
+	const auto& oldest = m_entries[m_first_entry];
+
+	m_data_start = (m_data_start + oldest.size) % m_data.size();
+	m_data_used -= oldest.size;
+	m_first_entry = (m_first_entry + 1) % m_entries.size();
+	--m_entry_count;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "chip8.h"
+
+// Keeps a history of machine states as XOR deltas between consecutive frames, so that the emulator can step
+// backwards. Consecutive frames rarely differ in more than a few bytes, so each delta only stores the runs of bytes
+// that changed. All memory is allocated up front, and the oldest frames are dropped once either the frame limit or the
+// byte capacity is reached.
+class rewind_buffer
+{
+public:
+	rewind_buffer(std::size_t max_frames, std::size_t capacity);
+
+	// Records the state at the end of a frame
+	void record(const chip8& emu);
+
+	// Restores the frame before the last one recorded, returning false once there is no history left
+	bool step_back(chip8& emu);
+
+	void clear() noexcept;
+
+	// How many times step_back() can currently succeed
+	[[nodiscard]] std::size_t frames() const noexcept;
+	[[nodiscard]] std::size_t bytes_used() const noexcept;
+
+private:
+	using state = std::array<uint8_t, chip8::state_size>;
+
+	struct entry
+	{
+		std::size_t offset = 0;
+		std::size_t size = 0;
+	};
+
+	state m_current{};
+	bool m_has_current = false;
+
+	std::vector<uint8_t> m_data; // Ring of encoded deltas
+	std::size_t m_data_start = 0;
+	std::size_t m_data_used = 0;
+
+	std::vector<entry> m_entries; // Ring of deltas, oldest first
+	std::size_t m_first_entry = 0;
+	std::size_t m_entry_count = 0;
+
+	std::vector<uint8_t> m_scratch;
+
+	std::size_t encode_delta(const state& next);
+	void drop_oldest() noexcept;
+};
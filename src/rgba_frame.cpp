@@ -0,0 +1,31 @@
+#include "rgba_frame.h"
+
+#include <algorithm>
+
+void rgba_frame::set_colours(const colour& foreground, const colour& background) noexcept
+{
+	for (std::size_t byte = 0; byte < m_lookup.size(); ++byte)
+	{
+		for (std::size_t bit = 0; bit < 8; ++bit)
+		{
+			const auto& pixel_colour = ((byte >> (7 - bit)) & 1) ? foreground : background;
+			std::copy(pixel_colour.begin(), pixel_colour.end(), &m_lookup[byte][bit * bytes_per_pixel]);
+		}
+	}
+}
+
+const uint8_t* rgba_frame::convert_rows(const chip8& emu, const unsigned int first_row, const unsigned int row_count) noexcept
+{
+	const auto* source = &emu.memory[chip8::display_memory_start + first_row * chip8::display_row_size];
+	auto* const pixels = &m_pixels[first_row * row_pitch];
+	auto* destination = pixels;
+
+	for (auto i = 0u; i < row_count * chip8::display_row_size; ++i)
+	{
+		const auto& block = m_lookup[source[i]];
+		std::copy(block.begin(), block.end(), destination);
+		destination += block.size();
+	}
+
+	return pixels;
+}
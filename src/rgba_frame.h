@@ -0,0 +1,30 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "chip8.h"
+
+// The display expanded to 32-bit RGBA pixels, ready to be uploaded to a texture
+class rgba_frame
+{
+public:
+	static constexpr std::size_t bytes_per_pixel = 4;
+	static constexpr std::size_t row_pitch = chip8::display_width * bytes_per_pixel;
+
+	using colour = std::array<uint8_t, bytes_per_pixel>;
+
+	// Rows converted before the colours change need converting again
+	void set_colours(const colour& foreground, const colour& background) noexcept;
+
+	// Expands a run of display rows, returning their first pixel
+	const uint8_t* convert_rows(const chip8& emu, unsigned int first_row, unsigned int row_count) noexcept;
+
+private:
+	// Each byte of display memory expands to 8 pixels, so every possible byte is looked up rather than tested per bit
+	using pixel_block = std::array<uint8_t, 8 * bytes_per_pixel>;
+
+	std::array<uint8_t, chip8::display_height * row_pitch> m_pixels{};
+	std::array<pixel_block, 256> m_lookup{};
+};
@@ -0,0 +1,372 @@
+#include "rom_analysis.h"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+#include "decoder.h"
+
+namespace
+{
+	// Operations are listed in the order machines added them, so the first of each machine's marks where it starts
+	machine_type required_machine(const operation op) noexcept
+	{
+		if (op >= operation::scroll_up && op != operation::unknown)
+			return machine_type::xo_chip;
+
+		if (op >= operation::scroll_down && op != operation::unknown)
+			return machine_type::super_chip;
+
+		return machine_type::chip8;
+	}
+
+	// Most quirks cannot be told apart from the instructions alone, so each machine's own are assumed, except that a
+	// CHIP-8 ROM shifting one register into another only makes sense where shifts read Vy, as on the COSMAC VIP
+	quirk_type guess_quirks(const machine_type machine, const bool shifts_from_vy) noexcept
+	{
+		switch (machine)
+		{
+		case machine_type::super_chip:
+			return quirk_type::super_chip;
+		case machine_type::xo_chip:
+			return quirk_type::xo_chip;
+		case machine_type::chip8:
+		default:
+			return shifts_from_vy ? quirk_type::cosmac_vip : quirk_type::chip8;
+		}
+	}
+
+	class rom_reader
+	{
+	public:
+		rom_reader(const uint8_t* rom, const std::size_t size) noexcept
+			: m_rom(rom), m_size(size)
+		{
+		}
+
+		// Whether a whole instruction can be read at the address, rather than running off the end of the ROM
+		[[nodiscard]] bool contains(const uint32_t address) const noexcept
+		{
+			return address >= chip8::program_memory_start && address - chip8::program_memory_start + 2 <= m_size;
+		}
+
+		[[nodiscard]] uint16_t instruction(const uint32_t address) const noexcept
+		{
+			const auto offset = address - chip8::program_memory_start;
+			return static_cast<uint16_t>((m_rom[offset] << 8) | m_rom[offset + 1]);
+		}
+
+		// Skips jump over the whole of the next instruction, which on XO-CHIP may be four bytes long
+		[[nodiscard]] uint32_t after(const uint32_t address) const noexcept
+		{
+			return address + (contains(address) ? instruction_size(instruction(address)) : 2);
+		}
+
+	private:
+		const uint8_t* m_rom;
+		std::size_t m_size;
+	};
+
+	struct control_flow
+	{
+		std::array<uint32_t, 2> successors{};
+		std::size_t successor_count = 0;
+		bool ends_block = true; // Anything but carrying on to the next instruction ends a basic block
+	};
+
+	// Where control can go once an instruction has run, which is nowhere known for returns, BNNN and anything that stops
+	control_flow follow(const rom_reader& reader, const uint32_t address, const decoded_instruction& decoded) noexcept
+	{
+		const auto next = reader.after(address);
+
+		switch (decoded.op)
+		{
+		case operation::jump:
+			return { { decoded.nnn }, 1 };
+		case operation::call:
+			return { { decoded.nnn, next }, 2 };
+		case operation::skip_if_equal:
+		case operation::skip_if_not_equal:
+		case operation::skip_if_registers_equal:
+		case operation::skip_if_registers_not_equal:
+		case operation::skip_if_key_pressed:
+		case operation::skip_if_key_not_pressed:
+			return { { next, reader.after(next) }, 2 };
+		case operation::jump_with_offset:
+		case operation::return_from_subroutine:
+		case operation::exit:
+		case operation::unknown:
+			return {};
+		default:
+			return { { next }, 1, false };
+		}
+	}
+
+	enum class address_knowledge
+	{
+		unreached, // No path into the block has been followed yet
+		known,
+		unknown // Either set at runtime or different along different paths
+	};
+
+	// What the analysis knows about I at a point in the program
+	struct index_register
+	{
+		address_knowledge knowledge = address_knowledge::unreached;
+		uint32_t address = 0;
+	};
+
+	// Combines I from another path into a block, returning whether that changed what is known
+	bool merge(index_register& into, const index_register& from) noexcept
+	{
+		if (from.knowledge == address_knowledge::unreached || into.knowledge == address_knowledge::unknown)
+			return false;
+
+		if (into.knowledge == address_knowledge::unreached)
+		{
+			into = from;
+			return true;
+		}
+
+		if (from.knowledge == address_knowledge::known && from.address == into.address)
+			return false;
+
+		into.knowledge = address_knowledge::unknown;
+		return true;
+	}
+
+	// Follows I through a block, marking the sprites drawn from it when asked to. Returns I at the end of the block and
+	// sets ends_with_call, since a subroutine may change I before returning to the next block.
+	index_register follow_address(const rom_reader& reader, const basic_block& block, index_register index, rom_analysis& analysis,
+		const bool mark_sprites, bool& ends_with_call)
+	{
+		for (auto pc = block.start; pc < block.end; pc = reader.after(pc))
+		{
+			const auto decoded = decode<opcode_set::xo_chip>(reader.instruction(pc));
+			ends_with_call = decoded.op == operation::call;
+
+			switch (decoded.op)
+			{
+			case operation::set_address:
+				index = { address_knowledge::known, decoded.nnn };
+				break;
+			case operation::load_long_address:
+				index.knowledge = reader.contains(pc + 2) ? address_knowledge::known : address_knowledge::unknown;
+				index.address = reader.contains(pc + 2) ? reader.instruction(pc + 2) : 0;
+				break;
+			case operation::add_to_address:
+			case operation::set_address_to_character:
+			case operation::set_address_to_large_character:
+			case operation::store_registers:
+			case operation::load_registers:
+				// These move I, or do on some interpreters
+				index.knowledge = address_knowledge::unknown;
+				break;
+			case operation::draw_sprite:
+				if (mark_sprites && index.knowledge == address_knowledge::known)
+				{
+					// DXY0 draws a 16x16 sprite on SUPER-CHIP and XO-CHIP, and nothing on CHIP-8
+					const auto sprite_size = decoded.n > 0 ? decoded.n : (analysis.machine != machine_type::chip8 ? 32 : 0);
+
+					for (auto i = index.address; i < index.address + sprite_size; ++i)
+					{
+						if (i >= chip8::program_memory_start && i - chip8::program_memory_start < analysis.sprite_data.size())
+							analysis.sprite_data[i - chip8::program_memory_start] = true;
+					}
+				}
+				break;
+			default:
+				break;
+			}
+		}
+
+		return index;
+	}
+
+	// Finds where I is the same on every path into a block, and marks the sprites drawn from those addresses
+	void find_sprites(const rom_reader& reader, rom_analysis& analysis)
+	{
+		const auto& blocks = analysis.blocks;
+		std::vector<index_register> entries(blocks.size());
+		std::vector<std::size_t> pending;
+
+		if (!blocks.empty() && blocks.front().start == chip8::program_memory_start)
+		{
+			entries.front().knowledge = address_knowledge::unknown;
+			pending.push_back(0);
+		}
+
+		// Returns blocks.size() if no block starts at the address
+		const auto block_at = [&blocks](const uint32_t address) {
+			const auto found = std::lower_bound(blocks.begin(), blocks.end(), address,
+				[](const basic_block& block, const uint32_t start) { return block.start < start; });
+
+			return found != blocks.end() && found->start == address ? static_cast<std::size_t>(found - blocks.begin()) : blocks.size();
+		};
+
+		// Each block's entry can only change twice, from unreached to known to unknown, so this soon settles
+		while (!pending.empty())
+		{
+			const auto block = pending.back();
+			pending.pop_back();
+
+			auto ends_with_call = false;
+			const auto exit = follow_address(reader, blocks[block], entries[block], analysis, false, ends_with_call);
+
+			for (const auto address : blocks[block].successors)
+			{
+				// A call returns to the address after it
+				const auto returned = ends_with_call && address == blocks[block].end;
+				const auto successor = block_at(address);
+
+				if (successor < blocks.size() && merge(entries[successor], returned ? index_register{ address_knowledge::unknown } : exit))
+					pending.push_back(successor);
+			}
+		}
+
+		for (std::size_t block = 0; block < blocks.size(); ++block)
+		{
+			auto ends_with_call = false;
+			follow_address(reader, blocks[block], entries[block], analysis, true, ends_with_call);
+		}
+	}
+}
+
+std::size_t rom_analysis::code_size() const noexcept
+{
+	return static_cast<std::size_t>(std::count(code.begin(), code.end(), true));
+}
+
+std::size_t rom_analysis::sprite_data_size() const noexcept
+{
+	return static_cast<std::size_t>(std::count(sprite_data.begin(), sprite_data.end(), true));
+}
+
+std::size_t rom_analysis::used_size() const noexcept
+{
+	auto size = code.size();
+
+	while (size > 0 && !code[size - 1] && !sprite_data[size - 1])
+		--size;
+
+	return size;
+}
+
+rom_analysis analyze_rom(const uint8_t* rom, const std::size_t size, const bool follow_indirect_jumps)
+{
+	const rom_reader reader(rom, size);
+
+	rom_analysis analysis;
+	analysis.instruction_starts.resize(size);
+	analysis.code.resize(size);
+	analysis.sprite_data.resize(size);
+
+	std::vector<bool> block_starts(size);
+	std::vector<uint32_t> pending = { chip8::program_memory_start };
+	auto shifts_from_vy = false;
+
+	if (reader.contains(chip8::program_memory_start))
+		block_starts[0] = true;
+
+	// Where a BNNN jump may go, which is nowhere known unless its targets are being followed
+	const auto indirect_targets = [follow_indirect_jumps](const decoded_instruction& decoded) {
+		std::vector<uint32_t> targets;
+
+		if (follow_indirect_jumps && decoded.op == operation::jump_with_offset)
+		{
+			for (uint32_t offset = 0; offset <= 0xFF; ++offset)
+				targets.push_back(decoded.nnn + offset);
+		}
+
+		return targets;
+	};
+
+	while (!pending.empty())
+	{
+		const auto address = pending.back();
+		pending.pop_back();
+
+		// Anything outside the ROM is empty memory, which is not followed any further
+		if (!reader.contains(address) || analysis.instruction_starts[address - chip8::program_memory_start])
+			continue;
+
+		const auto offset = address - chip8::program_memory_start;
+		const auto decoded = decode<opcode_set::xo_chip>(reader.instruction(address));
+		const auto flow = follow(reader, address, decoded);
+		const auto end = std::min<std::size_t>(reader.after(address) - chip8::program_memory_start, size);
+
+		analysis.instruction_starts[offset] = true;
+		std::fill(analysis.code.begin() + offset, analysis.code.begin() + end, true);
+		analysis.machine = std::max(analysis.machine, required_machine(decoded.op));
+		analysis.indirect_jumps |= decoded.op == operation::jump_with_offset;
+		shifts_from_vy |= (decoded.op == operation::shift_right || decoded.op == operation::shift_left) && decoded.x != decoded.y;
+
+		for (std::size_t i = 0; i < flow.successor_count; ++i)
+		{
+			const auto successor = flow.successors[i];
+			pending.push_back(successor);
+
+			if (flow.ends_block && reader.contains(successor))
+				block_starts[successor - chip8::program_memory_start] = true;
+		}
+
+		for (const auto target : indirect_targets(decoded))
+		{
+			pending.push_back(target);
+
+			if (reader.contains(target))
+				block_starts[target - chip8::program_memory_start] = true;
+		}
+	}
+
+	// Each block runs until it branches or reaches the start of another
+	for (std::size_t offset = 0; offset < size; ++offset)
+	{
+		if (!block_starts[offset])
+			continue;
+
+		basic_block block;
+		block.start = static_cast<uint32_t>(chip8::program_memory_start + offset);
+
+		for (auto address = block.start;;)
+		{
+			const auto decoded = decode<opcode_set::xo_chip>(reader.instruction(address));
+			const auto flow = follow(reader, address, decoded);
+			address = reader.after(address);
+
+			if (flow.ends_block)
+			{
+				for (std::size_t i = 0; i < flow.successor_count; ++i)
+				{
+					if (reader.contains(flow.successors[i]))
+						block.successors.push_back(flow.successors[i]);
+				}
+
+				for (const auto target : indirect_targets(decoded))
+				{
+					if (reader.contains(target))
+						block.successors.push_back(target);
+				}
+
+				block.end = address;
+				break;
+			}
+
+			// Running off the end of the ROM ends the block with nowhere to go
+			if (!reader.contains(address) || block_starts[address - chip8::program_memory_start])
+			{
+				if (reader.contains(address))
+					block.successors.push_back(address);
+
+				block.end = address;
+				break;
+			}
+		}
+
+		analysis.blocks.push_back(std::move(block));
+	}
+
+	analysis.quirks = guess_quirks(analysis.machine, shifts_from_vy);
+	find_sprites(reader, analysis);
+	return analysis;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "machine_dispatch.h"
+
+// A run of instructions that control only enters at the top and leaves at the bottom
+struct basic_block
+{
+	uint32_t start = 0; // Address of the first instruction
+	uint32_t end = 0; // Address after the last instruction
+	std::vector<uint32_t> successors; // Blocks control can continue into, which for a call includes the one it returns to
+};
+
+// What static analysis finds in a ROM loaded at chip8::program_memory_start, by following every jump, call and skip
+// from the entry point. Instructions are decoded as XO-CHIP, whose opcodes cover every other machine's.
+struct rom_analysis
+{
+	// One of each per ROM byte
+	std::vector<bool> instruction_starts; // Set where a reachable instruction starts
+	std::vector<bool> code; // Set for every byte of every reachable instruction
+	std::vector<bool> sprite_data; // Set for bytes drawn by DXYN where I is the same on every path to it
+
+	std::vector<basic_block> blocks; // Sorted by address
+	machine_type machine = machine_type::chip8; // The first machine with an opcode for every reachable instruction
+	quirk_type quirks = quirk_type::chip8; // A guess at the quirks the ROM was written for, from the instructions it uses
+	bool indirect_jumps = false; // BNNN was reached, so unless its targets were followed some code may have been missed
+
+	// Bytes taken up by reachable instructions, with the rest being data or unused
+	[[nodiscard]] std::size_t code_size() const noexcept;
+
+	[[nodiscard]] std::size_t sprite_data_size() const noexcept;
+
+	// The ROM's size without any trailing bytes that are neither code nor sprites, which it can be trimmed to
+	// unless indirect jumps may reach code that was missed
+	[[nodiscard]] std::size_t used_size() const noexcept;
+};
+
+// Setting follow_indirect_jumps follows all 256 targets BNNN could jump to as well, so nothing reachable is missed at the
+// cost of taking whatever data lies after the base address for code, as chip8-aot needs
+rom_analysis analyze_rom(const uint8_t* rom, std::size_t size, bool follow_indirect_jumps = false);
+
+// The bytes an instruction takes up, which is four for XO-CHIP's F000 NNNN and two for anything else
+[[nodiscard]] constexpr uint16_t instruction_size(const uint16_t instruction) noexcept
+{
+	return instruction == 0xF000 ? 4 : 2;
+}
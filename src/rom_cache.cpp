@@ -0,0 +1,287 @@
+#include "rom_cache.h"
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <ios>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include "rom_analysis.h"
+#include "rom_file.h"
+
+namespace
+{
+	constexpr std::array<uint8_t, 4> magic = { 'C', '8', 'R', 'C' };
+	constexpr uint16_t version = 4;
+
+	void write(std::vector<uint8_t>& data, const uint64_t value, const std::size_t size)
+	{
+		for (std::size_t i = 0; i < size; ++i)
+			data.push_back(static_cast<uint8_t>(value >> (i * 8)));
+	}
+
+	// Reads little-endian values, returning false once it runs out of data
+	class reader
+	{
+	public:
+		explicit reader(const std::vector<uint8_t>& data) noexcept
+			: m_data(data)
+		{
+		}
+
+		bool read(const std::size_t size, uint64_t& value) noexcept
+		{
+			if (size > m_data.size() - m_position)
+				return false;
+
+			value = 0;
+
+			for (std::size_t i = 0; i < size; ++i)
+				value |= uint64_t{ m_data[m_position++] } << (i * 8);
+
+			return true;
+		}
+
+		[[nodiscard]] bool finished() const noexcept
+		{
+			return m_position == m_data.size();
+		}
+
+	private:
+		const std::vector<uint8_t>& m_data;
+		std::size_t m_position = 0;
+	};
+
+	bool valid_machine(const uint64_t machine, const uint64_t quirks) noexcept
+	{
+		return machine <= static_cast<uint8_t>(machine_type::xo_chip) && quirks <= static_cast<uint8_t>(quirk_type::xo_chip);
+	}
+
+	std::vector<uint8_t> serialize(const rom_cache_entry& entry)
+	{
+		std::vector<uint8_t> data(magic.begin(), magic.end());
+
+		write(data, version, 2);
+		write(data, entry.rom.size(), 4);
+		data.insert(data.end(), entry.rom.begin(), entry.rom.end());
+
+		write(data, static_cast<uint8_t>(entry.machine), 1);
+		write(data, static_cast<uint8_t>(entry.quirks), 1);
+		write(data, entry.code_size, 4);
+		write(data, entry.known_results.size(), 4);
+
+		for (const auto& result : entry.known_results)
+		{
+			write(data, static_cast<uint8_t>(result.machine), 1);
+			write(data, static_cast<uint8_t>(result.quirks), 1);
+			write(data, result.cycles, 8);
+			write(data, result.cycles_per_frame, 4);
+			write(data, result.seed, 4);
+			write(data, result.state_hash, 8);
+		}
+
+		return data;
+	}
+
+	bool deserialize(const std::vector<uint8_t>& data, rom_cache_entry& entry)
+	{
+		reader in(data);
+		uint64_t value = 0;
+
+		for (const auto byte : magic)
+		{
+			if (!in.read(1, value) || value != byte)
+				return false;
+		}
+
+		if (!in.read(2, value) || value != version || !in.read(4, value))
+			return false;
+
+		const auto rom_size = static_cast<std::size_t>(value);
+
+		if (rom_size > data.size())
+			return false;
+
+		entry.rom.resize(rom_size);
+
+		for (auto& byte : entry.rom)
+		{
+			if (!in.read(1, value))
+				return false;
+
+			byte = static_cast<uint8_t>(value);
+		}
+
+		uint64_t machine = 0;
+		uint64_t quirks = 0;
+
+		if (!in.read(1, machine) || !in.read(1, quirks) || !valid_machine(machine, quirks) || !in.read(4, value))
+			return false;
+
+		entry.machine = static_cast<machine_type>(machine);
+		entry.quirks = static_cast<quirk_type>(quirks);
+		entry.code_size = static_cast<uint32_t>(value);
+
+		if (!in.read(4, value) || value > data.size())
+			return false;
+
+		entry.known_results.resize(static_cast<std::size_t>(value));
+
+		for (auto& result : entry.known_results)
+		{
+			uint64_t machine = 0;
+			uint64_t quirks = 0;
+			uint64_t cycles = 0;
+			uint64_t cycles_per_frame = 0;
+			uint64_t seed = 0;
+			uint64_t hash = 0;
+
+			if (!in.read(1, machine) || !in.read(1, quirks) || !valid_machine(machine, quirks) || !in.read(8, cycles)
+				|| !in.read(4, cycles_per_frame) || !in.read(4, seed) || !in.read(8, hash))
+				return false;
+
+			result.machine = static_cast<machine_type>(machine);
+			result.quirks = static_cast<quirk_type>(quirks);
+			result.cycles = cycles;
+			result.cycles_per_frame = static_cast<uint32_t>(cycles_per_frame);
+			result.seed = static_cast<uint32_t>(seed);
+			result.state_hash = hash;
+		}
+
+		return in.finished();
+	}
+}
+
+uint64_t content_hash(const uint8_t* data, const std::size_t size) noexcept
+{
+	uint64_t hash = 0xCBF29CE484222325;
+
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		hash ^= data[i];
+		hash *= 0x100000001B3;
+	}
+
+	return hash;
+}
+
+const known_result* rom_cache_entry::find_known_result(const known_result& run) const noexcept
+{
+	const auto found = std::find_if(known_results.begin(), known_results.end(),
+		[&run](const known_result& result) { return result.same_run(run); });
+
+	return found != known_results.end() ? &*found : nullptr;
+}
+
+rom_cache::rom_cache(std::string directory)
+	: m_directory(std::move(directory))
+{
+	std::error_code error;
+	std::filesystem::create_directories(m_directory, error);
+
+	if (error)
+		throw std::runtime_error("Failed to create the ROM cache \"" + m_directory + "\": " + error.message());
+}
+
+bool rom_cache::find(const uint8_t* rom, const std::size_t size, rom_cache_entry& entry) const
+{
+	std::vector<uint8_t> data;
+
+	try
+	{
+		data = read_rom_file(entry_path(rom, size), std::numeric_limits<std::size_t>::max());
+	}
+	catch (const std::runtime_error&)
+	{
+		return false;
+	}
+
+	// The ROM itself is compared in case of a hash collision
+	rom_cache_entry found;
+
+	if (!deserialize(data, found) || !std::equal(rom, rom + size, found.rom.begin(), found.rom.end()))
+		return false;
+
+	entry = std::move(found);
+	return true;
+}
+
+rom_cache_entry rom_cache::add(const uint8_t* rom, const std::size_t size) const
+{
+	const auto analysis = analyze_rom(rom, size);
+
+	rom_cache_entry entry;
+	entry.rom.assign(rom, rom + size);
+	entry.machine = analysis.machine;
+	entry.quirks = analysis.quirks;
+	entry.code_size = static_cast<uint32_t>(analysis.code_size());
+	store(entry);
+
+	return entry;
+}
+
+void rom_cache::store(const rom_cache_entry& entry) const
+{
+	// The entry is read again just before it is replaced, so that results stored by another process since this one
+	// read it are merged in rather than lost
+	auto merged = entry;
+	rom_cache_entry stored;
+
+	if (find(entry.rom.data(), entry.rom.size(), stored))
+	{
+		for (const auto& result : stored.known_results)
+		{
+			if (!merged.find_known_result(result))
+				merged.known_results.push_back(result);
+		}
+	}
+
+	const auto data = serialize(merged);
+	const auto path = entry_path(entry.rom.data(), entry.rom.size());
+
+	// Named randomly so that processes storing the same entry at once each write their own file
+	std::ostringstream temporary_path;
+	temporary_path << path << '.' << std::hex << std::random_device{}() << ".tmp";
+
+	std::ofstream file(temporary_path.str(), std::ios::binary);
+
+	if (!file.is_open())
+		throw std::runtime_error("Failed to open \"" + temporary_path.str() + "\" for writing");
+
+	file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+	file.close();
+
+	std::error_code error;
+
+	// A partly written file is removed so that failed stores do not leave anything behind in a shared cache
+	if (!file)
+	{
+		std::filesystem::remove(temporary_path.str(), error);
+		throw std::runtime_error("Failed to write \"" + temporary_path.str() + "\"");
+	}
+
+	std::filesystem::rename(temporary_path.str(), path, error);
+
+	if (error)
+	{
+		const auto message = error.message();
+		std::filesystem::remove(temporary_path.str(), error);
+		throw std::runtime_error("Failed to write \"" + path + "\": " + message);
+	}
+}
+
+std::string rom_cache::entry_path(const uint8_t* rom, const std::size_t size) const
+{
+	std::ostringstream name;
+	name << std::hex;
+	name.width(16);
+	name.fill('0');
+	name << content_hash(rom, size);
+
+	return (std::filesystem::path(m_directory) / (name.str() + ".c8rc")).string();
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "machine_dispatch.h"
+
+// 64-bit FNV-1a hash, which names a ROM's entry in a rom_cache
+[[nodiscard]] uint64_t content_hash(const uint8_t* data, std::size_t size) noexcept;
+
+template<typename machine>
+[[nodiscard]] uint64_t state_hash(const machine& emu) noexcept
+{
+	const auto state = emu.save_state();
+	return content_hash(state.data(), state.size());
+}
+
+// The final state of a run that has been checked, so later runs with the same settings can be compared against it
+struct known_result
+{
+	machine_type machine = machine_type::chip8;
+	quirk_type quirks = quirk_type::machine;
+	uint64_t cycles = 0; // The most instructions the run was allowed
+	uint32_t cycles_per_frame = 0;
+	uint32_t seed = 0;
+	uint64_t state_hash = 0;
+
+	[[nodiscard]] bool same_run(const known_result& other) const noexcept
+	{
+		return machine == other.machine && quirks == other.quirks && cycles == other.cycles
+			&& cycles_per_frame == other.cycles_per_frame && seed == other.seed;
+	}
+};
+
+struct rom_cache_entry
+{
+	std::vector<uint8_t> rom;
+
+	// From analyze_rom(), which only has to run when a ROM is first added. The machine and quirks are those the ROM
+	// runs as when none are given.
+	machine_type machine = machine_type::chip8;
+	quirk_type quirks = quirk_type::chip8;
+	uint32_t code_size = 0;
+
+	std::vector<known_result> known_results;
+
+	// Returns nullptr if no run with the same settings has been recorded
+	[[nodiscard]] const known_result* find_known_result(const known_result& run) const noexcept;
+};
+
+// ROMs and what is known about them, stored on disk under a hash of each ROM so that batch jobs running the same ROMs
+// again can skip analysing them and check their results against earlier runs. Entries are written to a temporary file
+// and renamed into place, so any number of processes can share a cache and only ever read whole entries.
+class rom_cache
+{
+public:
+	// Creates the directory if it does not exist, throwing std::runtime_error if it cannot
+	explicit rom_cache(std::string directory);
+
+	// Returns false if the ROM is not cached, or its entry cannot be read
+	bool find(const uint8_t* rom, std::size_t size, rom_cache_entry& entry) const;
+
+	// Analyses and stores a ROM, replacing any entry it already had. Throws std::runtime_error if it cannot be written.
+	rom_cache_entry add(const uint8_t* rom, std::size_t size) const;
+
+	// Also used to add known results to an entry, keeping any another process has stored since the entry was read.
+	// Throws std::runtime_error if it cannot be written.
+	void store(const rom_cache_entry& entry) const;
+
+	[[nodiscard]] std::string entry_path(const uint8_t* rom, std::size_t size) const;
+
+private:
+	std::string m_directory;
+};
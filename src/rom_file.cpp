@@ -0,0 +1,86 @@
+#include "rom_file.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <ios>
+#include <stdexcept>
+
+namespace
+{
+	using clock = std::chrono::steady_clock;
+
+	// Opens a ROM without a stream buffer, so reads go straight into the caller's memory, and returns its size
+	std::size_t open_rom_file(std::ifstream& file, const std::string& rom_file_path)
+	{
+		file.rdbuf()->pubsetbuf(nullptr, 0);
+		file.open(rom_file_path, std::ios::binary | std::ios::ate);
+
+		if (!file.is_open())
+			throw std::runtime_error("Failed to open \"" + rom_file_path + "\"");
+
+		const auto end = file.tellg();
+
+		if (end < 0 || !file.seekg(0))
+			throw std::runtime_error("Failed to read \"" + rom_file_path + "\"");
+
+		return static_cast<std::size_t>(end);
+	}
+
+	std::size_t checked_load_size(const std::size_t rom_size, const std::size_t program_memory_size, const oversized_rom oversized,
+		const std::string& rom_name)
+	{
+		if (rom_size > program_memory_size && oversized == oversized_rom::reject)
+			throw std::runtime_error("\"" + rom_name + "\" is too large to fit in program memory");
+
+		return std::min(rom_size, program_memory_size);
+	}
+
+	double milliseconds_since(const clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+	}
+}
+
+std::vector<uint8_t> read_rom_file(const std::string& rom_file_path, const std::size_t max_size)
+{
+	std::ifstream file;
+	const auto size = open_rom_file(file, rom_file_path);
+	std::vector<uint8_t> rom(checked_load_size(size, max_size, oversized_rom::reject, rom_file_path));
+
+	if (!file.read(reinterpret_cast<char*>(rom.data()), static_cast<std::streamsize>(rom.size())))
+		throw std::runtime_error("Failed to read \"" + rom_file_path + "\"");
+
+	return rom;
+}
+
+rom_load_result load_rom_file(const std::string& rom_file_path, uint8_t* program_memory, const std::size_t program_memory_size,
+	const oversized_rom oversized)
+{
+	const auto start = clock::now();
+
+	std::ifstream file;
+	rom_load_result result;
+	result.rom_size = open_rom_file(file, rom_file_path);
+	result.loaded_size = checked_load_size(result.rom_size, program_memory_size, oversized, rom_file_path);
+
+	if (!file.read(reinterpret_cast<char*>(program_memory), static_cast<std::streamsize>(result.loaded_size)))
+		throw std::runtime_error("Failed to read \"" + rom_file_path + "\"");
+
+	result.load_time_ms = milliseconds_since(start);
+	return result;
+}
+
+rom_load_result load_rom(const uint8_t* rom, const std::size_t rom_size, uint8_t* program_memory,
+	const std::size_t program_memory_size, const oversized_rom oversized, const std::string& rom_name)
+{
+	const auto start = clock::now();
+
+	rom_load_result result;
+	result.rom_size = rom_size;
+	result.loaded_size = checked_load_size(rom_size, program_memory_size, oversized, rom_name);
+	std::copy(rom, rom + result.loaded_size, program_memory);
+
+	result.load_time_ms = milliseconds_since(start);
+	return result;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "chip8.h"
+
+// What to do with a ROM that is too large for the program memory it is loaded into
+enum class oversized_rom
+{
+	reject, // Throws std::runtime_error without touching memory
+	truncate // Loads as much as fits
+};
+
+struct rom_load_result
+{
+	std::size_t loaded_size = 0; // Bytes copied into program memory
+	std::size_t rom_size = 0; // Bytes in the ROM, which is more than loaded_size if it was truncated
+	double load_time_ms = 0.0;
+
+	[[nodiscard]] bool truncated() const noexcept
+	{
+		return loaded_size < rom_size;
+	}
+};
+
+// Reads a whole ROM, throwing std::runtime_error if it cannot be opened or is larger than max_size, which is
+// CHIP-8's program memory unless another machine's is given
+std::vector<uint8_t> read_rom_file(const std::string& rom_file_path,
+	std::size_t max_size = chip8::program_memory_end - chip8::program_memory_start);
+
+// Reads a ROM file straight into program_memory with a single read, throwing std::runtime_error if it cannot be read
+rom_load_result load_rom_file(const std::string& rom_file_path, uint8_t* program_memory, std::size_t program_memory_size,
+	oversized_rom oversized);
+
+// Copies a ROM that is already in memory, such as one from a rom_pack, naming it as rom_name in any error
+rom_load_result load_rom(const uint8_t* rom, std::size_t rom_size, uint8_t* program_memory, std::size_t program_memory_size,
+	oversized_rom oversized, const std::string& rom_name);
+
+// The above for the program memory of any machine, which is expected to be fresh from its constructor since memory
+// past the end of the ROM is left as it was
+template<typename machine>
+rom_load_result load_rom_file(machine& emu, const std::string& rom_file_path, const oversized_rom oversized = oversized_rom::reject)
+{
+	return load_rom_file(rom_file_path, emu.memory.data() + machine::program_memory_start,
+		machine::program_memory_end - machine::program_memory_start, oversized);
+}
+
+template<typename machine>
+rom_load_result load_rom(machine& emu, const uint8_t* rom, const std::size_t rom_size, const std::string& rom_name,
+	const oversized_rom oversized = oversized_rom::reject)
+{
+	return load_rom(rom, rom_size, emu.memory.data() + machine::program_memory_start,
+		machine::program_memory_end - machine::program_memory_start, oversized, rom_name);
+}
@@ -0,0 +1,148 @@
+#include "rom_pack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "rom_file.h"
+
+namespace
+{
+	constexpr std::size_t block_size = 512;
+
+	// Offsets and lengths of the header fields used, from the POSIX ustar format
+	constexpr std::size_t name_offset = 0;
+	constexpr std::size_t name_length = 100;
+	constexpr std::size_t size_offset = 124;
+	constexpr std::size_t size_length = 12;
+	constexpr std::size_t checksum_offset = 148;
+	constexpr std::size_t checksum_length = 8;
+	constexpr std::size_t type_offset = 156;
+	constexpr std::size_t magic_offset = 257;
+	constexpr std::size_t prefix_offset = 345;
+	constexpr std::size_t prefix_length = 155;
+
+	std::string read_string(const uint8_t* field, const std::size_t length)
+	{
+		const auto end = std::find(field, field + length, 0);
+		return std::string(field, end);
+	}
+
+	// Numbers are octal digits padded with spaces or NULs, returning false for anything else
+	bool read_octal(const uint8_t* field, const std::size_t length, std::size_t& value)
+	{
+		value = 0;
+		auto digits = false;
+
+		for (std::size_t i = 0; i < length; ++i)
+		{
+			const auto c = field[i];
+
+			if (c == ' ' || c == 0)
+			{
+				if (digits)
+					break;
+
+				continue;
+			}
+
+			if (c < '0' || c > '7')
+				return false;
+
+			value = (value * 8) + (c - '0');
+			digits = true;
+		}
+
+		return true;
+	}
+
+	// The sum of every byte in the header, counting the checksum field itself as spaces
+	std::size_t header_checksum(const uint8_t* header)
+	{
+		std::size_t sum = 0;
+
+		for (std::size_t i = 0; i < block_size; ++i)
+			sum += (i >= checksum_offset && i < checksum_offset + checksum_length) ? ' ' : header[i];
+
+		return sum;
+	}
+}
+
+rom_pack::rom_pack(std::vector<uint8_t> archive, const std::string& pack_name)
+	: m_archive(std::move(archive))
+{
+	std::size_t position = 0;
+	std::string long_name; // From a GNU long name entry, for the entry after it
+
+	// The archive ends with blocks of zeros, although some writers leave them out
+	while (position + block_size <= m_archive.size())
+	{
+		const auto* header = &m_archive[position];
+
+		if (std::all_of(header, header + block_size, [](const uint8_t byte) { return byte == 0; }))
+			break;
+
+		std::size_t size;
+		std::size_t checksum;
+
+		if (!read_octal(header + size_offset, size_length, size) || !read_octal(header + checksum_offset, checksum_length, checksum)
+			|| checksum != header_checksum(header))
+			throw std::runtime_error("\"" + pack_name + "\" has a corrupt header at byte " + std::to_string(position));
+
+		const auto data_offset = position + block_size;
+
+		if (size > m_archive.size() - data_offset)
+			throw std::runtime_error("\"" + pack_name + "\" is truncated");
+
+		const auto type = header[type_offset];
+
+		if (type == 'L')
+		{
+			long_name = read_string(&m_archive[data_offset], size);
+		}
+		else
+		{
+			// Regular files, skipping directories, links and extended headers
+			if (type == '0' || type == '\0' || type == '7')
+			{
+				auto name = read_string(header + name_offset, name_length);
+				const auto prefix = read_string(header + prefix_offset, prefix_length);
+
+				if (!long_name.empty())
+					name = long_name;
+				else if (std::memcmp(header + magic_offset, "ustar", 5) == 0 && !prefix.empty())
+					name = prefix + "/" + name;
+
+				m_entry_indices.emplace(name, m_entries.size());
+				m_entries.push_back({ name, data_offset, size });
+			}
+
+			long_name.clear();
+		}
+
+		position = data_offset + ((size + block_size - 1) / block_size) * block_size;
+	}
+}
+
+rom_pack rom_pack::load(const std::string& pack_file_path)
+{
+	return rom_pack(read_rom_file(pack_file_path, std::numeric_limits<std::size_t>::max()), pack_file_path);
+}
+
+const std::vector<rom_pack::entry>& rom_pack::entries() const noexcept
+{
+	return m_entries;
+}
+
+const rom_pack::entry* rom_pack::find(const std::string& name) const noexcept
+{
+	const auto found = m_entry_indices.find(name);
+	return found != m_entry_indices.end() ? &m_entries[found->second] : nullptr;
+}
+
+const uint8_t* rom_pack::data(const entry& rom) const noexcept
+{
+	return m_archive.data() + rom.offset;
+}
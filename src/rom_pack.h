@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A tar archive of ROMs held in memory, so that a sweep over thousands of ROMs reads one file rather than opening
+// every ROM on its own. Only regular files are listed, under their full path within the archive.
+class rom_pack
+{
+public:
+	struct entry
+	{
+		std::string name;
+		std::size_t offset = 0; // Of the ROM's first byte within the archive
+		std::size_t size = 0;
+	};
+
+	// Throws std::runtime_error if the archive is truncated or a header is corrupt, naming it as pack_name
+	rom_pack(std::vector<uint8_t> archive, const std::string& pack_name);
+
+	// Reads a whole archive in a single read, throwing std::runtime_error if it cannot be read or is not valid
+	static rom_pack load(const std::string& pack_file_path);
+
+	[[nodiscard]] const std::vector<entry>& entries() const noexcept;
+
+	// Returns nullptr if the archive holds no ROM by that name
+	[[nodiscard]] const entry* find(const std::string& name) const noexcept;
+
+	[[nodiscard]] const uint8_t* data(const entry& rom) const noexcept;
+
+private:
+	std::vector<uint8_t> m_archive;
+	std::vector<entry> m_entries;
+	std::unordered_map<std::string, std::size_t> m_entry_indices; // By name, keeping the first of any duplicates
+};
@@ -0,0 +1,112 @@
+#include "snapshot.h"
+
+#include <algorithm>
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <stdexcept>
+
+namespace
+{
+	constexpr std::size_t mask_offset = chip8::state_header_size + chip8::machine_state_size;
+	constexpr std::size_t blocks_offset = mask_offset + 8;
+
+	bool block_changed(const chip8& base, const chip8& emu, const std::size_t block)
+	{
+		for (std::size_t i = block * snapshot_block_size; i < (block + 1) * snapshot_block_size; ++i)
+		{
+			if (base.memory[i] != emu.memory[i])
+				return true;
+		}
+
+		return false;
+	}
+}
+
+std::vector<uint8_t> save_delta_state(const chip8& base, const chip8& emu)
+{
+	uint64_t changed_blocks = 0;
+
+	for (std::size_t block = 0; block < snapshot_block_count; ++block)
+	{
+		if (block_changed(base, emu, block))
+			changed_blocks |= uint64_t{ 1 } << block;
+	}
+
+	std::vector<uint8_t> state(blocks_offset);
+	emu.write_state_header(state.data(), chip8::state_kind::delta);
+	emu.write_machine_state(state.data() + chip8::state_header_size);
+
+	for (std::size_t i = 0; i < 8; ++i)
+		state[mask_offset + i] = static_cast<uint8_t>(changed_blocks >> (i * 8));
+
+	for (std::size_t block = 0; block < snapshot_block_count; ++block)
+	{
+		if ((changed_blocks >> block) & 1)
+		{
+			const auto first = emu.memory.begin() + block * snapshot_block_size;
+			state.insert(state.end(), first, first + snapshot_block_size);
+		}
+	}
+
+	return state;
+}
+
+bool load_delta_state(chip8& emu, const uint8_t* state, const std::size_t size)
+{
+	if (size < blocks_offset || !chip8::check_state_header(state, chip8::state_kind::delta))
+		return false;
+
+	uint64_t changed_blocks = 0;
+
+	for (std::size_t i = 0; i < 8; ++i)
+		changed_blocks |= uint64_t{ state[mask_offset + i] } << (i * 8);
+
+	auto block_count = std::size_t{ 0 };
+
+	for (auto mask = changed_blocks; mask != 0; mask &= mask - 1)
+		++block_count;
+
+	if (size != blocks_offset + block_count * snapshot_block_size || !emu.read_machine_state(state + chip8::state_header_size))
+		return false;
+
+	auto source = state + blocks_offset;
+
+	for (std::size_t block = 0; block < snapshot_block_count; ++block)
+	{
+		if ((changed_blocks >> block) & 1)
+		{
+			std::copy(source, source + snapshot_block_size, emu.memory.begin() + block * snapshot_block_size);
+			source += snapshot_block_size;
+		}
+	}
+
+	return true;
+}
+
+void save_state_file(const std::string& file_path, const chip8& emu)
+{
+	std::ofstream file(file_path, std::ios::binary);
+
+	if (!file.is_open())
+		throw std::runtime_error("Failed to open \"" + file_path + "\" for writing");
+
+	const auto state = emu.save_state();
+	file.write(reinterpret_cast<const char*>(state.data()), state.size());
+
+	if (!file)
+		throw std::runtime_error("Failed to write \"" + file_path + "\"");
+}
+
+void load_state_file(const std::string& file_path, chip8& emu)
+{
+	std::ifstream file(file_path, std::ios::binary);
+
+	if (!file.is_open())
+		throw std::runtime_error("Failed to open \"" + file_path + "\"");
+
+	const std::vector<uint8_t> state{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+
+	if (!emu.load_state(state.data(), state.size()))
+		throw std::runtime_error("\"" + file_path + "\" is not a valid save state");
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "chip8.h"
+
+// Delta snapshots keep the registers and timers in full, but only the blocks of memory that differ from a base
+// machine, so frequent checkpoints of a long run stay small. They can only be restored on top of that same base.
+constexpr std::size_t snapshot_block_size = 64;
+constexpr std::size_t snapshot_block_count = chip8::memory_size / snapshot_block_size;
+
+static_assert(snapshot_block_count <= 64, "Changed blocks are tracked in a 64-bit mask");
+
+std::vector<uint8_t> save_delta_state(const chip8& base, const chip8& emu);
+
+// Applies a delta to a machine holding its base state, returning false and leaving it untouched if it is not valid
+bool load_delta_state(chip8& emu, const uint8_t* state, std::size_t size);
+
+// Full snapshots as files, throwing std::runtime_error if they cannot be written or read
+void save_state_file(const std::string& file_path, const chip8& emu);
+void load_state_file(const std::string& file_path, chip8& emu);
@@ -0,0 +1,20 @@
+#include "state_json.h"
+
+#include <iomanip>
+
+void write_json_string(std::ostream& out, const std::string& value)
+{
+	out << '"';
+
+	for (const auto c : value)
+	{
+		if (c == '"' || c == '\\')
+			out << '\\' << c;
+		else if (static_cast<unsigned char>(c) < 0x20)
+			out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+		else
+			out << c;
+	}
+
+	out << '"';
+}
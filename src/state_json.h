@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <iomanip>
+#include <ostream>
+#include <string>
+
+// Writes a JSON string literal, escaping quotes, backslashes and control characters
+void write_json_string(std::ostream& out, const std::string& value);
+
+// Writes the final state of any machine as the members of a JSON object, without the surrounding braces
+template<typename machine>
+void write_json_state(std::ostream& out, const machine& emu)
+{
+	out << "\"program_counter\": " << emu.program_counter
+		<< ", \"address\": " << emu.registers.address
+		<< ", \"stack_pointer\": " << static_cast<int>(emu.stack_pointer)
+		<< ", \"delay_timer\": " << static_cast<int>(emu.delay_timer)
+		<< ", \"sound_timer\": " << static_cast<int>(emu.sound_timer)
+		<< ", \"registers\": [";
+
+	for (std::size_t i = 0; i < emu.registers.data.size(); ++i)
+		out << (i > 0 ? ", " : "") << static_cast<int>(emu.registers.data[i]);
+
+	out << "], \"framebuffer_hash\": \"" << std::hex << std::setw(16) << std::setfill('0') << emu.display_hash() << std::dec << '"';
+}
@@ -0,0 +1,24 @@
+#include "timer_clock.h"
+
+timer_clock::timer_clock(const uint32_t frequency)
+	: m_frequency(frequency), m_start(clock::now())
+{
+}
+
+uint32_t timer_clock::poll()
+{
+	// Ticks are counted from a fixed start point rather than accumulated, so rounding never drifts
+	const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - m_start);
+	const auto total_ticks = static_cast<uint64_t>(elapsed.count()) * m_frequency / 1000000000;
+
+	const auto ticks = static_cast<uint32_t>(total_ticks - m_ticks);
+	m_ticks = total_ticks;
+
+	return ticks;
+}
+
+void timer_clock::reset()
+{
+	m_start = clock::now();
+	m_ticks = 0;
+}
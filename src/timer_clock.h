@@ -0,0 +1,21 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Converts elapsed time on a monotonic clock into a whole number of ticks at a fixed frequency
+class timer_clock
+{
+public:
+	using clock = std::chrono::steady_clock;
+
+	timer_clock(uint32_t frequency);
+
+	uint32_t poll();
+	void reset();
+
+private:
+	uint32_t m_frequency;
+	clock::time_point m_start;
+	uint64_t m_ticks = 0;
+};
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A minimal x86-64 machine code emitter covering only the instructions the JIT needs.
+// Memory operands are always [base + disp32], using the 8-bit registers al/cl/dl and their wider forms.
+class x64_emitter
+{
+public:
+	enum reg : uint8_t
+	{
+		rax = 0,
+		rcx = 1,
+		rdx = 2,
+		rbx = 3,
+		rsp = 4,
+		rbp = 5,
+		rsi = 6,
+		rdi = 7
+	};
+
+	enum condition : uint8_t
+	{
+		equal = 0x4,
+		not_equal = 0x5
+	};
+
+	[[nodiscard]] const std::vector<uint8_t>& code() const noexcept
+	{
+		return m_code;
+	}
+
+	void clear() noexcept
+	{
+		m_code.clear();
+	}
+
+	void push(const reg r)
+	{
+		emit(0x50 + r);
+	}
+
+	void pop(const reg r)
+	{
+		emit(0x58 + r);
+	}
+
+	void ret()
+	{
+		emit(0xC3);
+	}
+
+	// mov dst, src (64-bit)
+	void mov_reg64(const reg dst, const reg src)
+	{
+		emit(0x48, 0x89, modrm(3, src, dst));
+	}
+
+	// mov r32, imm32
+	void mov_imm32(const reg dst, const uint32_t value)
+	{
+		emit(0xB8 + dst);
+		emit32(value);
+	}
+
+	// mov r64, imm64
+	void mov_imm64(const reg dst, const uint64_t value)
+	{
+		emit(0x48, 0xB8 + dst);
+		emit32(static_cast<uint32_t>(value));
+		emit32(static_cast<uint32_t>(value >> 32));
+	}
+
+	// sub rsp, imm8 / add rsp, imm8
+	void sub_rsp(const uint8_t value)
+	{
+		emit(0x48, 0x83, modrm(3, 5, rsp), value);
+	}
+
+	void add_rsp(const uint8_t value)
+	{
+		emit(0x48, 0x83, modrm(3, 0, rsp), value);
+	}
+
+	// call r64
+	void call(const reg target)
+	{
+		emit(0xFF, modrm(3, 2, target));
+	}
+
+	// jcc rel8 / jmp rel8, returning a label to be bound to the destination once it has been emitted
+	[[nodiscard]] std::size_t jump_if(const condition cc)
+	{
+		emit(0x70 + cc, 0);
+		return m_code.size() - 1;
+	}
+
+	[[nodiscard]] std::size_t jump()
+	{
+		emit(0xEB, 0);
+		return m_code.size() - 1;
+	}
+
+	void bind(const std::size_t label)
+	{
+		m_code[label] = static_cast<uint8_t>(m_code.size() - (label + 1));
+	}
+
+	// movzx dst, byte [base + disp]
+	void load_byte(const reg dst, const reg base, const int32_t disp)
+	{
+		emit(0x0F, 0xB6);
+		memory_operand(dst, base, disp);
+	}
+
+	// movzx dst, byte [base + index + disp]
+	void load_byte_indexed(const reg dst, const reg base, const reg index, const int32_t disp)
+	{
+		emit(0x0F, 0xB6, modrm(2, dst, 4), sib(0, index, base));
+		emit32(static_cast<uint32_t>(disp));
+	}
+
+	// movzx dst, word [base + index * 2 + disp]
+	void load_word_indexed(const reg dst, const reg base, const reg index, const int32_t disp)
+	{
+		emit(0x0F, 0xB7, modrm(2, dst, 4), sib(1, index, base));
+		emit32(static_cast<uint32_t>(disp));
+	}
+
+	// mov word [base + index * 2 + disp], src16
+	void store_word_indexed(const reg base, const reg index, const int32_t disp, const reg src)
+	{
+		emit(0x66, 0x89, modrm(2, src, 4), sib(1, index, base));
+		emit32(static_cast<uint32_t>(disp));
+	}
+
+	// movzx dst, word [base + disp]
+	void load_word(const reg dst, const reg base, const int32_t disp)
+	{
+		emit(0x0F, 0xB7);
+		memory_operand(dst, base, disp);
+	}
+
+	// mov byte [base + disp], src8
+	void store_byte(const reg base, const int32_t disp, const reg src)
+	{
+		emit(0x88);
+		memory_operand(src, base, disp);
+	}
+
+	// mov word [base + disp], src16
+	void store_word(const reg base, const int32_t disp, const reg src)
+	{
+		emit(0x66, 0x89);
+		memory_operand(src, base, disp);
+	}
+
+	// mov byte [base + disp], imm8
+	void store_byte_imm(const reg base, const int32_t disp, const uint8_t value)
+	{
+		emit(0xC6);
+		memory_operand(0, base, disp);
+		emit(value);
+	}
+
+	// mov word [base + disp], imm16
+	void store_word_imm(const reg base, const int32_t disp, const uint16_t value)
+	{
+		emit(0x66, 0xC7);
+		memory_operand(0, base, disp);
+		emit(static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8));
+	}
+
+	// add byte [base + disp], imm8
+	void add_byte_imm(const reg base, const int32_t disp, const uint8_t value)
+	{
+		emit(0x80);
+		memory_operand(0, base, disp);
+		emit(value);
+	}
+
+	// cmp byte [base + disp], imm8
+	void cmp_byte_imm(const reg base, const int32_t disp, const uint8_t value)
+	{
+		emit(0x80);
+		memory_operand(7, base, disp);
+		emit(value);
+	}
+
+	// 8-bit register to register arithmetic: op dst8, src8
+	void add8(const reg dst, const reg src) { emit(0x00, modrm(3, src, dst)); }
+	void or8(const reg dst, const reg src) { emit(0x08, modrm(3, src, dst)); }
+	void and8(const reg dst, const reg src) { emit(0x20, modrm(3, src, dst)); }
+	void sub8(const reg dst, const reg src) { emit(0x28, modrm(3, src, dst)); }
+	void xor8(const reg dst, const reg src) { emit(0x30, modrm(3, src, dst)); }
+	void cmp8(const reg lhs, const reg rhs) { emit(0x38, modrm(3, rhs, lhs)); }
+
+	// 32-bit register arithmetic
+	void add32(const reg dst, const reg src) { emit(0x01, modrm(3, src, dst)); }
+	void test32(const reg lhs, const reg rhs) { emit(0x85, modrm(3, rhs, lhs)); }
+	void add32_imm(const reg dst, const uint32_t value) { emit(0x81, modrm(3, 0, dst)); emit32(value); }
+	void and32_imm(const reg dst, const uint32_t value) { emit(0x81, modrm(3, 4, dst)); emit32(value); }
+	void cmp32_imm(const reg lhs, const uint32_t value) { emit(0x81, modrm(3, 7, lhs)); emit32(value); }
+	void xor32_imm(const reg dst, const uint32_t value) { emit(0x81, modrm(3, 6, dst)); emit32(value); }
+
+	// movzx dst32, src8
+	void zero_extend8(const reg dst, const reg src)
+	{
+		emit(0x0F, 0xB6, modrm(3, dst, src));
+	}
+
+	// shr r32, cl
+	void shr32_cl(const reg dst)
+	{
+		emit(0xD3, modrm(3, 5, dst));
+	}
+
+	// lea dst, [src + src * 4]
+	void multiply_by_5(const reg dst, const reg src)
+	{
+		emit(0x8D, modrm(0, dst, 4), sib(2, src, src));
+	}
+
+	// shr r8, imm8 / shl r8, 1
+	void shr8(const reg dst, const uint8_t count) { emit(0xC0, modrm(3, 5, dst), count); }
+	void shl8_1(const reg dst) { emit(0xD0, modrm(3, 4, dst)); }
+
+	// setcc r8
+	void setc(const reg dst) { emit(0x0F, 0x92, modrm(3, 0, dst)); }
+	void setnc(const reg dst) { emit(0x0F, 0x93, modrm(3, 0, dst)); }
+	void seta(const reg dst) { emit(0x0F, 0x97, modrm(3, 0, dst)); }
+	void sete(const reg dst) { emit(0x0F, 0x94, modrm(3, 0, dst)); }
+	void setne(const reg dst) { emit(0x0F, 0x95, modrm(3, 0, dst)); }
+
+private:
+	std::vector<uint8_t> m_code;
+
+	[[nodiscard]] static constexpr uint8_t modrm(const uint8_t mod, const uint8_t field, const uint8_t rm) noexcept
+	{
+		return static_cast<uint8_t>((mod << 6) | ((field & 7) << 3) | (rm & 7));
+	}
+
+	[[nodiscard]] static constexpr uint8_t sib(const uint8_t scale, const uint8_t index, const uint8_t base) noexcept
+	{
+		return static_cast<uint8_t>((scale << 6) | ((index & 7) << 3) | (base & 7));
+	}
+
+	void memory_operand(const uint8_t field, const reg base, const int32_t disp)
+	{
+		// rsp needs a SIB byte as a base, which the JIT never uses
+		emit(modrm(2, field, base));
+		emit32(static_cast<uint32_t>(disp));
+	}
+
+	template<typename... T>
+	void emit(const T... bytes)
+	{
+		(m_code.push_back(static_cast<uint8_t>(bytes)), ...);
+	}
+
+	void emit32(const uint32_t value)
+	{
+		emit(value, value >> 8, value >> 16, value >> 24);
+	}
+};
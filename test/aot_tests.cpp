@@ -0,0 +1,155 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include "aot_engine.h"
+#include "chip8.h"
+
+// Translated from roms/aot_test.ch8 and roms/aot_fallback_test.ch8 by chip8-aot when the tests are built
+extern const aot_program aot_test_program;
+extern const aot_program aot_fallback_test_program;
+
+namespace
+{
+	// The contents of roms/aot_test.ch8
+	constexpr std::array<uint8_t, 72> program = {
+		0x60, 0x00, // 200: V0 = 0
+		0x61, 0x05, // 202: V1 = 5
+		0xA3, 0x00, // 204: I = 300
+		0x22, 0x30, // 206: Call 230
+		0xF1, 0x33, // 208: Store BCD of V1 at I
+		0x70, 0x02, // 20A: V0 += 2
+		0x30, 0x08, // 20C: Skip if V0 == 8
+		0x12, 0x06, // 20E: Jump 206
+		0x60, 0x12, // 210: V0 = 12
+		0x61, 0x1A, // 212: V1 = 1A
+		0xA2, 0x18, // 214: I = 218
+		0xF1, 0x55, // 216: Store V0 to V1 at I, turning the next instruction into Jump 21A
+		0x6A, 0xFF, // 218: VA = FF
+		0xD1, 0x25, // 21A: Draw 8x5 sprite at (V1,V2)
+		0x00, 0xEE, // 21C: Return
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0xE1, 0x9E, // 230: Skip if key V1 is pressed
+		0x75, 0x01, // 232: V5 += 1
+		0xB2, 0x40, // 234: Jump 240 + V0
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x72, 0x01, // 240: V2 += 1
+		0x73, 0x02, // 242: V3 += 2
+		0x74, 0x04, // 244: V4 += 4
+		0x00, 0xEE  // 246: Return
+	};
+
+	// The contents of roms/aot_fallback_test.ch8, translated with --interpret-indirect so that BNNN leads to untranslated
+	// code, which clears the translated instruction at 200 and jumps back to it
+	constexpr std::array<uint8_t, 14> fallback_program = {
+		0x30, 0x00, // 200: Skip if V0 == 0
+		0x00, 0x00, // 202: Quit
+		0xB2, 0x08, // 204: Jump 208 + V0
+		0x00, 0x00, // 206: Unused
+		0xA2, 0x00, // 208: I = 200
+		0xF1, 0x55, // 20A: Store V0 to V1 at I, turning the instruction at 200 into a quit
+		0x12, 0x00  // 20C: Jump 200
+	};
+
+	bool same_state(const chip8& lhs, const chip8& rhs)
+	{
+		return lhs.memory == rhs.memory
+			&& lhs.registers.data == rhs.registers.data
+			&& lhs.registers.address == rhs.registers.address
+			&& lhs.program_counter == rhs.program_counter
+			&& lhs.call_stack == rhs.call_stack
+			&& lhs.stack_pointer == rhs.stack_pointer
+			&& lhs.delay_timer == rhs.delay_timer
+			&& lhs.sound_timer == rhs.sound_timer
+			&& lhs.random_state == rhs.random_state
+			&& lhs.dirty_rows == rhs.dirty_rows;
+	}
+
+	// Runs the translation and the interpreter a frame at a time, returning false as soon as they disagree
+	bool run_differential(const uint16_t key_state, const uint32_t cycles_per_frame)
+	{
+		chip8 interpreted{ program };
+		chip8 translated{ program };
+		interpreted.key_state = key_state;
+		translated.key_state = key_state;
+
+		aot_engine engine(translated, aot_test_program);
+
+		for (auto frame = 0; frame < 100; ++frame)
+		{
+			uint64_t interpreted_cycles = 0;
+			auto interpreted_halted = false;
+
+			for (; interpreted_cycles < cycles_per_frame; ++interpreted_cycles)
+			{
+				if (!interpreted.next_instruction())
+				{
+					interpreted_halted = true;
+					break;
+				}
+			}
+
+			const auto translated_cycles = engine.run(cycles_per_frame);
+
+			if (translated_cycles != interpreted_cycles || engine.halted() != interpreted_halted || !same_state(interpreted, translated))
+				return false;
+
+			if (interpreted_halted)
+				return true;
+
+			interpreted.tick_timers();
+			translated.tick_timers();
+		}
+
+		return false;
+	}
+}
+
+TEST_CASE("The translated test ROM matches its listing", "[aot]")
+{
+	REQUIRE(aot_test_program.rom_size == program.size());
+	REQUIRE(std::equal(program.begin(), program.end(), aot_test_program.rom));
+}
+
+TEST_CASE("Translated ROMs match the interpreter", "[aot]")
+{
+	// A single cycle per frame stops the translation at every instruction
+	for (const auto cycles_per_frame : { 1, 3, 10, 1000 })
+	{
+		INFO("Cycles per frame " << cycles_per_frame);
+		REQUIRE(run_differential(0x0000, cycles_per_frame));
+		REQUIRE(run_differential(0xFFFF, cycles_per_frame));
+	}
+}
+
+TEST_CASE("Translated ROMs hand over to the interpreter once they modify their own code", "[aot]")
+{
+	chip8 emu{ program };
+	aot_engine engine(emu, aot_test_program);
+	engine.run(1000);
+
+	REQUIRE(engine.halted());
+	REQUIRE(emu.registers.data[0xA] == 0);
+	REQUIRE(emu.registers.data[0x2] == 1);
+	REQUIRE(emu.registers.data[0x3] == 4);
+	REQUIRE(emu.registers.data[0x4] == 12);
+	REQUIRE(emu.registers.data[0x5] == 4);
+}
+
+TEST_CASE("Untranslated code that writes over translated code hands over to the interpreter", "[aot]")
+{
+	REQUIRE(aot_fallback_test_program.rom_size == fallback_program.size());
+	REQUIRE(std::equal(fallback_program.begin(), fallback_program.end(), aot_fallback_test_program.rom));
+
+	chip8 interpreted{ fallback_program };
+	chip8 translated{ fallback_program };
+	interpreted.run();
+
+	// Carrying on in the stale translation of 200 would loop forever instead of quitting
+	aot_engine engine(translated, aot_fallback_test_program);
+	REQUIRE(engine.run(1000) == 5);
+	REQUIRE(engine.halted());
+	REQUIRE(same_state(interpreted, translated));
+}
@@ -0,0 +1,143 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+#include "chip8.h"
+#include "chip8_batch.h"
+
+namespace
+{
+	// Branches on random numbers and keys, so lanes seeded differently soon diverge, and draws, stores and loads through
+	// per-lane addresses
+	constexpr std::array<uint8_t, 48> divergent_program = {
+		0x6E, 0x00, // 200: VE = 0
+		0xC0, 0x3F, // 202: V0 = random AND 3F
+		0xC1, 0x1F, // 204: V1 = random AND 1F
+		0xF0, 0x29, // 206: I = character V0
+		0xD0, 0x15, // 208: Draw 8x5 sprite at (V0,V1)
+		0x3F, 0x01, // 20A: Skip if VF == 1
+		0x12, 0x12, // 20C: Jump 212
+		0x7E, 0x01, // 20E: VE += 1
+		0x00, 0xE0, // 210: Clear screen
+		0xA3, 0x00, // 212: I = 300
+		0xF0, 0x1E, // 214: I += V0
+		0xFE, 0x33, // 216: Store BCD of VE at I
+		0xF2, 0x65, // 218: Load V0 to V2 from I
+		0xE0, 0x9E, // 21A: Skip if key V0 is pressed
+		0x22, 0x28, // 21C: Call 228
+		0x8E, 0x14, // 21E: VE += V1
+		0x3E, 0xFF, // 220: Skip if VE == FF
+		0x12, 0x02, // 222: Jump 202
+		0x00, 0xEE, // 224: Return
+		0x00, 0x00,
+		0x85, 0x16, // 228: V5 >>= 1
+		0xF5, 0x07, // 22A: V5 = delay timer
+		0x00, 0xEE, // 22C: Return
+		0x00, 0x00
+	};
+
+	// The ahead-of-time translator's test ROM, which calls, jumps through V0 and writes over its own code
+	constexpr std::array<uint8_t, 72> self_modifying_program = {
+		0x60, 0x00, 0x61, 0x05, 0xA3, 0x00, 0x22, 0x30, 0xF1, 0x33, 0x70, 0x02, 0x30, 0x08, 0x12, 0x06,
+		0x60, 0x12, 0x61, 0x1A, 0xA2, 0x18, 0xF1, 0x55, 0x6A, 0xFF, 0xD1, 0x25, 0x00, 0xEE, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0xE1, 0x9E, 0x75, 0x01, 0xB2, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x72, 0x01, 0x73, 0x02, 0x74, 0x04, 0x00, 0xEE
+	};
+
+	template<std::size_t size>
+	chip8 make_lane(const std::array<uint8_t, size>& program, const std::size_t lane)
+	{
+		chip8 emu{ program };
+		emu.seed_random(static_cast<uint32_t>(lane * 7919 + 1));
+		emu.key_state = static_cast<uint16_t>(0x1111 << (lane % 4));
+		return emu;
+	}
+
+	// Runs every lane alongside a chip8 of its own, returning false as soon as any lane disagrees
+	template<std::size_t lanes, std::size_t size>
+	bool run_differential(const std::array<uint8_t, size>& program, const uint32_t cycles_per_frame)
+	{
+		auto batch = std::make_unique<chip8_batch<lanes>>();
+		std::array<chip8, lanes> scalar;
+		std::array<bool, lanes> halted{};
+
+		for (std::size_t lane = 0; lane < lanes; ++lane)
+		{
+			scalar[lane] = make_lane(program, lane);
+			batch->set_lane(lane, scalar[lane]);
+		}
+
+		for (auto frame = 0; frame < 200; ++frame)
+		{
+			uint64_t scalar_cycles = 0;
+
+			for (std::size_t lane = 0; lane < lanes; ++lane)
+			{
+				for (uint32_t i = 0; i < cycles_per_frame && !halted[lane]; ++i)
+				{
+					halted[lane] = !scalar[lane].next_instruction();
+					scalar_cycles += !halted[lane];
+				}
+
+				if (!halted[lane])
+					scalar[lane].tick_timers();
+			}
+
+			if (batch->run(cycles_per_frame) != scalar_cycles)
+				return false;
+
+			batch->tick_timers();
+
+			for (std::size_t lane = 0; lane < lanes; ++lane)
+			{
+				if ((batch->halted[lane] != 0) != halted[lane] || batch->get_lane(lane).save_state() != scalar[lane].save_state())
+					return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+TEMPLATE_TEST_CASE_SIG("Batched lanes match separate interpreters", "[batch]", ((std::size_t lanes), lanes), 8, 16, 32)
+{
+	for (const auto cycles_per_frame : { 1u, 7u, 100u })
+	{
+		INFO("Cycles per frame " << cycles_per_frame);
+		REQUIRE(run_differential<lanes>(divergent_program, cycles_per_frame));
+		REQUIRE(run_differential<lanes>(self_modifying_program, cycles_per_frame));
+	}
+}
+
+TEST_CASE("Batched lanes round trip through chip8", "[batch]")
+{
+	auto batch = std::make_unique<chip8_batch<8>>();
+	const auto emu = make_lane(divergent_program, 3);
+
+	batch->set_lane(5, emu);
+
+	REQUIRE(batch->get_lane(5).save_state() == emu.save_state());
+	REQUIRE(batch->get_lane(4).save_state() == chip8{}.save_state());
+}
+
+TEST_CASE("Batched lanes wait for their own key releases", "[batch]")
+{
+	auto batch = std::make_unique<chip8_batch<8>>();
+	const chip8 emu{ std::array<uint8_t, 4>{ 0xF3, 0x0A, 0x00, 0x00 } };
+
+	for (std::size_t lane = 0; lane < 8; ++lane)
+		batch->set_lane(lane, emu);
+
+	batch->set_key_state(2, 0x0100);
+	REQUIRE(batch->run(10) == 10 * 8);
+
+	batch->set_key_state(2, 0x0000);
+	REQUIRE(batch->run(10) == 10 * 7 + 1);
+
+	REQUIRE(batch->halted[2]);
+	REQUIRE(batch->registers[0x3][2] == 8);
+	REQUIRE_FALSE(batch->all_halted());
+}
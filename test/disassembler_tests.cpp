@@ -0,0 +1,49 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <cstdint>
+#include <sstream>
+
+#include "decoder.h"
+#include "disassembler.h"
+#include "rom_analysis.h"
+
+TEST_CASE("Instructions disassemble to their mnemonics", "[disassembler]")
+{
+	REQUIRE(disassemble(decode(0x00E0)) == "CLS");
+	REQUIRE(disassemble(decode(0x22A4)) == "CALL 2A4");
+	REQUIRE(disassemble(decode(0x3A0F)) == "SE VA, #0F");
+	REQUIRE(disassemble(decode(0x8126)) == "SHR V1, V2");
+	REQUIRE(disassemble(decode(0xD125)) == "DRW V1, V2, 5");
+	REQUIRE(disassemble(decode(0xF30A)) == "LD V3, K");
+	REQUIRE(disassemble(decode(0xF565)) == "LD V5, [I]");
+	REQUIRE(disassemble(decode<opcode_set::super_chip>(0x00FF)) == "HIGH");
+	REQUIRE(disassemble(decode<opcode_set::xo_chip>(0x5132)) == "SAVE V1 - V3");
+	REQUIRE(disassemble(decode<opcode_set::xo_chip>(0xF000), 0x1234) == "LD I, LONG 1234");
+	REQUIRE(disassemble(decode(0x00FF)) == "??? 00FF");
+}
+
+TEST_CASE("Disassembly lists blocks, sprites and unused bytes", "[disassembler]")
+{
+	constexpr std::array<uint8_t, 8> program = {
+		0xA2, 0x06, // 200: I = 206
+		0xD0, 0x11, // 202: Draw 8x1 sprite at (V0,V1)
+		0x12, 0x02, // 204: Jump 202
+		0x81,       // 206: Sprite
+		0x00        // 207: Unused
+	};
+
+	const auto analysis = analyze_rom(program.data(), program.size());
+
+	std::ostringstream out;
+	write_disassembly(out, program.data(), program.size(), analysis);
+
+	REQUIRE(out.str() ==
+		"\nblock_200: ; -> 202\n"
+		"200  A206      LD I, 206\n"
+		"\nblock_202: ; -> 202\n"
+		"202  D011      DRW V0, V1, 1\n"
+		"204  1202      JP 202\n"
+		"206  81        DB #81 ; #......#\n"
+		"207  00        DB #00 ; unused\n");
+}
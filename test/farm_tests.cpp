@@ -0,0 +1,105 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "chip8.h"
+#include "chip8_farm.h"
+
+namespace
+{
+	// Adds random numbers into V2 and counts timer ticks in V3 until V0 wraps around, then quits
+	constexpr std::array<uint8_t, 14> program = {
+		0x70, 0x01, // 200: V0 += 1
+		0xC1, 0xFF, // 202: V1 = random
+		0x82, 0x14, // 204: V2 += V1
+		0xF3, 0x07, // 206: V3 = delay timer
+		0x30, 0x00, // 208: Skip if V0 == 0
+		0x12, 0x00, // 20A: Jump 200
+		0x00, 0xEE  // 20C: Return
+	};
+
+	constexpr uint32_t cycles_per_frame = 7;
+
+	chip8 make_instance(const uint32_t seed)
+	{
+		chip8 emu{ program };
+		emu.seed_random(seed);
+		emu.delay_timer = static_cast<uint8_t>(seed);
+		return emu;
+	}
+
+	// The same machine run on its own without any slicing
+	chip8 run_alone(chip8 emu, const uint64_t max_cycles, uint64_t& cycles, bool& halted)
+	{
+		cycles = 0;
+		halted = false;
+
+		while (cycles < max_cycles)
+		{
+			if (!emu.next_instruction())
+			{
+				halted = true;
+				break;
+			}
+
+			if (++cycles % cycles_per_frame == 0)
+				emu.tick_timers();
+		}
+
+		return emu;
+	}
+}
+
+TEST_CASE("Farmed machines finish exactly as they would running alone", "[farm]")
+{
+	// Small slices and more threads than cores force machines to move between threads mid-run
+	for (const auto threads : { 1u, 3u, 8u })
+	{
+		INFO("Threads " << threads);
+
+		chip8_farm farm(threads, 37, cycles_per_frame);
+		std::vector<uint64_t> max_cycles;
+
+		for (uint32_t seed = 1; seed <= 300; ++seed)
+		{
+			max_cycles.push_back(seed % 3 == 0 ? 500 : 10000);
+			REQUIRE(farm.add(make_instance(seed), max_cycles.back()) == seed - 1);
+		}
+
+		const auto stats = farm.run();
+		uint64_t total_cycles = 0;
+
+		for (uint32_t seed = 1; seed <= 300; ++seed)
+		{
+			uint64_t cycles;
+			bool halted;
+			const auto expected = run_alone(make_instance(seed), max_cycles[seed - 1], cycles, halted);
+			const auto& inst = farm[seed - 1];
+
+			REQUIRE(inst.cycles == cycles);
+			REQUIRE(inst.halted == halted);
+			REQUIRE(halted == (max_cycles[seed - 1] > 2000));
+			REQUIRE(inst.emu.save_state() == expected.save_state());
+
+			total_cycles += cycles;
+		}
+
+		REQUIRE(stats.cycles == total_cycles);
+		REQUIRE(stats.threads == threads);
+		REQUIRE(stats.slices >= farm.size());
+	}
+}
+
+TEST_CASE("Running a farm again only runs machines that have not finished", "[farm]")
+{
+	chip8_farm farm(2);
+	farm.add(make_instance(1), 100);
+
+	REQUIRE(farm.run().cycles == 100);
+	REQUIRE(farm.run().cycles == 0);
+
+	chip8_farm empty_farm(4);
+	REQUIRE(empty_farm.run().cycles == 0);
+}
@@ -0,0 +1,144 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include "chip8.h"
+#include "idle_detector.h"
+
+namespace
+{
+	// Sets the delay timer, polls it until it runs out, then counts how many times that happened
+	constexpr std::array<uint8_t, 14> delay_program = {
+		0x60, 0x05, // 200: V0 = 5
+		0xF0, 0x15, // 202: Delay timer = V0
+		0xF1, 0x07, // 204: V1 = delay timer
+		0x31, 0x00, // 206: Skip next instruction if V1 == 0
+		0x12, 0x04, // 208: Jump 204
+		0x72, 0x01, // 20A: V2 += 1
+		0x12, 0x02  // 20C: Jump 202
+	};
+
+	// Runs like chip8-headless does, ticking the timers every cycles_per_frame instructions and skipping any waiting
+	// up to the next tick, returning how many instructions were skipped
+	uint64_t run_skipping(chip8& emu, const uint64_t cycles, const uint64_t cycles_per_frame)
+	{
+		idle_detector<chip8> detector;
+		uint64_t skipped = 0;
+
+		for (uint64_t i = 0; i < cycles;)
+		{
+			if (!emu.next_instruction(detector))
+				break;
+
+			if (++i % cycles_per_frame != 0)
+			{
+				const auto frame_skipped = detector.skip(std::min(cycles_per_frame - (i % cycles_per_frame), cycles - i));
+				skipped += frame_skipped;
+				i += frame_skipped;
+			}
+
+			if (i % cycles_per_frame == 0)
+				emu.tick_timers();
+		}
+
+		return skipped;
+	}
+
+	void run(chip8& emu, const uint64_t cycles, const uint64_t cycles_per_frame)
+	{
+		for (uint64_t i = 0; i < cycles;)
+		{
+			if (!emu.next_instruction())
+				break;
+
+			if (++i % cycles_per_frame == 0)
+				emu.tick_timers();
+		}
+	}
+}
+
+TEST_CASE("Waiting for a key and jumping to the same instruction are detected straight away", "[idle_detector]")
+{
+	constexpr std::array<uint8_t, 4> program = {
+		0xF0, 0x0A, // 200: V0 = next key released
+		0x12, 0x02  // 202: Jump 202
+	};
+
+	chip8 emu{ program };
+	idle_detector<chip8> detector;
+
+	REQUIRE(emu.next_instruction(detector));
+	REQUIRE(detector.idle_period() == 1);
+	REQUIRE(detector.skip(10) == 10);
+	REQUIRE(detector.idle_period() == 0);
+
+	emu.set_key_state(1 << 3);
+	REQUIRE(emu.next_instruction(detector));
+	REQUIRE(detector.idle_period() == 1);
+
+	emu.set_key_state(0);
+	REQUIRE(emu.next_instruction(detector));
+	REQUIRE(detector.idle_period() == 0);
+
+	REQUIRE(emu.next_instruction(detector));
+	REQUIRE(detector.idle_period() == 1);
+}
+
+TEST_CASE("Polling the delay timer is detected once the loop repeats without changing anything", "[idle_detector]")
+{
+	chip8 emu{ delay_program };
+	idle_detector<chip8> detector;
+
+	// The first pass through the jump has nothing to compare with
+	for (auto i = 0; i < 5; ++i)
+		REQUIRE(emu.next_instruction(detector));
+
+	REQUIRE(detector.idle_period() == 0);
+
+	for (auto i = 0; i < 3; ++i)
+		REQUIRE(emu.next_instruction(detector));
+
+	REQUIRE(detector.idle_period() == 3);
+	REQUIRE(detector.skip(10) == 9);
+
+	// A tick changes what the loop reads, so it has to be seen to repeat again
+	emu.tick_timers();
+
+	for (auto i = 0; i < 3; ++i)
+		REQUIRE(emu.next_instruction(detector));
+
+	REQUIRE(detector.idle_period() == 0);
+}
+
+TEST_CASE("Loops that draw or write to memory are not idle", "[idle_detector]")
+{
+	constexpr std::array<uint8_t, 6> program = {
+		0xA2, 0x06, // 200: I = 206
+		0xD0, 0x01, // 202: Draw 8x1 sprite at (V0,V0)
+		0x12, 0x02  // 204: Jump 202
+	};
+
+	chip8 emu{ program };
+	idle_detector<chip8> detector;
+
+	for (auto i = 0; i < 100; ++i)
+	{
+		REQUIRE(emu.next_instruction(detector));
+		REQUIRE(detector.idle_period() == 0);
+	}
+}
+
+TEST_CASE("Skipping idle loops gives the same results as running them", "[idle_detector]")
+{
+	chip8 skipping{ delay_program };
+	chip8 running{ delay_program };
+
+	const auto skipped = run_skipping(skipping, 10007, 100);
+	run(running, 10007, 100);
+
+	REQUIRE(skipped > 5000);
+	REQUIRE(skipping.save_state() == running.save_state());
+	REQUIRE(skipping.registers.data[2] == running.registers.data[2]);
+}
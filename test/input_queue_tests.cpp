@@ -0,0 +1,150 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "chip8.h"
+#include "input_queue.h"
+
+namespace
+{
+	using std::chrono::milliseconds;
+
+	// Frames of 10ms running 10 instructions each, so every millisecond is one instruction
+	const input_queue::clock::time_point start{ std::chrono::seconds(1) };
+
+	movie_frame frame_at(input_queue& input, const int frame)
+	{
+		movie_frame result;
+		input.next_frame(start + milliseconds(frame * 10), start + milliseconds(frame * 10 + 10), 10, result);
+
+		return result;
+	}
+}
+
+TEST_CASE("Events land on the instruction matching when they happened", "[input]")
+{
+	input_queue input;
+
+	input.press(0x0, start + milliseconds(3));
+	input.release(0x0, start + milliseconds(7));
+	input.press(0xA, start + milliseconds(15));
+
+	const auto first = frame_at(input, 0);
+	REQUIRE(first.key_state == 0x0000);
+	REQUIRE(first.key_changes == std::vector<key_change>{ { 3, 0x0001 }, { 7, 0x0000 } });
+	REQUIRE(input.pending() == 1);
+
+	const auto second = frame_at(input, 1);
+	REQUIRE(second.key_state == 0x0000);
+	REQUIRE(second.key_changes == std::vector<key_change>{ { 5, 0x0400 } });
+
+	// Keys stay held until released
+	const auto third = frame_at(input, 2);
+	REQUIRE(third.key_state == 0x0400);
+	REQUIRE(third.key_changes.empty());
+	REQUIRE(input.pending() == 0);
+}
+
+TEST_CASE("Events that arrive together are spread an instruction apart", "[input]")
+{
+	input_queue input;
+
+	// A double tap from before the frame started, which none of the earlier frames took
+	for (auto i = 0; i < 2; ++i)
+	{
+		input.press(0x5, start - milliseconds(5));
+		input.release(0x5, start - milliseconds(5));
+	}
+
+	const auto frame = frame_at(input, 0);
+	REQUIRE(frame.key_changes == std::vector<key_change>{ { 0, 0x0020 }, { 1, 0x0000 }, { 2, 0x0020 }, { 3, 0x0000 } });
+
+	// Those that would land past the end of the frame are left for the next one
+	for (auto i = 0; i < 6; ++i)
+	{
+		input.press(0x1, start + milliseconds(19));
+		input.release(0x1, start + milliseconds(19));
+	}
+
+	REQUIRE(frame_at(input, 1).key_changes.size() == 1);
+	REQUIRE(frame_at(input, 2).key_changes.size() == 10);
+	REQUIRE(frame_at(input, 3).key_changes.size() == 1);
+	REQUIRE(input.pending() == 0);
+}
+
+TEST_CASE("Repeated presses are dropped and losing focus releases every key", "[input]")
+{
+	input_queue input;
+
+	for (auto i = 0; i < 100; ++i)
+		input.press(0x3, start);
+
+	REQUIRE(input.pending() == 1);
+	REQUIRE(frame_at(input, 0).key_changes == std::vector<key_change>{ { 0, 0x0008 } });
+
+	input.press(0xF, start + milliseconds(12));
+	input.release_all(start + milliseconds(16));
+	REQUIRE(frame_at(input, 1).key_changes == std::vector<key_change>{ { 2, 0x8008 }, { 6, 0x8000 }, { 7, 0x0000 } });
+}
+
+TEST_CASE("Events past the queue's capacity apply the oldest straight away", "[input]")
+{
+	input_queue input;
+
+	for (std::size_t i = 0; i < input_queue::capacity; ++i)
+	{
+		input.press(0x1, start);
+		input.release(0x1, start);
+	}
+
+	input.press(0x2, start);
+	REQUIRE(input.pending() == input_queue::capacity);
+
+	// The oldest taps were never seen by a frame, but the keys still end up where the events left them
+	for (auto frame = 0; input.pending() > 0; ++frame)
+		frame_at(input, frame);
+
+	REQUIRE(frame_at(input, 100).key_state == 0x0004);
+}
+
+TEST_CASE("A release at the end of a fractional frame still reaches FX0A", "[input]")
+{
+	constexpr std::array<uint8_t, 4> program = {
+		0xF3, 0x0A, // 200: Wait for a key in V3
+		0x12, 0x02  // 202: Jump 202
+	};
+
+	chip8 emu{ program };
+	input_queue input;
+	double cycle_budget = 0.0;
+
+	// The first frame of 2.5 instructions a frame runs 2, so the release is left for the next frame rather than
+	// landing after the last instruction
+	input.press(0x9, start + milliseconds(9));
+	input.release(0x9, start + milliseconds(9));
+
+	for (auto frame = 0; frame < 2; ++frame)
+	{
+		const auto cycles = next_frame_cycles(2.5, cycle_budget);
+		movie_frame keys;
+		input.next_frame(start + milliseconds(frame * 10), start + milliseconds(frame * 10 + 10), cycles, keys);
+
+		REQUIRE(keys.key_changes.size() == 1);
+		REQUIRE(keys.key_changes.front().offset < cycles);
+
+		apply_frame_input(emu, keys);
+		run_frame_input(emu, keys, cycles, [&emu](const uint64_t count)
+		{
+			for (uint64_t i = 0; i < count; ++i)
+				emu.next_instruction();
+
+			return count;
+		});
+	}
+
+	REQUIRE(emu.program_counter == 0x202);
+	REQUIRE(emu.registers.data[0x3] == 0x9);
+}
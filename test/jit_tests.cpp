@@ -0,0 +1,156 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <cstdint>
+#include <random>
+
+#include "chip8.h"
+#include "jit_engine.h"
+
+namespace
+{
+	// Programs are made mostly of valid instructions with jumps kept inside the program, so they run for a while
+	chip8 random_program(std::mt19937& rng)
+	{
+		chip8 emu;
+		std::uniform_int_distribution<int> byte(0, 0xFF);
+		std::uniform_int_distribution<int> nibble(0, 0xF);
+		std::uniform_int_distribution<int> target(0x100, 0x1FF);
+
+		for (uint16_t address = chip8::program_memory_start; address < chip8::program_memory_start + 0x200; address += 2)
+		{
+			const auto x = nibble(rng);
+			const auto y = nibble(rng);
+			uint16_t instruction = 0;
+
+			switch (std::uniform_int_distribution<int>(0, 15)(rng))
+			{
+			case 0: instruction = 0x6000 | (x << 8) | byte(rng); break;
+			case 1: instruction = 0x7000 | (x << 8) | byte(rng); break;
+			case 2:
+			case 3:
+				{
+					constexpr std::array<uint8_t, 9> variants = { 0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0xE };
+					instruction = 0x8000 | (x << 8) | (y << 4) | variants[nibble(rng) % variants.size()];
+				}
+				break;
+			case 4: instruction = 0xA000 | (target(rng) * 2); break;
+			case 5:
+				{
+					constexpr std::array<uint8_t, 8> variants = { 0x07, 0x15, 0x18, 0x1E, 0x29, 0x33, 0x55, 0x65 };
+					instruction = 0xF000 | (x << 8) | variants[nibble(rng) % variants.size()];
+				}
+				break;
+			case 6: instruction = 0xD000 | (x << 8) | (y << 4) | nibble(rng); break;
+			case 7: instruction = 0x3000 | (x << 8) | byte(rng); break;
+			case 8: instruction = 0x4000 | (x << 8) | byte(rng); break;
+			case 9: instruction = (byte(rng) & 1 ? 0x5000 : 0x9000) | (x << 8) | (y << 4); break;
+			case 10: instruction = 0x1000 | (target(rng) * 2); break;
+			case 11: instruction = 0x2000 | (target(rng) * 2); break;
+			case 12: instruction = byte(rng) & 1 ? 0x00EE : 0x00E0; break;
+			case 13: instruction = 0xC000 | (x << 8) | byte(rng); break;
+			case 14: instruction = 0xE000 | (x << 8) | (byte(rng) & 1 ? 0x9E : 0xA1); break;
+			default: instruction = static_cast<uint16_t>((byte(rng) << 8) | byte(rng)); break;
+			}
+
+			emu.memory[address] = instruction >> 8;
+			emu.memory[address + 1] = instruction & 0xFF;
+		}
+
+		emu.key_state = static_cast<uint16_t>((byte(rng) << 8) | byte(rng));
+
+		return emu;
+	}
+
+	bool same_state(const chip8& lhs, const chip8& rhs)
+	{
+		return lhs.memory == rhs.memory
+			&& lhs.registers.data == rhs.registers.data
+			&& lhs.registers.address == rhs.registers.address
+			&& lhs.program_counter == rhs.program_counter
+			&& lhs.call_stack == rhs.call_stack
+			&& lhs.stack_pointer == rhs.stack_pointer
+			&& lhs.delay_timer == rhs.delay_timer
+			&& lhs.sound_timer == rhs.sound_timer
+			&& lhs.random_state == rhs.random_state
+			&& lhs.draw_flag == rhs.draw_flag
+			&& lhs.dirty_rows == rhs.dirty_rows;
+	}
+
+	// Runs both engines a frame at a time, returning false as soon as they disagree
+	bool run_differential(const chip8& program, const uint32_t frames, const uint32_t cycles_per_frame)
+	{
+		chip8 interpreted = program;
+		chip8 compiled = program;
+		jit_engine jit(compiled);
+
+		for (uint32_t frame = 0; frame < frames; ++frame)
+		{
+			uint64_t interpreted_cycles = 0;
+			auto interpreted_halted = false;
+
+			for (; interpreted_cycles < cycles_per_frame; ++interpreted_cycles)
+			{
+				if (!interpreted.next_instruction())
+				{
+					interpreted_halted = true;
+					break;
+				}
+			}
+
+			const auto compiled_cycles = jit.run(cycles_per_frame);
+
+			if (compiled_cycles != interpreted_cycles || jit.halted() != interpreted_halted || !same_state(interpreted, compiled))
+				return false;
+
+			if (interpreted_halted)
+				break;
+
+			interpreted.tick_timers();
+			compiled.tick_timers();
+		}
+
+		return true;
+	}
+}
+
+TEST_CASE("The JIT matches the interpreter on random programs", "[jit]")
+{
+	std::mt19937 rng(0xC8);
+
+	for (auto i = 0; i < 2000; ++i)
+	{
+		const auto program = random_program(rng);
+
+		// Short frames split blocks across frame boundaries, while long ones let whole blocks run
+		INFO("Program " << i);
+		REQUIRE(run_differential(program, 500, 10));
+		REQUIRE(run_differential(program, 20, 997));
+	}
+}
+
+TEST_CASE("The JIT discards blocks overwritten by FX55", "[jit]")
+{
+	constexpr std::array<uint8_t, 22> program = {
+		0x60, 0x74, // 200: V0 = 74
+		0x61, 0x05, // 202: V1 = 05
+		0xA2, 0x0C, // 204: I = 20C
+		0x62, 0x00, // 206: V2 = 0
+		0x72, 0x01, // 208: V2 += 1
+		0x73, 0x01, // 20A: V3 += 1
+		0x75, 0x01, // 20C: V5 += 1, overwritten with V4 += 5
+		0xF1, 0x55, // 20E: Store V0 to V1 at I
+		0x32, 0x05, // 210: Skip if V2 == 5
+		0x12, 0x08, // 212: Jump 208
+		0x00, 0xEE  // 214: Return
+	};
+
+	chip8 emu{ program };
+	jit_engine jit(emu);
+	jit.run(1000);
+
+	REQUIRE(jit.halted());
+	REQUIRE(emu.registers.data[0x4] == 20);
+	REQUIRE(emu.registers.data[0x5] == 1);
+	REQUIRE(run_differential(chip8{ program }, 100, 10));
+}
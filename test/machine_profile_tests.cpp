@@ -0,0 +1,276 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+#include "chip8.h"
+#include "machine_dispatch.h"
+
+namespace
+{
+	template<typename machine, typename... T>
+	constexpr auto run_as(T... program)
+	{
+		std::array<uint8_t, sizeof...(T)> data{ static_cast<uint8_t>(program)... };
+
+		machine emu{ data };
+		emu.run();
+
+		return emu;
+	}
+}
+
+TEST_CASE("Each profile lays out memory and snapshots for its own machine", "[profile]")
+{
+	// CHIP-8 keeps the layout it has always had, so existing snapshots still load
+	static_assert(chip8::display_memory_start == 0xF00);
+	static_assert(chip8::program_memory_end == 0xEA0);
+	static_assert(chip8::memory_storage_size == 4096);
+	static_assert(chip8::state_size == 7 + 63 + 4096);
+
+	static_assert(super_chip::display_width == 128 && super_chip::display_height == 64);
+	static_assert(super_chip::program_memory_end == 4096);
+	static_assert(super_chip::memory_storage_size == 4096 + 1024);
+	static_assert(super_chip::max_stacks == 16);
+
+	static_assert(xo_chip::program_memory_end == 65536);
+	static_assert(xo_chip::memory_storage_size == 65536 + 2 * 1024);
+
+	const auto state = super_chip{}.save_state();
+	chip8 emu;
+	REQUIRE_FALSE(emu.load_state(state.data(), state.size()));
+}
+
+TEST_CASE("Extended opcodes only decode for machines that have them", "[profile]")
+{
+	static_assert(decode_operation(0x00FF) == operation::unknown);
+	static_assert(decode_operation(0x00C4) == operation::unknown);
+	static_assert(decode_operation(0xF000) == operation::unknown);
+	static_assert(decode_operation(0x5122) == operation::skip_if_registers_equal);
+
+	static_assert(decode_operation<opcode_set::super_chip>(0x00FF) == operation::high_resolution);
+	static_assert(decode_operation<opcode_set::super_chip>(0x00C4) == operation::scroll_down);
+	static_assert(decode_operation<opcode_set::super_chip>(0x00D4) == operation::unknown);
+	static_assert(decode_operation<opcode_set::super_chip>(0xF000) == operation::unknown);
+	static_assert(decode_operation<opcode_set::super_chip>(0x00E0) == operation::clear_screen);
+
+	static_assert(decode_operation<opcode_set::xo_chip>(0x00D4) == operation::scroll_up);
+	static_assert(decode_operation<opcode_set::xo_chip>(0xF000) == operation::load_long_address);
+	static_assert(decode_operation<opcode_set::xo_chip>(0x5122) == operation::store_register_range);
+	static_assert(decode_operation<opcode_set::xo_chip>(0xF201) == operation::select_planes);
+}
+
+TEST_CASE("SUPER-CHIP draws large digits in high resolution", "[profile]")
+{
+	// Digit 0 at (120,60), which runs off the bottom of the 128x64 display
+	constexpr auto clipped = run_as<super_chip>(0x00, 0xFF, 0x60, 0x78, 0x61, 0x3C, 0x62, 0x00, 0xF2, 0x30, 0xD0, 0x1A, 0x00, 0xFD);
+
+	static_assert(clipped.high_resolution);
+	static_assert(clipped.registers.address == 80);
+	static_assert(clipped.is_pixel_set(120, 60) && clipped.is_pixel_set(127, 61));
+	static_assert(clipped.is_pixel_set(121, 62) && !clipped.is_pixel_set(122, 62));
+	static_assert(!clipped.is_pixel_set(120, 0) && !clipped.is_pixel_set(127, 5));
+	static_assert(clipped.registers.data[0xF] == 0);
+	static_assert(clipped.program_counter == 0x20C);
+
+	constexpr auto wrapped = run_as<basic_chip8<super_chip_profile, chip8_quirks>>(0x00, 0xFF, 0x60, 0x78, 0x61, 0x3C, 0x62, 0x00,
+		0xF2, 0x30, 0xD0, 0x1A, 0x00, 0xFD);
+
+	static_assert(wrapped.is_pixel_set(120, 60) && wrapped.is_pixel_set(127, 61));
+	static_assert(wrapped.is_pixel_set(120, 0) && !wrapped.is_pixel_set(123, 0));
+	static_assert(wrapped.is_pixel_set(127, 5) && !wrapped.is_pixel_set(120, 6));
+}
+
+TEST_CASE("SUPER-CHIP doubles pixels in low resolution", "[profile]")
+{
+	// The small 0 at (1,0)
+	constexpr auto emu = run_as<super_chip>(0x60, 0x01, 0xD0, 0x15);
+
+	static_assert(!emu.is_pixel_set(1, 0));
+	static_assert(emu.is_pixel_set(2, 0) && emu.is_pixel_set(9, 1));
+	static_assert(!emu.is_pixel_set(10, 0));
+	static_assert(emu.is_pixel_set(2, 2) && emu.is_pixel_set(3, 3) && !emu.is_pixel_set(4, 2));
+	static_assert(emu.is_pixel_set(9, 9) && !emu.is_pixel_set(9, 10));
+}
+
+TEST_CASE("SUPER-CHIP draws 16x16 sprites and scrolls", "[profile]")
+{
+	// A 16x16 block at (0,0), then scrolled down 3 and right 4
+	constexpr auto block = run_as<super_chip>(0x00, 0xFF, 0xA2, 0x0C, 0xD0, 0x00, 0x00, 0xC3, 0x00, 0xFB, 0x00, 0xFD,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF);
+
+	static_assert(!block.is_pixel_set(4, 2) && !block.is_pixel_set(3, 3));
+	static_assert(block.is_pixel_set(4, 3) && block.is_pixel_set(19, 18));
+	static_assert(!block.is_pixel_set(20, 3) && !block.is_pixel_set(4, 19));
+
+	// Drawing the same block twice collides and leaves nothing behind
+	constexpr auto erased = run_as<super_chip>(0x00, 0xFF, 0xA2, 0x0A, 0xD0, 0x00, 0xD0, 0x00, 0x00, 0xFD,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF);
+
+	static_assert(erased.registers.data[0xF] == 1);
+	static_assert(erased.display_hash() == super_chip{}.display_hash());
+}
+
+TEST_CASE("SUPER-CHIP keeps flag registers across a snapshot", "[profile]")
+{
+	auto emu = run_as<super_chip>(0x60, 0x11, 0x61, 0x22, 0xF1, 0x75, 0x60, 0x00, 0x61, 0x00, 0xF1, 0x85, 0x00, 0xFF);
+
+	REQUIRE(emu.registers.data[0x0] == 0x11);
+	REQUIRE(emu.registers.data[0x1] == 0x22);
+
+	const auto state = emu.save_state();
+	super_chip loaded;
+	REQUIRE(loaded.load_state(state.data(), state.size()));
+	REQUIRE(loaded.high_resolution);
+	REQUIRE(loaded.flag_registers == emu.flag_registers);
+	REQUIRE(loaded.save_state() == state);
+}
+
+TEST_CASE("XO-CHIP addresses all 64 KiB and skips over long instructions", "[profile]")
+{
+	const auto emu = run_as<xo_chip>(
+		0x30, 0x00,             // 200: Skip if V0 == 0, over all four bytes of the next instruction
+		0xF0, 0x00, 0x12, 0x34, // 202: I = 1234
+		0xF0, 0x00, 0xFF, 0xF0, // 206: I = FFF0
+		0x60, 0xAB,             // 20A: V0 = AB
+		0x61, 0xCD,             // 20C: V1 = CD
+		0x51, 0x02,             // 20E: Store V1 down to V0 at I
+		0x52, 0x33);            // 210: Load V2 to V3 from I
+
+	REQUIRE(emu.registers.address == 0xFFF0);
+	REQUIRE(emu.memory[0xFFF0] == 0xCD);
+	REQUIRE(emu.memory[0xFFF1] == 0xAB);
+	REQUIRE(emu.registers.data[0x2] == 0xCD);
+	REQUIRE(emu.registers.data[0x3] == 0xAB);
+	REQUIRE(emu.program_counter == 0x212);
+}
+
+TEST_CASE("XO-CHIP draws to each selected plane in turn", "[profile]")
+{
+	const auto emu = run_as<xo_chip>(
+		0xF3, 0x01, // 200: Select both planes
+		0xA2, 0x0E, // 202: I = 20E
+		0xD0, 0x01, // 204: Draw 8x1 at (0,0) into each plane
+		0xF2, 0x01, // 206: Select plane 1
+		0x00, 0xE0, // 208: Clear plane 1
+		0x00, 0xFD, // 20A: Exit
+		0x00, 0x00,
+		0xC0, 0x3C  // 20E: One row for plane 0, then one for plane 1
+	);
+
+	REQUIRE(emu.plane_mask == 2);
+	REQUIRE(emu.memory[xo_chip::plane_start(0)] == 0xF0);
+	REQUIRE(emu.memory[xo_chip::plane_start(0) + xo_chip::display_row_size] == 0xF0);
+	REQUIRE(emu.memory[xo_chip::plane_start(1)] == 0x00);
+	REQUIRE(emu.memory[xo_chip::plane_start(1) + xo_chip::display_row_size] == 0x00);
+
+	const auto both = run_as<xo_chip>(0xF3, 0x01, 0xA2, 0x08, 0xD0, 0x01, 0x00, 0xFD, 0xC0, 0x3C);
+
+	REQUIRE(both.memory[xo_chip::plane_start(0)] == 0xF0);
+	REQUIRE(both.memory[xo_chip::plane_start(1)] == 0x0F);
+}
+
+TEST_CASE("Shift quirks pick which register is shifted", "[quirks]")
+{
+	// V1 = 5, then V0 = V1 >> 1 or V0 >>= 1
+	constexpr auto in_place = run_as<chip8>(0x61, 0x05, 0x80, 0x16);
+	constexpr auto from_vy = run_as<basic_chip8<chip8_profile, cosmac_vip_quirks>>(0x61, 0x05, 0x80, 0x16);
+
+	static_assert(in_place.registers.data[0x0] == 0 && in_place.registers.data[0xF] == 0);
+	static_assert(from_vy.registers.data[0x0] == 2 && from_vy.registers.data[0xF] == 1);
+
+	constexpr auto left_from_vy = run_as<basic_chip8<chip8_profile, cosmac_vip_quirks>>(0x61, 0x81, 0x80, 0x1E);
+	static_assert(left_from_vy.registers.data[0x0] == 2 && left_from_vy.registers.data[0xF] == 1);
+}
+
+TEST_CASE("Load and store quirks pick whether the address register moves", "[quirks]")
+{
+	constexpr auto fixed = run_as<chip8>(0xA3, 0x00, 0xF2, 0x55, 0xF1, 0x65);
+	constexpr auto moved = run_as<basic_chip8<chip8_profile, cosmac_vip_quirks>>(0xA3, 0x00, 0xF2, 0x55, 0xF1, 0x65);
+
+	static_assert(fixed.registers.address == 0x300);
+	static_assert(moved.registers.address == 0x305);
+}
+
+TEST_CASE("Jump quirks pick which register is added to BNNN", "[quirks]")
+{
+	// V0 = 4, V2 = 8, then jump to 210 plus V0 or V2
+	constexpr auto from_v0 = run_as<chip8>(0x60, 0x04, 0x62, 0x08, 0xB2, 0x10);
+	constexpr auto from_vx = run_as<basic_chip8<chip8_profile, super_chip_quirks>>(0x60, 0x04, 0x62, 0x08, 0xB2, 0x10);
+
+	static_assert(from_v0.program_counter == 0x214);
+	static_assert(from_vx.program_counter == 0x218);
+}
+
+TEST_CASE("Clipping quirks cut sprites off at the edges", "[quirks]")
+{
+	// The small 0 at (62,30)
+	constexpr auto wrapped = run_as<chip8>(0x60, 0x3E, 0x61, 0x1E, 0xD0, 0x15);
+	constexpr auto clipped = run_as<basic_chip8<chip8_profile, super_chip_quirks>>(0x60, 0x3E, 0x61, 0x1E, 0xD0, 0x15);
+
+	static_assert(wrapped.is_pixel_set(62, 30) && wrapped.is_pixel_set(0, 30) && wrapped.is_pixel_set(62, 0));
+	static_assert(clipped.is_pixel_set(63, 30) && clipped.is_pixel_set(62, 31));
+	static_assert(!clipped.is_pixel_set(0, 30) && !clipped.is_pixel_set(62, 0) && !clipped.is_pixel_set(1, 31));
+}
+
+TEST_CASE("Vertical blank quirks draw at most one sprite per frame", "[quirks]")
+{
+	basic_chip8<chip8_profile, cosmac_vip_quirks> emu{ std::array<uint8_t, 4>{ 0xD0, 0x15, 0xD0, 0x15 } };
+
+	for (auto i = 0; i < 3; ++i)
+		REQUIRE(emu.next_instruction());
+
+	REQUIRE(emu.program_counter == 0x200);
+
+	emu.tick_timers();
+	REQUIRE(emu.next_instruction());
+	REQUIRE(emu.next_instruction());
+	REQUIRE(emu.program_counter == 0x202);
+	REQUIRE(emu.is_pixel_set(0, 0));
+
+	// Whether a frame has ended is part of the machine's state
+	static_assert(decltype(emu)::state_size == chip8::state_size + 1);
+
+	emu.tick_timers();
+	const auto state = emu.save_state();
+	decltype(emu) loaded;
+	REQUIRE(loaded.load_state(state.data(), state.size()));
+	REQUIRE(loaded.vertical_blank);
+}
+
+TEST_CASE("Machines and quirks chosen at runtime get their own interpreter", "[quirks]")
+{
+	const auto vip_xo_chip = with_machine(machine_type::xo_chip, quirk_type::cosmac_vip, [](auto& emu)
+	{
+		return std::is_same_v<std::decay_t<decltype(emu)>, basic_chip8<xo_chip_profile, cosmac_vip_quirks>>;
+	});
+
+	const auto plain_chip8 = with_machine(machine_type::chip8, quirk_type::machine, [](auto& emu)
+	{
+		return std::is_same_v<std::decay_t<decltype(emu)>, chip8>;
+	});
+
+	REQUIRE(vip_xo_chip);
+	REQUIRE(plain_chip8);
+
+	// Every instantiation runs the same program through the same body
+	for (const auto machine : { machine_type::chip8, machine_type::super_chip, machine_type::xo_chip })
+	{
+		for (const auto quirks : { quirk_type::machine, quirk_type::chip8, quirk_type::cosmac_vip, quirk_type::super_chip, quirk_type::xo_chip })
+		{
+			const auto result = with_machine(machine, quirks, [](auto& emu)
+			{
+				emu.load_program(std::array<uint8_t, 6>{ 0x61, 0x05, 0x80, 0x16, 0x00, 0x00 });
+				emu.run();
+				return emu.registers.data[0x0];
+			});
+
+			const auto from_vy = quirks == quirk_type::cosmac_vip || quirks == quirk_type::xo_chip
+				|| (quirks == quirk_type::machine && machine == machine_type::xo_chip);
+			REQUIRE(result == (from_vy ? 2 : 0));
+		}
+	}
+}
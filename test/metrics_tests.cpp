@@ -0,0 +1,79 @@
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "metrics.h"
+
+TEST_CASE("Frame time percentiles come from the frames in between two snapshots", "[metrics]")
+{
+	using std::chrono::microseconds;
+
+	emulator_metrics metrics;
+
+	// Slow frames before the first snapshot must not show up in the second interval
+	for (auto i = 0; i < 10; ++i)
+		metrics.add_frame_time(microseconds(100000));
+
+	const auto before = metrics.snapshot();
+
+	for (auto i = 0; i < 99; ++i)
+		metrics.add_frame_time(microseconds(16000));
+
+	metrics.add_frame_time(microseconds(40000));
+	metrics.add_instructions(6000);
+
+	const auto interval = metrics.snapshot() - before;
+
+	REQUIRE(interval.frames == 100);
+	REQUIRE(interval.instructions == 6000);
+	REQUIRE(interval.frame_time_ns == 99 * 16000000ull + 40000000ull);
+
+	// Each bucket is a quarter of an octave wide, so an estimate can be out by up to 19%
+	REQUIRE(interval.frame_time_percentile(50.0) == Approx(0.016).epsilon(0.19));
+	REQUIRE(interval.frame_time_percentile(99.0) == Approx(0.016).epsilon(0.19));
+	REQUIRE(interval.frame_time_percentile(100.0) == Approx(0.040).epsilon(0.19));
+	REQUIRE(metrics_snapshot{}.frame_time_percentile(50.0) == 0.0);
+}
+
+TEST_CASE("Metrics are written in the Prometheus text format", "[metrics]")
+{
+	emulator_metrics metrics;
+	metrics.add_instructions(1234);
+	metrics.add_frame_time(std::chrono::milliseconds(1000));
+	metrics.add_render_time(std::chrono::milliseconds(2));
+	metrics.add_audio_underrun();
+
+	std::ostringstream out;
+	metrics.snapshot().write_prometheus(out);
+	const auto text = out.str();
+
+	REQUIRE(text.find("# TYPE chip8_instructions_total counter\nchip8_instructions_total 1234\n") != std::string::npos);
+	REQUIRE(text.find("chip8_frame_time_seconds_bucket{le=\"0.256\"} 0\n") != std::string::npos);
+	REQUIRE(text.find("chip8_frame_time_seconds_bucket{le=\"+Inf\"} 1\n") != std::string::npos);
+	REQUIRE(text.find("chip8_frame_time_seconds_count 1\n") != std::string::npos);
+	REQUIRE(text.find("chip8_render_time_seconds_sum 0.002\n") != std::string::npos);
+	REQUIRE(text.find("chip8_audio_underruns_total 1\n") != std::string::npos);
+}
+
+TEST_CASE("The exporter leaves the final totals in its file", "[metrics]")
+{
+	const auto file_path = "metrics_tests.prom";
+	emulator_metrics metrics;
+
+	{
+		metrics_exporter exporter(metrics, file_path, std::chrono::hours(1));
+		metrics.add_instructions(42);
+	}
+
+	std::ifstream file(file_path);
+	std::stringstream text;
+	text << file.rdbuf();
+	file.close();
+	std::remove(file_path);
+
+	REQUIRE(text.str().find("chip8_instructions_total 42\n") != std::string::npos);
+}
@@ -0,0 +1,199 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include "chip8.h"
+#include "movie.h"
+
+namespace
+{
+	// Moves a sprite with keys 4 and 6, waits for a key, and adds random numbers to V5
+	constexpr std::array<uint8_t, 28> program = {
+		0xF3, 0x0A, // 200: Wait for a key in V3
+		0x64, 0x04, // 202: V4 = 4
+		0x66, 0x06, // 204: V6 = 6
+		0xA0, 0x00, // 206: I = 0
+		0xD0, 0x15, // 208: Draw 8x5 sprite at (V0,V1)
+		0xE4, 0xA1, // 20A: Skip if key V4 is not pressed
+		0x70, 0xFF, // 20C: V0 -= 1
+		0xE6, 0xA1, // 20E: Skip if key V6 is not pressed
+		0x70, 0x01, // 210: V0 += 1
+		0xD0, 0x15, // 212: Draw 8x5 sprite at (V0,V1)
+		0xC7, 0x0F, // 214: V7 = random AND 0F
+		0x85, 0x74, // 216: V5 += V7
+		0xF2, 0x07, // 218: V2 = delay timer
+		0x12, 0x08  // 21A: Jump 208
+	};
+
+	// The same key masks held for several frames at a time, as a player would, with the odd tap partway through a frame
+	movie_frame scripted_input(const int frame)
+	{
+		constexpr std::array<uint16_t, 6> keys = { 0x0000, 0x0002, 0x0000, 0x0010, 0x0050, 0x0040 };
+		const uint16_t held = keys[(frame / 20) % keys.size()];
+		movie_frame input{ held, static_cast<uint8_t>(frame % 100 == 99 ? 2 : 1), {} };
+
+		if (frame % 20 == 10)
+			input.key_changes = { { 3, static_cast<uint16_t>(held | 0x0008) }, { 7, held } };
+
+		return input;
+	}
+
+	uint64_t run_frame(chip8& emu, const movie_frame& frame, const uint64_t cycles)
+	{
+		return run_frame_input(emu, frame, cycles, [&emu](const uint64_t count)
+		{
+			for (uint64_t i = 0; i < count; ++i)
+				emu.next_instruction();
+
+			return count;
+		});
+	}
+
+	chip8 record(movie& recording, const int frames)
+	{
+		chip8 emu{ program };
+		emu.seed_random(recording.seed);
+		recording.program_hash = program_hash(emu);
+
+		double cycle_budget = 0.0;
+
+		for (auto frame = 0; frame < frames; ++frame)
+		{
+			const auto input = scripted_input(frame);
+			recording.record(input);
+
+			const auto cycles = next_frame_cycles(recording.cycles_per_frame, cycle_budget);
+			apply_frame_input(emu, input);
+			run_frame(emu, input, cycles);
+		}
+
+		return emu;
+	}
+
+	chip8 replay(const movie& recording)
+	{
+		chip8 emu{ program };
+		emu.seed_random(recording.seed);
+
+		movie_player player(recording);
+		movie_frame frame;
+		double cycle_budget = 0.0;
+
+		while (player.next(frame))
+		{
+			const auto cycles = next_frame_cycles(recording.cycles_per_frame, cycle_budget);
+			apply_frame_input(emu, frame);
+			run_frame(emu, frame, cycles);
+		}
+
+		return emu;
+	}
+}
+
+TEST_CASE("Replaying a movie reproduces the recorded run", "[movie]")
+{
+	movie recording;
+	recording.seed = 0xC8;
+	recording.cycles_per_frame = 700.0 / 60.0;
+
+	const auto recorded = record(recording, 600);
+	const auto replayed = replay(recording);
+
+	REQUIRE(recording.frame_count() == 600);
+	REQUIRE(replayed.save_state() == recorded.save_state());
+}
+
+TEST_CASE("Movies round trip through files", "[movie]")
+{
+	movie recording;
+	recording.seed = 0x1234;
+	recording.cycles_per_frame = 12.5;
+
+	const auto recorded = record(recording, 600);
+	const auto file_path = "movie_tests.c8m";
+
+	recording.save(file_path);
+	const auto loaded = movie::load(file_path);
+
+	std::ifstream file(file_path, std::ios::binary | std::ios::ate);
+	const auto file_size = static_cast<std::size_t>(file.tellg());
+	file.close();
+	std::remove(file_path);
+
+	REQUIRE(loaded.seed == recording.seed);
+	REQUIRE(loaded.cycles_per_frame == recording.cycles_per_frame);
+	REQUIRE(loaded.program_hash == recording.program_hash);
+	REQUIRE(loaded.frame_count() == 600);
+	REQUIRE(replay(loaded).save_state() == recorded.save_state());
+
+	// Runs of identical frames keep the file far smaller than one 9 byte entry per frame
+	REQUIRE(file_size < 600 * 9 / 4);
+}
+
+TEST_CASE("Loading a file that is not a movie throws", "[movie]")
+{
+	const auto file_path = "movie_tests_invalid.c8m";
+
+	{
+		std::ofstream file(file_path, std::ios::binary);
+		file << "C8MV";
+	}
+
+	REQUIRE_THROWS_AS(movie::load(file_path), std::runtime_error);
+	std::remove(file_path);
+
+	REQUIRE_THROWS_AS(movie::load(file_path), std::runtime_error);
+}
+
+TEST_CASE("Identical frames are stored as a single run", "[movie]")
+{
+	movie recording;
+
+	for (auto i = 0; i < 1000; ++i)
+		recording.record({ 0x0001, 1, {} });
+
+	recording.record({ 0x0002, 1, {} });
+
+	movie_player player(recording);
+	movie_frame frame;
+	auto played = 0;
+
+	while (player.next(frame))
+		++played;
+
+	REQUIRE(played == 1001);
+	REQUIRE(frame.key_state == 0x0002);
+}
+
+TEST_CASE("Key changes apply once the instructions before them have run", "[movie]")
+{
+	constexpr std::array<uint8_t, 4> wait_program = {
+		0xF3, 0x0A, // 200: Wait for a key in V3
+		0x12, 0x02  // 202: Jump 202
+	};
+
+	chip8 emu{ wait_program };
+	movie_frame frame{ 0x0000, 0, { { 3, 0x0002 }, { 6, 0x0000 }, { 20, 0x0004 } } };
+	std::vector<uint64_t> runs;
+
+	const auto ran = run_frame_input(emu, frame, 10, [&](const uint64_t count)
+	{
+		runs.push_back(count);
+
+		for (uint64_t i = 0; i < count; ++i)
+			emu.next_instruction();
+
+		return count;
+	});
+
+	// The change past the end of the frame applies after its last instruction
+	REQUIRE(ran == 10);
+	REQUIRE(runs == std::vector<uint64_t>{ 3, 3, 4 });
+	REQUIRE(emu.registers.data[3] == 0x1);
+	REQUIRE(emu.key_state == 0x0004);
+}
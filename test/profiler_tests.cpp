@@ -0,0 +1,105 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include "chip8.h"
+#include "profiler.h"
+
+namespace
+{
+	// Calls a subroutine twice, which calls another before returning, and then quits
+	constexpr std::array<uint8_t, 16> nested_program = {
+		0x22, 0x06, // 200: Call 206
+		0x22, 0x06, // 202: Call 206
+		0x00, 0xEE, // 204: Return
+		0x60, 0x01, // 206: V0 = 1
+		0x22, 0x0C, // 208: Call 20C
+		0x00, 0xEE, // 20A: Return
+		0x70, 0x01, // 20C: V0 += 1
+		0x00, 0xEE  // 20E: Return
+	};
+}
+
+TEST_CASE("The profiler counts instructions by operation, address and subroutine", "[profiler]")
+{
+	chip8 emu{ nested_program };
+	execution_profiler profiler;
+
+	while (emu.next_instruction(profiler)) {}
+
+	// The return that quits the program is not counted, just as it does not count as a cycle
+	REQUIRE(profiler.instructions() == 12);
+	REQUIRE(profiler.executions(operation::call) == 4);
+	REQUIRE(profiler.executions(operation::return_from_subroutine) == 4);
+	REQUIRE(profiler.executions_at(0x206) == 2);
+	REQUIRE(profiler.executions_at(0x204) == 0);
+
+	const auto subroutines = profiler.subroutines();
+	REQUIRE(subroutines.size() == 2);
+
+	const auto& outer = subroutines.at(0x206);
+	REQUIRE(outer.calls == 2);
+	REQUIRE(outer.self_instructions == 6);
+	REQUIRE(outer.inclusive_instructions == 10);
+
+	const auto& inner = subroutines.at(0x20C);
+	REQUIRE(inner.calls == 2);
+	REQUIRE(inner.self_instructions == 4);
+	REQUIRE(inner.inclusive_instructions == 4);
+
+	std::ostringstream stacks;
+	profiler.write_collapsed_stacks(stacks);
+	REQUIRE(stacks.str() == "start 2\nstart;sub_206 6\nstart;sub_206;sub_20C 4\n");
+}
+
+TEST_CASE("Profiling does not change how a program runs", "[profiler]")
+{
+	// Draws random sprites through a subroutine forever
+	constexpr std::array<uint8_t, 14> program = {
+		0x22, 0x04, // 200: Call 204
+		0x12, 0x00, // 202: Jump 200
+		0xC0, 0x3F, // 204: V0 = random AND 3F
+		0xF0, 0x29, // 206: I = character V0
+		0xD0, 0x05, // 208: Draw 8x5 sprite at (V0,V0)
+		0x00, 0xEE, // 20A: Return
+		0x00, 0x00
+	};
+
+	chip8 profiled{ program };
+	chip8 plain{ program };
+	execution_profiler profiler;
+
+	for (auto i = 0; i < 10000; ++i)
+	{
+		REQUIRE(profiled.next_instruction(profiler));
+		REQUIRE(plain.next_instruction());
+	}
+
+	REQUIRE(profiled.save_state() == plain.save_state());
+	REQUIRE(profiler.instructions() == 10000);
+}
+
+TEST_CASE("Operations are named after the patterns they decode from", "[profiler]")
+{
+	for (std::size_t i = 0; i + 1 < operation_count; ++i)
+	{
+		const auto op = static_cast<operation>(i);
+		const std::string pattern = operation_pattern(op);
+		INFO("Pattern " << pattern);
+
+		// Every operand is filled in with the same arbitrary digit
+		uint16_t instruction = 0;
+
+		for (const auto c : pattern)
+		{
+			const auto operand = c == 'X' || c == 'Y' || c == 'N';
+			instruction = static_cast<uint16_t>((instruction << 4) | (operand ? 0xC : std::stoi(std::string(1, c), nullptr, 16)));
+		}
+
+		// XO-CHIP decodes every operation there is
+		REQUIRE(decode_operation<opcode_set::xo_chip>(instruction) == op);
+	}
+}
@@ -0,0 +1,152 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "chip8.h"
+#include "rewind_buffer.h"
+
+namespace
+{
+	// Draws a sprite one pixel further right each time round the loop, counting in V2
+	constexpr std::array<uint8_t, 12> program = {
+		0xA0, 0x00, // 200: I = 0
+		0xD0, 0x15, // 202: Draw 8x5 sprite at (V0,V1)
+		0x70, 0x01, // 204: V0 += 1
+		0x72, 0x01, // 206: V2 += 1
+		0xD0, 0x15, // 208: Draw 8x5 sprite at (V0,V1)
+		0x12, 0x04  // 20A: Jump 204
+	};
+
+	constexpr auto cycles_per_frame = 5;
+
+	void run_frame(chip8& emu)
+	{
+		for (auto i = 0; i < cycles_per_frame; ++i)
+			emu.next_instruction();
+
+		emu.tick_timers();
+	}
+
+	bool same_state(const chip8& lhs, const chip8& rhs)
+	{
+		return lhs.save_state() == rhs.save_state();
+	}
+}
+
+TEST_CASE("Stepping back restores every recorded frame in reverse", "[rewind]")
+{
+	chip8 emu{ program };
+	rewind_buffer rewind(100, 64 * 1024);
+	std::vector<chip8> history;
+
+	for (auto frame = 0; frame < 50; ++frame)
+	{
+		run_frame(emu);
+		rewind.record(emu);
+		history.push_back(emu);
+	}
+
+	REQUIRE(rewind.frames() == 49);
+
+	for (auto frame = 48; frame >= 0; --frame)
+	{
+		REQUIRE(rewind.step_back(emu));
+		REQUIRE(same_state(emu, history[frame]));
+	}
+
+	REQUIRE_FALSE(rewind.step_back(emu));
+	REQUIRE(same_state(emu, history[0]));
+}
+
+TEST_CASE("Deltas are much smaller than full states", "[rewind]")
+{
+	chip8 emu{ program };
+	rewind_buffer rewind(100, 64 * 1024);
+
+	for (auto frame = 0; frame < 51; ++frame)
+	{
+		run_frame(emu);
+		rewind.record(emu);
+	}
+
+	REQUIRE(rewind.bytes_used() < 50 * chip8::state_size / 20);
+}
+
+TEST_CASE("The oldest frames are dropped once the frame limit is reached", "[rewind]")
+{
+	chip8 emu{ program };
+	rewind_buffer rewind(10, 64 * 1024);
+	std::vector<chip8> history;
+
+	for (auto frame = 0; frame < 30; ++frame)
+	{
+		run_frame(emu);
+		rewind.record(emu);
+		history.push_back(emu);
+	}
+
+	REQUIRE(rewind.frames() == 10);
+
+	while (rewind.step_back(emu)) {}
+
+	REQUIRE(same_state(emu, history[19]));
+}
+
+TEST_CASE("The oldest frames are dropped once the buffer is full", "[rewind]")
+{
+	chip8 emu{ program };
+	rewind_buffer rewind(1000, 3 * chip8::state_size);
+	std::vector<chip8> history;
+
+	// Filling memory with random bytes makes every delta large
+	for (auto frame = 0; frame < 20; ++frame)
+	{
+		for (auto& byte : emu.memory)
+			byte = emu.random_byte();
+
+		rewind.record(emu);
+		history.push_back(emu);
+	}
+
+	REQUIRE(rewind.frames() < 19);
+	REQUIRE(rewind.bytes_used() <= 3 * chip8::state_size);
+
+	const auto frames = rewind.frames();
+
+	while (rewind.step_back(emu)) {}
+
+	REQUIRE(same_state(emu, history[19 - frames]));
+}
+
+TEST_CASE("Recording carries on from a frame that was stepped back to", "[rewind]")
+{
+	chip8 emu{ program };
+	rewind_buffer rewind(100, 64 * 1024);
+
+	for (auto frame = 0; frame < 10; ++frame)
+	{
+		run_frame(emu);
+		rewind.record(emu);
+	}
+
+	rewind.step_back(emu);
+	rewind.step_back(emu);
+	const auto branch_point = emu;
+
+	emu.registers.data[0x5] = 0x55;
+	run_frame(emu);
+	rewind.record(emu);
+
+	REQUIRE(rewind.frames() == 8);
+	REQUIRE(rewind.step_back(emu));
+	REQUIRE(same_state(emu, branch_point));
+}
+
+TEST_CASE("Rewind buffers must be able to hold a frame", "[rewind]")
+{
+	REQUIRE_THROWS_AS(rewind_buffer(0, 64 * 1024), std::invalid_argument);
+	REQUIRE_THROWS_AS(rewind_buffer(10, 16), std::invalid_argument);
+}
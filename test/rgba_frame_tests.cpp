@@ -0,0 +1,28 @@
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+
+#include "chip8.h"
+#include "rgba_frame.h"
+
+TEST_CASE("Display rows expand to foreground and background pixels", "[rgba_frame]")
+{
+	chip8 emu;
+	rgba_frame frame;
+	frame.set_colours({ 10, 20, 30, 40 }, { 1, 2, 3, 4 });
+
+	emu.invert_pixel(0, 5);
+	emu.invert_pixel(63, 5);
+
+	const auto* row = frame.convert_rows(emu, 5, 1);
+
+	for (auto x = 0; x < chip8::display_width; ++x)
+	{
+		INFO("Pixel " << x);
+		const auto* pixel = row + x * rgba_frame::bytes_per_pixel;
+		const uint8_t expected = (x == 0 || x == 63) ? 10 : 1;
+
+		REQUIRE(pixel[0] == expected);
+		REQUIRE(pixel[3] == expected * 4);
+	}
+}
@@ -0,0 +1,138 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "rom_analysis.h"
+
+namespace
+{
+	// Calls a subroutine, skips over a jump into data, and loops forever
+	constexpr std::array<uint8_t, 20> program = {
+		0x22, 0x0C, // 200: Call 20C
+		0x30, 0x01, // 202: Skip if V0 == 1
+		0x12, 0x10, // 204: Jump 210
+		0x12, 0x08, // 206: Jump 208
+		0x12, 0x08, // 208: Jump 208
+		0xA2, 0x10, // 20A: Unreachable
+		0x60, 0x01, // 20C: V0 = 1
+		0x00, 0xEE, // 20E: Return
+		0xF0, 0x90, // 210: Data past the end of the code
+		0xF0, 0x90
+	};
+}
+
+TEST_CASE("ROM analysis follows calls, skips and jumps", "[rom_analysis]")
+{
+	const auto analysis = analyze_rom(program.data(), program.size());
+	const auto& starts = analysis.instruction_starts;
+
+	REQUIRE(starts.size() == program.size());
+
+	for (const auto offset : { 0x0, 0x2, 0x4, 0x6, 0x8, 0xC, 0xE, 0x10 })
+		REQUIRE(starts[offset]);
+
+	// 0x10 is reached by the jump from 204, but F090 is not an instruction and nothing runs after it
+	for (const auto offset : { 0x1, 0xA, 0x12 })
+		REQUIRE_FALSE(starts[offset]);
+
+	REQUIRE(analysis.code_size() == 16);
+	REQUIRE(analysis.machine == machine_type::chip8);
+	REQUIRE(analysis.quirks == quirk_type::chip8);
+	REQUIRE_FALSE(analysis.indirect_jumps);
+}
+
+TEST_CASE("ROM analysis detects the machine a ROM needs", "[rom_analysis]")
+{
+	constexpr std::array<uint8_t, 6> super_chip_program = { 0x00, 0xFF, 0xB2, 0x00, 0x00, 0xFD };
+	const auto super_chip_analysis = analyze_rom(super_chip_program.data(), super_chip_program.size());
+	REQUIRE(super_chip_analysis.machine == machine_type::super_chip);
+	REQUIRE(super_chip_analysis.quirks == quirk_type::super_chip);
+	REQUIRE(super_chip_analysis.indirect_jumps);
+	REQUIRE_FALSE(super_chip_analysis.instruction_starts[4]);
+
+	// Skipping over F000 NNNN skips all four bytes of it
+	constexpr std::array<uint8_t, 10> xo_chip_program = { 0x30, 0x00, 0xF0, 0x00, 0x12, 0x34, 0x12, 0x06, 0x00, 0xFD };
+	const auto xo_chip_analysis = analyze_rom(xo_chip_program.data(), xo_chip_program.size());
+	REQUIRE(xo_chip_analysis.machine == machine_type::xo_chip);
+	REQUIRE(xo_chip_analysis.instruction_starts[2]);
+	REQUIRE_FALSE(xo_chip_analysis.instruction_starts[4]);
+	REQUIRE(xo_chip_analysis.instruction_starts[6]);
+	REQUIRE(xo_chip_analysis.code_size() == 8);
+	REQUIRE(xo_chip_analysis.quirks == quirk_type::xo_chip);
+
+	// Shifting one register into another is only worth doing when shifts read Vy
+	constexpr std::array<uint8_t, 4> vip_program = { 0x81, 0x26, 0x12, 0x02 };
+	REQUIRE(analyze_rom(vip_program.data(), vip_program.size()).quirks == quirk_type::cosmac_vip);
+}
+
+TEST_CASE("ROM analysis splits code into basic blocks", "[rom_analysis]")
+{
+	const auto analysis = analyze_rom(program.data(), program.size());
+	const auto& blocks = analysis.blocks;
+
+	REQUIRE(blocks.size() == 7);
+
+	REQUIRE(blocks[0].start == 0x200);
+	REQUIRE(blocks[0].end == 0x202);
+	REQUIRE(blocks[0].successors == std::vector<uint32_t>{ 0x20C, 0x202 });
+
+	REQUIRE(blocks[1].start == 0x202);
+	REQUIRE(blocks[1].successors == std::vector<uint32_t>{ 0x204, 0x206 });
+
+	REQUIRE(blocks[4].start == 0x208);
+	REQUIRE(blocks[4].successors == std::vector<uint32_t>{ 0x208 });
+
+	// The subroutine runs up to its return, which has no known successor
+	REQUIRE(blocks[5].start == 0x20C);
+	REQUIRE(blocks[5].end == 0x210);
+	REQUIRE(blocks[5].successors.empty());
+}
+
+TEST_CASE("ROM analysis only follows BNNN targets when asked to", "[rom_analysis]")
+{
+	constexpr std::array<uint8_t, 8> jump_table = {
+		0xB2, 0x04, // 200: Jump 204 + V0
+		0x00, 0x00, // 202: Unused
+		0x12, 0x04, // 204: Jump 204
+		0x12, 0x06  // 206: Jump 206
+	};
+
+	const auto analysis = analyze_rom(jump_table.data(), jump_table.size());
+	REQUIRE(analysis.indirect_jumps);
+	REQUIRE(analysis.code_size() == 2);
+	REQUIRE(analysis.blocks.front().successors.empty());
+
+	const auto followed = analyze_rom(jump_table.data(), jump_table.size(), true);
+	REQUIRE(followed.indirect_jumps);
+	REQUIRE(followed.code_size() == 6);
+	REQUIRE_FALSE(followed.instruction_starts[2]);
+	REQUIRE(followed.instruction_starts[4]);
+	REQUIRE(followed.instruction_starts[5]);
+	REQUIRE(followed.instruction_starts[6]);
+	REQUIRE(followed.blocks.front().successors == std::vector<uint32_t>{ 0x204, 0x205, 0x206 });
+}
+
+TEST_CASE("ROM analysis finds sprites and unused bytes", "[rom_analysis]")
+{
+	constexpr std::array<uint8_t, 16> sprite_program = {
+		0xA2, 0x08, // 200: I = 208
+		0xD0, 0x15, // 202: Draw 8x5 sprite at (V0,V1)
+		0x12, 0x04, // 204: Jump 204
+		0x00, 0x00, // 206: Unused
+		0xF0, 0x90, 0x90, 0x90, 0xF0, // 208: Sprite
+		0x00, 0x00, 0x00 // 20D: Unused
+	};
+
+	const auto analysis = analyze_rom(sprite_program.data(), sprite_program.size());
+
+	REQUIRE(analysis.code_size() == 6);
+	REQUIRE(analysis.sprite_data_size() == 5);
+
+	for (std::size_t offset = 8; offset < 13; ++offset)
+		REQUIRE(analysis.sprite_data[offset]);
+
+	REQUIRE(analysis.used_size() == 13);
+}
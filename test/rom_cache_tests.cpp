@@ -0,0 +1,151 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+#include "chip8.h"
+#include "rom_cache.h"
+
+namespace
+{
+	constexpr std::array<uint8_t, 8> program = {
+		0x60, 0x05, // 200: V0 = 5
+		0x70, 0xFF, // 202: V0 -= 1
+		0x40, 0x00, // 204: Skip if V0 != 0
+		0x00, 0xEE  // 206: Return
+	};
+
+	constexpr auto cache_directory = "rom_cache_tests";
+}
+
+TEST_CASE("ROM cache entries round trip through files", "[rom_cache]")
+{
+	std::filesystem::remove_all(cache_directory);
+	const rom_cache cache(cache_directory);
+
+	rom_cache_entry entry;
+	REQUIRE_FALSE(cache.find(program.data(), program.size(), entry));
+
+	const auto added = cache.add(program.data(), program.size());
+	REQUIRE(added.machine == machine_type::chip8);
+	REQUIRE(added.quirks == quirk_type::chip8);
+	REQUIRE(added.code_size == 8);
+
+	REQUIRE(cache.find(program.data(), program.size(), entry));
+	REQUIRE(entry.rom == added.rom);
+	REQUIRE(entry.machine == added.machine);
+	REQUIRE(entry.quirks == added.quirks);
+	REQUIRE(entry.code_size == added.code_size);
+	REQUIRE(entry.known_results.empty());
+
+	// A different ROM has its own entry
+	auto other = program;
+	other[1] = 0x06;
+	REQUIRE_FALSE(cache.find(other.data(), other.size(), entry));
+
+	std::filesystem::remove_all(cache_directory);
+}
+
+TEST_CASE("ROM cache entries keep known results", "[rom_cache]")
+{
+	std::filesystem::remove_all(cache_directory);
+	const rom_cache cache(cache_directory);
+
+	chip8 emu{ program };
+	emu.run();
+
+	known_result run;
+	run.cycles = 1000;
+	run.cycles_per_frame = 10;
+	run.seed = 1234;
+	run.state_hash = state_hash(emu);
+
+	auto entry = cache.add(program.data(), program.size());
+	REQUIRE(entry.find_known_result(run) == nullptr);
+
+	entry.known_results.push_back(run);
+	cache.store(entry);
+
+	rom_cache_entry found;
+	REQUIRE(cache.find(program.data(), program.size(), found));
+
+	const auto* known = found.find_known_result(run);
+	REQUIRE(known != nullptr);
+	REQUIRE(known->state_hash == state_hash(emu));
+
+	auto other_seed = run;
+	other_seed.seed = 5678;
+	REQUIRE(found.find_known_result(other_seed) == nullptr);
+
+	std::filesystem::remove_all(cache_directory);
+}
+
+TEST_CASE("Storing an entry keeps the known results another writer stored", "[rom_cache]")
+{
+	std::filesystem::remove_all(cache_directory);
+	const rom_cache cache(cache_directory);
+
+	// Two processes that read the same entry before either stored its result
+	auto first = cache.add(program.data(), program.size());
+	auto second = first;
+
+	known_result run;
+	run.cycles = 1000;
+	run.seed = 1;
+	first.known_results.push_back(run);
+	cache.store(first);
+
+	run.seed = 2;
+	second.known_results.push_back(run);
+	cache.store(second);
+
+	rom_cache_entry found;
+	REQUIRE(cache.find(program.data(), program.size(), found));
+	REQUIRE(found.known_results.size() == 2);
+
+	run.seed = 1;
+	REQUIRE(found.find_known_result(run) != nullptr);
+
+	std::filesystem::remove_all(cache_directory);
+}
+
+TEST_CASE("Corrupt ROM cache entries are treated as missing", "[rom_cache]")
+{
+	std::filesystem::remove_all(cache_directory);
+	const rom_cache cache(cache_directory);
+	cache.add(program.data(), program.size());
+
+	{
+		std::ofstream file(cache.entry_path(program.data(), program.size()), std::ios::binary | std::ios::trunc);
+		file << "C8RC";
+	}
+
+	rom_cache_entry entry;
+	REQUIRE_FALSE(cache.find(program.data(), program.size(), entry));
+
+	std::filesystem::remove_all(cache_directory);
+}
+
+TEST_CASE("ROM cache entries with known results for unknown machines are treated as missing", "[rom_cache]")
+{
+	std::filesystem::remove_all(cache_directory);
+	const rom_cache cache(cache_directory);
+
+	auto entry = cache.add(program.data(), program.size());
+	entry.known_results.emplace_back();
+	cache.store(entry);
+
+	// The known result is the last 26 bytes, starting with its machine
+	{
+		std::fstream file(cache.entry_path(program.data(), program.size()), std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(-26, std::ios::end);
+		file.put(0x7F);
+	}
+
+	REQUIRE_FALSE(cache.find(program.data(), program.size(), entry));
+
+	std::filesystem::remove_all(cache_directory);
+}
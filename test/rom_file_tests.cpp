@@ -0,0 +1,183 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "chip8.h"
+#include "rom_file.h"
+#include "rom_pack.h"
+
+namespace
+{
+	constexpr auto program_memory_size = chip8::program_memory_end - chip8::program_memory_start;
+
+	std::vector<uint8_t> make_rom(const std::size_t size)
+	{
+		std::vector<uint8_t> rom(size);
+
+		for (std::size_t i = 0; i < size; ++i)
+			rom[i] = static_cast<uint8_t>((i * 7) + 1);
+
+		return rom;
+	}
+
+	void write_octal(uint8_t* field, const std::size_t length, std::size_t value)
+	{
+		for (std::size_t i = length - 1; i-- > 0; value /= 8)
+			field[i] = static_cast<uint8_t>('0' + (value % 8));
+	}
+
+	// Appends a ustar header and its data, as tar itself writes them
+	void add_tar_entry(std::vector<uint8_t>& archive, const std::string& name, const std::vector<uint8_t>& data,
+		const char type = '0', const std::string& prefix = "")
+	{
+		const auto header_start = archive.size();
+		archive.resize(header_start + 512);
+		auto* header = &archive[header_start];
+
+		std::memcpy(header, name.data(), name.size());
+		write_octal(header + 100, 8, 0644);
+		write_octal(header + 124, 12, data.size());
+		header[156] = static_cast<uint8_t>(type);
+		std::memcpy(header + 257, "ustar", 6);
+		std::memcpy(header + 263, "00", 2);
+		std::memcpy(header + 345, prefix.data(), prefix.size());
+
+		std::fill(header + 148, header + 156, ' ');
+		std::size_t checksum = 0;
+
+		for (std::size_t i = 0; i < 512; ++i)
+			checksum += header[i];
+
+		write_octal(header + 148, 7, checksum);
+
+		archive.insert(archive.end(), data.begin(), data.end());
+		archive.resize(archive.size() + ((512 - (data.size() % 512)) % 512));
+	}
+
+	void end_tar(std::vector<uint8_t>& archive)
+	{
+		archive.resize(archive.size() + 1024);
+	}
+}
+
+TEST_CASE("ROMs are copied into program memory", "[rom_file]")
+{
+	chip8 emu;
+	const auto rom = make_rom(100);
+
+	const auto result = load_rom(emu, rom.data(), rom.size(), "test");
+
+	REQUIRE(result.loaded_size == 100);
+	REQUIRE_FALSE(result.truncated());
+	REQUIRE(std::equal(rom.begin(), rom.end(), emu.memory.begin() + chip8::program_memory_start));
+	REQUIRE(emu.memory[chip8::program_memory_start + 100] == 0);
+}
+
+TEST_CASE("Oversized ROMs are rejected or truncated", "[rom_file]")
+{
+	const auto rom = make_rom(program_memory_size + 1);
+
+	chip8 rejected;
+	const auto memory = rejected.memory;
+	REQUIRE_THROWS_AS(load_rom(rejected, rom.data(), rom.size(), "test"), std::runtime_error);
+	REQUIRE(rejected.memory == memory);
+
+	chip8 truncated;
+	const auto result = load_rom(truncated, rom.data(), rom.size(), "test", oversized_rom::truncate);
+	REQUIRE(result.truncated());
+	REQUIRE(result.loaded_size == program_memory_size);
+	REQUIRE(result.rom_size == program_memory_size + 1);
+	REQUIRE(std::equal(rom.begin(), rom.end() - 1, truncated.memory.begin() + chip8::program_memory_start));
+}
+
+TEST_CASE("ROM files are read straight into program memory", "[rom_file]")
+{
+	const auto file_path = "rom_file_tests.ch8";
+	const auto rom = make_rom(program_memory_size + 10);
+
+	{
+		std::ofstream file(file_path, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(rom.data()), static_cast<std::streamsize>(rom.size()));
+	}
+
+	chip8 rejected;
+	REQUIRE_THROWS_AS(load_rom_file(rejected, file_path), std::runtime_error);
+	REQUIRE_THROWS_AS(read_rom_file(file_path), std::runtime_error);
+
+	chip8 truncated;
+	const auto result = load_rom_file(truncated, file_path, oversized_rom::truncate);
+	std::remove(file_path);
+
+	REQUIRE(result.loaded_size == program_memory_size);
+	REQUIRE(std::equal(rom.begin(), rom.begin() + program_memory_size, truncated.memory.begin() + chip8::program_memory_start));
+
+	REQUIRE_THROWS_AS(load_rom_file(truncated, file_path), std::runtime_error);
+}
+
+TEST_CASE("ROM packs list the regular files in a tar archive", "[rom_pack]")
+{
+	const auto first = make_rom(10);
+	const auto second = make_rom(600);
+
+	std::vector<uint8_t> archive;
+	add_tar_entry(archive, "roms/", {}, '5');
+	add_tar_entry(archive, "first.ch8", first, '0', "roms");
+	add_tar_entry(archive, "second.ch8", second);
+	end_tar(archive);
+
+	const rom_pack pack(archive, "test.tar");
+
+	REQUIRE(pack.entries().size() == 2);
+	REQUIRE(pack.entries()[0].name == "roms/first.ch8");
+	REQUIRE(pack.entries()[1].name == "second.ch8");
+	REQUIRE(pack.find("roms/") == nullptr);
+
+	const auto* rom = pack.find("second.ch8");
+	REQUIRE(rom != nullptr);
+	REQUIRE(rom->size == second.size());
+	REQUIRE(std::equal(second.begin(), second.end(), pack.data(*rom)));
+
+	chip8 emu;
+	load_rom(emu, pack.data(pack.entries()[0]), pack.entries()[0].size, pack.entries()[0].name);
+	REQUIRE(std::equal(first.begin(), first.end(), emu.memory.begin() + chip8::program_memory_start));
+}
+
+TEST_CASE("ROM packs use GNU long names", "[rom_pack]")
+{
+	const std::string long_name(150, 'a');
+	const auto rom = make_rom(20);
+
+	std::vector<uint8_t> archive;
+	add_tar_entry(archive, "././@LongLink", std::vector<uint8_t>(long_name.begin(), long_name.end()), 'L');
+	add_tar_entry(archive, long_name.substr(0, 100), rom);
+	end_tar(archive);
+
+	const rom_pack pack(archive, "test.tar");
+
+	REQUIRE(pack.entries().size() == 1);
+	REQUIRE(pack.entries()[0].name == long_name);
+}
+
+TEST_CASE("Corrupt or truncated ROM packs throw", "[rom_pack]")
+{
+	std::vector<uint8_t> archive;
+	add_tar_entry(archive, "first.ch8", make_rom(600));
+	end_tar(archive);
+
+	auto corrupt = archive;
+	corrupt[0] = 'b';
+	REQUIRE_THROWS_AS(rom_pack(corrupt, "test.tar"), std::runtime_error);
+
+	auto truncated = archive;
+	truncated.resize(512 + 100);
+	REQUIRE_THROWS_AS(rom_pack(truncated, "test.tar"), std::runtime_error);
+
+	REQUIRE(rom_pack({}, "empty.tar").entries().empty());
+}
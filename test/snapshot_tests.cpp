@@ -0,0 +1,86 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+
+#include "chip8.h"
+#include "snapshot.h"
+
+namespace
+{
+	// Counts up in V0 and stores it over the same three bytes of memory, drawing once
+	constexpr std::array<uint8_t, 12> program = {
+		0xA3, 0x00, // 200: I = 300
+		0x70, 0x01, // 202: V0 += 1
+		0xF0, 0x33, // 204: Store BCD of V0 at I
+		0x30, 0x64, // 206: Skip if V0 == 100
+		0x12, 0x02, // 208: Jump 202
+		0xD0, 0x15  // 20A: Draw 8x5 sprite at (V0,V0)
+	};
+
+	chip8 run_cycles(chip8 emu, const int cycles)
+	{
+		for (auto i = 0; i < cycles; ++i)
+			emu.next_instruction();
+
+		return emu;
+	}
+}
+
+TEST_CASE("Delta snapshots only store the blocks of memory that changed", "[snapshot]")
+{
+	const chip8 base{ program };
+	const auto emu = run_cycles(base, 500);
+	const auto delta = save_delta_state(base, emu);
+
+	// The BCD digits and the sprite land in two different blocks
+	REQUIRE(delta.size() == chip8::state_header_size + chip8::machine_state_size + 8 + 2 * snapshot_block_size);
+
+	auto restored = base;
+	REQUIRE(load_delta_state(restored, delta.data(), delta.size()));
+	REQUIRE(restored.memory == emu.memory);
+	REQUIRE(restored.registers.data == emu.registers.data);
+	REQUIRE(restored.registers.address == emu.registers.address);
+	REQUIRE(restored.program_counter == emu.program_counter);
+	REQUIRE(restored.dirty_rows == emu.dirty_rows);
+}
+
+TEST_CASE("Delta snapshots of an unchanged machine hold no memory", "[snapshot]")
+{
+	const chip8 base{ program };
+	const auto delta = save_delta_state(base, base);
+
+	REQUIRE(delta.size() == chip8::state_header_size + chip8::machine_state_size + 8);
+}
+
+TEST_CASE("Delta snapshots are rejected when truncated or not deltas", "[snapshot]")
+{
+	const chip8 base{ program };
+	const auto emu = run_cycles(base, 500);
+	const auto delta = save_delta_state(base, emu);
+	const auto full = emu.save_state();
+
+	auto restored = base;
+	REQUIRE_FALSE(load_delta_state(restored, delta.data(), delta.size() - 1));
+	REQUIRE_FALSE(load_delta_state(restored, full.data(), full.size()));
+	REQUIRE(restored.memory == base.memory);
+	REQUIRE(restored.program_counter == base.program_counter);
+}
+
+TEST_CASE("Snapshots round trip through files", "[snapshot]")
+{
+	const auto emu = run_cycles(chip8{ program }, 500);
+	const auto file_path = "snapshot_tests.state";
+
+	save_state_file(file_path, emu);
+
+	chip8 restored;
+	load_state_file(file_path, restored);
+	std::remove(file_path);
+
+	REQUIRE(restored.memory == emu.memory);
+	REQUIRE(restored.program_counter == emu.program_counter);
+	REQUIRE_THROWS_AS(load_state_file(file_path, restored), std::runtime_error);
+}
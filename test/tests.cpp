@@ -2,6 +2,7 @@
 
 #include <catch2/catch.hpp>
 
+#include "cached_interpreter.h"
 #include "chip8.h"
 
 template<bool test>
@@ -14,16 +15,47 @@ bool static_test()
 #define TEST(x) static_test<x>()
 
 template<typename... T>
-constexpr auto run(T... program)
+constexpr auto run_with_keys(const uint16_t key_state, T... program)
 {
 	std::array<uint8_t, sizeof...(T)> data{ static_cast<uint8_t>(program)... };
 
 	chip8 emu{ data };
+	emu.key_state = key_state;
 	emu.run();
 
 	return emu;
 }
 
+template<typename... T>
+constexpr auto run_with_seed(const uint32_t seed, T... program)
+{
+	std::array<uint8_t, sizeof...(T)> data{ static_cast<uint8_t>(program)... };
+
+	chip8 emu{ data };
+	emu.seed_random(seed);
+	emu.run();
+
+	return emu;
+}
+
+template<typename... T>
+constexpr auto run(T... program)
+{
+	return run_with_keys(0, program...);
+}
+
+template<typename... T>
+constexpr auto run_cached(T... program)
+{
+	std::array<uint8_t, sizeof...(T)> data{ static_cast<uint8_t>(program)... };
+
+	chip8 emu{ data };
+	cached_interpreter cache{ emu };
+	cache.run();
+
+	return emu;
+}
+
 TEST_CASE("00E0 resets all pixels", "[opcode]")
 {
 	constexpr auto emu = run(0xD0, 0x15, 0x00, 0xE0);
@@ -57,6 +89,14 @@ TEST_CASE("2NNN calls a subroutine at NNN", "[opcode]")
 	REQUIRE(TEST(emu.stack_pointer == 1));
 }
 
+TEST_CASE("2NNN quits instead of overflowing the call stack", "[opcode]")
+{
+	constexpr auto emu = run(0x22, 0x00);
+
+	REQUIRE(TEST(emu.stack_pointer == chip8::max_stacks));
+	REQUIRE(TEST(emu.program_counter == 512));
+}
+
 TEST_CASE("3XNN skips the next instruction if Vx equals NN", "[opcode]")
 {
 	constexpr auto emu = run(0x60, 0x12, 0x30, 0x12, 0x00, 0xEE, 0x00, 0xEE);
@@ -206,7 +246,43 @@ TEST_CASE("BNNN jumps to address NNN plus V0", "[opcode]")
 	REQUIRE(TEST(emu.program_counter == 518));
 }
 
-// CXNN cannot be tested easily at compile-time
+TEST_CASE("CXNN sets Vx to a random number AND NN", "[opcode]")
+{
+	constexpr auto emu = run_with_seed(1, 0xC0, 0xFF, 0xC1, 0x0F, 0xC2, 0x00);
+
+	REQUIRE(TEST(emu.registers.data[0x0] == 0x80));
+	REQUIRE(TEST(emu.registers.data[0x1] == 0x05));
+	REQUIRE(TEST(emu.registers.data[0x2] == 0x00));
+	REQUIRE(TEST(emu.program_counter == 518));
+}
+
+TEST_CASE("CXNN repeats the same numbers for the same seed", "[random]")
+{
+	constexpr auto first = run_with_seed(0xC8, 0xC0, 0xFF, 0xC1, 0xFF, 0xC2, 0xFF);
+	constexpr auto second = run_with_seed(0xC8, 0xC0, 0xFF, 0xC1, 0xFF, 0xC2, 0xFF);
+	constexpr auto other = run_with_seed(0xC9, 0xC0, 0xFF, 0xC1, 0xFF, 0xC2, 0xFF);
+
+	REQUIRE(TEST(first.registers.data[0x0] == second.registers.data[0x0]));
+	REQUIRE(TEST(first.registers.data[0x1] == second.registers.data[0x1]));
+	REQUIRE(TEST(first.registers.data[0x2] == second.registers.data[0x2]));
+	REQUIRE(TEST(first.random_state == second.random_state));
+	REQUIRE(TEST(first.random_state != other.random_state));
+}
+
+TEST_CASE("Every seed produces random numbers", "[random]")
+{
+	// Scrambling this seed would give 0, which xorshift never leaves
+	chip8 emu;
+	emu.seed_random(0x2545F491);
+
+	auto any_set = false;
+
+	for (auto i = 0; i < 16; ++i)
+		any_set |= emu.random_byte() != 0;
+
+	REQUIRE(emu.random_state != 0);
+	REQUIRE(any_set);
+}
 
 TEST_CASE("DXYN draws a sprite located at the address register at (Vx,Vy), with a height of N", "[opcode]")
 {
@@ -218,7 +294,61 @@ TEST_CASE("DXYN draws a sprite located at the address register at (Vx,Vy), with
 	REQUIRE(TEST(emu.is_pixel_set(3, 4) == true));
 }
 
-// EX9E and EXA1 cannot be tested as key input is not yet implemented
+TEST_CASE("DXYN draws sprites that are not aligned to a byte", "[opcode]")
+{
+	constexpr auto emu = run(0x60, 0x05, 0xD0, 0x11);
+
+	REQUIRE(TEST(emu.is_pixel_set(4, 0) == false));
+	REQUIRE(TEST(emu.is_pixel_set(5, 0) == true));
+	REQUIRE(TEST(emu.is_pixel_set(8, 0) == true));
+	REQUIRE(TEST(emu.is_pixel_set(9, 0) == false));
+}
+
+TEST_CASE("DXYN wraps sprites around the edges of the display", "[opcode]")
+{
+	constexpr auto emu = run(0x60, 0x3E, 0x61, 0x1F, 0xD0, 0x12);
+
+	REQUIRE(TEST(emu.is_pixel_set(62, 31) == true));
+	REQUIRE(TEST(emu.is_pixel_set(1, 31) == true));
+	REQUIRE(TEST(emu.is_pixel_set(2, 31) == false));
+	REQUIRE(TEST(emu.is_pixel_set(62, 0) == true));
+	REQUIRE(TEST(emu.is_pixel_set(63, 0) == false));
+	REQUIRE(TEST(emu.is_pixel_set(1, 0) == true));
+}
+
+TEST_CASE("DXYN erases set pixels, setting Vf to 1 when a pixel is erased", "[opcode]")
+{
+	constexpr auto emu = run(0x60, 0x05, 0xD0, 0x15, 0xD0, 0x15);
+
+	REQUIRE(TEST(emu.is_pixel_set(5, 0) == false));
+	REQUIRE(TEST(emu.is_pixel_set(8, 4) == false));
+	REQUIRE(TEST(emu.registers.data[0xF] == 1));
+}
+
+TEST_CASE("DXYN sets Vf to 0 when no pixel is erased", "[opcode]")
+{
+	constexpr auto emu = run(0x60, 0x05, 0xD0, 0x15, 0x60, 0x0D, 0xD0, 0x15);
+
+	REQUIRE(TEST(emu.registers.data[0xF] == 0));
+}
+
+TEST_CASE("EX9E skips the next instruction if the key stored in Vx is pressed", "[opcode]")
+{
+	constexpr auto pressed = run_with_keys(0x0400, 0x60, 0x0A, 0xE0, 0x9E, 0x00, 0xEE, 0x00, 0xEE);
+	constexpr auto released = run_with_keys(0xFBFF, 0x60, 0x0A, 0xE0, 0x9E, 0x00, 0xEE, 0x00, 0xEE);
+
+	REQUIRE(TEST(pressed.program_counter == 518));
+	REQUIRE(TEST(released.program_counter == 516));
+}
+
+TEST_CASE("EXA1 skips the next instruction if the key stored in Vx is not pressed", "[opcode]")
+{
+	constexpr auto pressed = run_with_keys(0x0400, 0x60, 0x0A, 0xE0, 0xA1, 0x00, 0xEE, 0x00, 0xEE);
+	constexpr auto released = run_with_keys(0xFBFF, 0x60, 0x0A, 0xE0, 0xA1, 0x00, 0xEE, 0x00, 0xEE);
+
+	REQUIRE(TEST(pressed.program_counter == 516));
+	REQUIRE(TEST(released.program_counter == 518));
+}
 
 TEST_CASE("FX07 sets Vx to the delay timer", "[opcode]")
 {
@@ -227,20 +357,68 @@ TEST_CASE("FX07 sets Vx to the delay timer", "[opcode]")
 	REQUIRE(TEST(emu.registers.data[0x0] == 60));
 }
 
-// FX0A cannot be tested as key input is not yet implemented
+TEST_CASE("FX0A waits for a key to be pressed and released and stores it in Vx", "[opcode]")
+{
+	chip8 emu{ std::array<uint8_t, 2>{ 0xF3, 0x0A } };
+
+	emu.next_instruction();
+	REQUIRE(emu.program_counter == 512);
+
+	emu.set_key_state(0x0021);
+	emu.next_instruction();
+	REQUIRE(emu.program_counter == 512);
+
+	// Key 0 counts like any other
+	emu.set_key_state(0x0020);
+	emu.next_instruction();
+	REQUIRE(emu.program_counter == 514);
+	REQUIRE(emu.registers.data[0x3] == 0);
+}
+
+TEST_CASE("set_key_state remembers the lowest released key until the next release", "[input]")
+{
+	chip8 emu;
+
+	emu.set_key_state(0x0920);
+	REQUIRE(emu.released_key == chip8::no_key);
+
+	emu.set_key_state(0x0100);
+	REQUIRE(emu.released_key == 5);
+	REQUIRE(emu.key_state == 0x0100);
+
+	emu.set_key_state(0x0100);
+	REQUIRE(emu.released_key == 5);
+
+	emu.set_key_state(0x0000);
+	REQUIRE(emu.released_key == 8);
+}
+
+TEST_CASE("A key pressed after a release does not hide it from FX0A", "[input]")
+{
+	chip8 emu{ std::array<uint8_t, 2>{ 0xF3, 0x0A } };
+
+	emu.set_key_state(0x0004);
+	emu.set_key_state(0x0000);
+	emu.set_key_state(0x0080);
+	emu.next_instruction();
+
+	REQUIRE(emu.program_counter == 514);
+	REQUIRE(emu.registers.data[0x3] == 2);
+	REQUIRE(emu.released_key == chip8::no_key);
+}
 
 TEST_CASE("FX15 sets the delay timer to Vx", "[opcode]")
 {
 	constexpr auto emu = run(0x60, 0x12, 0xF0, 0x15);
 
-	REQUIRE(TEST(emu.delay_timer == 17));
+	REQUIRE(TEST(emu.delay_timer == 18));
 }
 
 TEST_CASE("FX18 sets the sound timer to Vx", "[opcode]")
 {
 	constexpr auto emu = run(0x60, 0x12, 0xF0, 0x18);
 
-	REQUIRE(TEST(emu.sound_timer == 17));
+	REQUIRE(TEST(emu.sound_timer == 18));
 }
 
 TEST_CASE("FX1E adds Vx to the address register, setting Vf to 1 when there is a range overflow", "[opcode]")
@@ -294,3 +472,147 @@ TEST_CASE("FX65 fills V0 to Vx with memory starting at the address register", "[
 	REQUIRE(TEST(emu.registers.data[0x4 == 32]));
 	REQUIRE(TEST(emu.registers.data[0x5 == 255]));
 }
+
+TEST_CASE("Timers are not decremented by instructions", "[timer]")
+{
+	constexpr auto emu = run(0x60, 0x12, 0x61, 0x13, 0x62, 0x14);
+
+	REQUIRE(TEST(emu.delay_timer == 60));
+	REQUIRE(TEST(emu.sound_timer == 60));
+}
+
+TEST_CASE("tick_timers decrements both timers by the number of ticks", "[timer]")
+{
+	constexpr auto emu = [] {
+		auto emu = run(0x60, 0x12, 0xF0, 0x15);
+		emu.tick_timers(5);
+		return emu;
+	}();
+
+	REQUIRE(TEST(emu.delay_timer == 13));
+	REQUIRE(TEST(emu.sound_timer == 55));
+}
+
+TEST_CASE("tick_timers stops at zero", "[timer]")
+{
+	constexpr auto emu = [] {
+		auto emu = run(0x60, 0x02, 0xF0, 0x15);
+		emu.tick_timers(1000);
+		return emu;
+	}();
+
+	REQUIRE(TEST(emu.delay_timer == 0));
+	REQUIRE(TEST(emu.sound_timer == 0));
+}
+
+TEST_CASE("display_hash changes when the display changes", "[display]")
+{
+	constexpr auto blank = run(0x00, 0xEE);
+	constexpr auto drawn = run(0xD0, 0x15);
+	constexpr auto cleared = run(0xD0, 0x15, 0x00, 0xE0);
+
+	REQUIRE(TEST(blank.display_hash() != drawn.display_hash()));
+	REQUIRE(TEST(blank.display_hash() == cleared.display_hash()));
+}
+
+TEST_CASE("DXYN marks the rows it draws to as dirty", "[display]")
+{
+	constexpr auto emu = run(0x60, 0x1E, 0xD0, 0x05);
+
+	REQUIRE(TEST(emu.dirty_rows == 0xC0000007));
+}
+
+TEST_CASE("00E0 marks every row as dirty", "[display]")
+{
+	constexpr auto emu = run(0x00, 0xE0);
+
+	REQUIRE(TEST(emu.dirty_rows == 0xFFFFFFFF));
+}
+
+TEST_CASE("Writes to display memory mark the written row as dirty", "[display]")
+{
+	constexpr auto emu = run(0xAF, 0x10, 0x60, 0xFF, 0xF0, 0x55);
+
+	REQUIRE(TEST(emu.dirty_rows == 0x4));
+}
+
+TEST_CASE("The cached interpreter runs programs the same as the interpreter", "[cache]")
+{
+	constexpr auto emu = run_cached(0x60, 0x12, 0x22, 0x08, 0x81, 0x04, 0x00, 0xEE, 0x70, 0x01, 0x00, 0xEE);
+
+	REQUIRE(TEST(emu.program_counter == 518));
+	REQUIRE(TEST(emu.registers.data[0x0] == 19));
+	REQUIRE(TEST(emu.registers.data[0x1] == 19));
+}
+
+TEST_CASE("The cached interpreter re-decodes instructions overwritten by FX33", "[cache]")
+{
+	constexpr auto emu = run_cached(0x60, 0x09, 0xA2, 0x06, 0xF0, 0x33, 0x61, 0x05, 0x00, 0xEE);
+
+	REQUIRE(TEST(emu.program_counter == 518));
+	REQUIRE(TEST(emu.registers.data[0x1] == 0));
+}
+
+TEST_CASE("The cached interpreter re-decodes instructions overwritten by FX55", "[cache]")
+{
+	constexpr auto emu = run_cached(0x60, 0x00, 0x61, 0x00, 0xA2, 0x08, 0xF1, 0x55, 0x62, 0x05, 0x00, 0xEE);
+
+	REQUIRE(TEST(emu.program_counter == 520));
+	REQUIRE(TEST(emu.registers.data[0x2] == 0));
+}
+
+template<typename... T>
+constexpr auto run_and_restore(T... program)
+{
+	const auto saved = run_with_seed(0xC8, program...);
+	const auto state = saved.save_state();
+
+	chip8 emu;
+	emu.load_state(state.data(), state.size());
+
+	return emu;
+}
+
+TEST_CASE("load_state restores a snapshot made by save_state", "[state]")
+{
+	constexpr auto saved = run_with_seed(0xC8, 0x60, 0x12, 0xA0, 0x0A, 0xD0, 0x15, 0xC1, 0xFF, 0x22, 0x0C, 0x00, 0x00, 0x00, 0x00);
+	constexpr auto restored = run_and_restore(0x60, 0x12, 0xA0, 0x0A, 0xD0, 0x15, 0xC1, 0xFF, 0x22, 0x0C, 0x00, 0x00, 0x00, 0x00);
+
+	REQUIRE(TEST(restored.registers.data[0x0] == 0x12));
+	REQUIRE(TEST(restored.registers.data[0x1] == saved.registers.data[0x1]));
+	REQUIRE(TEST(restored.registers.address == 0x00A));
+	REQUIRE(TEST(restored.program_counter == 0x20C));
+	REQUIRE(TEST(restored.stack_pointer == 1));
+	REQUIRE(TEST(restored.call_stack[0] == 0x20A));
+	REQUIRE(TEST(restored.display_hash() == saved.display_hash()));
+	REQUIRE(TEST(restored.dirty_rows == saved.dirty_rows));
+	REQUIRE(TEST(restored.random_state == saved.random_state));
+}
+
+TEST_CASE("load_state rejects snapshots that are not valid", "[state]")
+{
+	const chip8 original{ std::array<uint8_t, 2>{ 0x60, 0x12 } };
+	const auto state = original.save_state();
+
+	auto wrong_magic = state;
+	wrong_magic[0] = 'X';
+
+	auto wrong_version = state;
+	wrong_version[4] = chip8::state_version + 1;
+
+	auto overflowing_stack = state;
+	overflowing_stack[chip8::state_header_size + 16 + 2 + 2 + (chip8::max_stacks * 2)] = chip8::max_stacks + 1;
+
+	chip8 emu;
+	emu.registers.data[0x0] = 0x34;
+
+	REQUIRE_FALSE(emu.load_state(wrong_magic.data(), wrong_magic.size()));
+	REQUIRE_FALSE(emu.load_state(wrong_version.data(), wrong_version.size()));
+	REQUIRE_FALSE(emu.load_state(overflowing_stack.data(), overflowing_stack.size()));
+	REQUIRE_FALSE(emu.load_state(state.data(), state.size() - 1));
+	REQUIRE(emu.registers.data[0x0] == 0x34);
+
+	REQUIRE(emu.load_state(state.data(), state.size()));
+	REQUIRE(emu.registers.data[0x0] == 0);
+	REQUIRE(emu.memory == original.memory);
+}